@@ -0,0 +1,47 @@
+/**
+ * bench.h - Shared helpers for the micro-benchmarks under bench/
+ *
+ * Every benchmark prints one JSON object per measurement on stdout so runs
+ * can be diffed or loaded into a spreadsheet without scraping:
+ *   {"bench":"chunked_decode","case":"in_place","iterations":2000,
+ *    "ns_per_op":1234.5,"mb_per_s":456.7}
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static inline uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Keeps the compiler from discarding results that are otherwise unused */
+static volatile uintptr_t bench_sink;
+
+static inline void bench_consume(const void *ptr) {
+  bench_sink ^= (uintptr_t)ptr;
+}
+
+/* bytes_per_op may be 0 when throughput is meaningless for the case */
+static inline void bench_report(const char *bench, const char *name,
+                                size_t iterations, uint64_t elapsed_ns,
+                                size_t bytes_per_op) {
+  double ns_per_op = iterations ? (double)elapsed_ns / (double)iterations : 0;
+  printf("{\"bench\":\"%s\",\"case\":\"%s\",\"iterations\":%zu,"
+         "\"ns_per_op\":%.1f",
+         bench, name, iterations, ns_per_op);
+  if (bytes_per_op > 0 && ns_per_op > 0) {
+    printf(",\"mb_per_s\":%.1f",
+           (double)bytes_per_op / ns_per_op * 1e9 / (1024.0 * 1024.0));
+  }
+  printf("}\n");
+  fflush(stdout);
+}
+
+#endif /* BENCH_H */
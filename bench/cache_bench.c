@@ -0,0 +1,158 @@
+/**
+ * cache_bench.c - ClientCache lookup and insert cost against cache size
+ *
+ * Fills caches of 50 up to 100000 entries and times hits on random keys and
+ * inserts that evict. With the hashed index both should stay flat as the
+ * cache grows. Inserts are timed writing the store synchronously and through
+ * the write-behind queue, whose flush on destroy is left out of the timing.
+ * A last case times cold-start hits served from the store tier by a fresh
+ * cache. The cache keeps its store relative to the working
+ * directory, so the benchmark runs inside a scratch directory under /tmp.
+ */
+
+#include "bench.h"
+#include "client_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOOKUPS 200000
+#define INSERTS 5000
+#define KEY_SIZE 64
+
+static const char *PAYLOAD =
+    "{\"success\":true,\"data\":{\"temperature\":12.5,\"wind\":3.1}}";
+
+static json_t *payload;
+
+static const size_t SIZES[] = {50, 1000, 10000, 100000};
+
+/* Sets up <tmp>/src/client/cache, where the cache keeps its store */
+static int enter_scratch_dir(char *dir, size_t size) {
+  snprintf(dir, size, "/tmp/cache_bench.XXXXXX");
+  if (!mkdtemp(dir) || chdir(dir) != 0) {
+    return -1;
+  }
+  mkdir("src", 0755);
+  mkdir("src/client", 0755);
+  return mkdir("src/client/cache", 0755);
+}
+
+static void remove_scratch_dir(const char *dir) {
+  char command[256];
+  snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+  if (chdir("/") == 0 && system(command) != 0) {
+    fprintf(stderr, "cache_bench: could not remove %s\n", dir);
+  }
+}
+
+static void make_key(char *key, size_t index) {
+  snprintf(key, KEY_SIZE, "current:lat=%.4f:lon=%.4f",
+           (double)(index % 1000) * 0.01, (double)(index / 1000) * 0.01);
+}
+
+static void run_size(size_t entries, size_t write_behind_bytes,
+                     char (*keys)[KEY_SIZE]) {
+  ClientCache *cache = client_cache_create(entries, 3600, 3600, write_behind_bytes);
+  if (!cache) {
+    fprintf(stderr, "cache_bench: client_cache_create failed\n");
+    exit(1);
+  }
+
+  for (size_t i = 0; i < entries; i++) {
+    client_cache_set(cache, keys[i], payload, PAYLOAD, strlen(PAYLOAD), NULL,
+                     -1);
+  }
+  client_cache_flush(cache);
+
+  char name[64];
+  srand(42);
+
+  /* Hits never reach the store, so time them once */
+  uint64_t start;
+  if (write_behind_bytes == 0) {
+    start = bench_now_ns();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+      json_t *json = client_cache_get(cache, keys[(size_t)rand() % entries]);
+      bench_consume(json);
+      json_decref(json);
+    }
+    snprintf(name, sizeof(name), "get_hit/%zu", entries);
+    bench_report("client_cache", name, LOOKUPS, bench_now_ns() - start, 0);
+  }
+
+  /* Fresh keys at capacity, so every insert evicts */
+  start = bench_now_ns();
+  for (size_t i = 0; i < INSERTS; i++) {
+    client_cache_set(cache, keys[entries + i], payload, PAYLOAD,
+                     strlen(PAYLOAD), NULL, -1);
+  }
+  snprintf(name, sizeof(name), "set_evict%s/%zu",
+           write_behind_bytes > 0 ? "_write_behind" : "", entries);
+  bench_report("client_cache", name, INSERTS, bench_now_ns() - start, 0);
+
+  client_cache_destroy(cache);
+}
+
+/* Every lookup misses memory and parses the entry from the mapped store */
+static void run_cold_start(char (*keys)[KEY_SIZE]) {
+  const size_t entries = 1000;
+
+  ClientCache *warm = client_cache_create(entries, 3600, 3600, 0);
+  ClientCache *cold = client_cache_create(entries, 3600, 3600, 0);
+  if (!warm || !cold) {
+    fprintf(stderr, "cache_bench: client_cache_create failed\n");
+    exit(1);
+  }
+
+  for (size_t i = 0; i < entries; i++) {
+    client_cache_set(warm, keys[i], payload, PAYLOAD, strlen(PAYLOAD), NULL,
+                     -1);
+  }
+
+  uint64_t start = bench_now_ns();
+  for (size_t i = 0; i < entries; i++) {
+    json_t *json = client_cache_get(cold, keys[i]);
+    bench_consume(json);
+    json_decref(json);
+  }
+  bench_report("client_cache", "get_disk/1000", entries,
+               bench_now_ns() - start, strlen(PAYLOAD));
+
+  client_cache_destroy(cold);
+  client_cache_destroy(warm);
+}
+
+int main(void) {
+  size_t largest = SIZES[sizeof(SIZES) / sizeof(SIZES[0]) - 1];
+  char(*keys)[KEY_SIZE] = malloc((largest + INSERTS) * KEY_SIZE);
+  if (!keys) {
+    return 1;
+  }
+  for (size_t i = 0; i < largest + INSERTS; i++) {
+    make_key(keys[i], i);
+  }
+
+  payload = json_loads(PAYLOAD, 0, NULL);
+
+  char dir[64];
+  if (enter_scratch_dir(dir, sizeof(dir)) != 0) {
+    fprintf(stderr, "cache_bench: could not create scratch directory\n");
+    free(keys);
+    return 1;
+  }
+
+  for (size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++) {
+    run_size(SIZES[i], 0, keys);
+    run_size(SIZES[i], CACHE_WRITE_BEHIND_BYTES, keys);
+  }
+  run_cold_start(keys);
+
+  remove_scratch_dir(dir);
+  json_decref(payload);
+  free(keys);
+  return 0;
+}
@@ -0,0 +1,214 @@
+/**
+ * chunked_bench.c - Chunked transfer decoding, old vs. in-place decoder
+ *
+ * Decodes a body of 1000 chunks with both the allocating decoder that
+ * http_client.c used to carry (kept verbatim below as the baseline) and the
+ * streaming in-place HttpChunkedDecoder. The in-place case includes copying
+ * the raw bytes into a scratch buffer, standing in for the socket read that
+ * fills the receive buffer in the client.
+ */
+
+#include "bench.h"
+#include "http_chunked.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK_COUNT 1000
+#define CHUNK_PAYLOAD 64
+#define ITERATIONS 2000
+
+/* Baseline: decode_chunked() as it was before HttpChunkedDecoder */
+static int legacy_decode_chunked(const uint8_t *in, size_t in_len, char **out,
+                                 size_t *out_len) {
+  if (!in || !out || !out_len) {
+    return -1;
+  }
+
+  size_t pos = 0;
+  size_t alloc = 1024;
+  char *buf = malloc(alloc);
+  if (!buf) {
+    return -2;
+  }
+  size_t buf_len = 0;
+
+  while (pos < in_len) {
+    size_t line_start = pos;
+    while (pos < in_len &&
+           !(in[pos] == '\r' && pos + 1 < in_len && in[pos + 1] == '\n')) {
+      pos++;
+    }
+
+    if (pos >= in_len) {
+      free(buf);
+      return -3;
+    }
+
+    size_t line_len = pos - line_start;
+    if (line_len == 0) {
+      free(buf);
+      return -4;
+    }
+
+    char *hex = malloc(line_len + 1);
+    if (!hex) {
+      free(buf);
+      return -5;
+    }
+    memcpy(hex, in + line_start, line_len);
+    hex[line_len] = '\0';
+
+    char *endptr = NULL;
+    unsigned long chunk_size = strtoul(hex, &endptr, 16);
+    if (endptr == hex) {
+      free(hex);
+      free(buf);
+      return -6;
+    }
+    free(hex);
+
+    pos += 2;
+
+    if (chunk_size == 0) {
+      if (pos + 1 < in_len && in[pos] == '\r' && in[pos + 1] == '\n') {
+        pos += 2;
+      }
+      break;
+    }
+
+    if (pos + chunk_size > in_len) {
+      free(buf);
+      return -7;
+    }
+
+    if (buf_len + chunk_size + 1 > alloc) {
+      while (buf_len + chunk_size + 1 > alloc) {
+        alloc *= 2;
+      }
+      char *nbuf = realloc(buf, alloc);
+      if (!nbuf) {
+        free(buf);
+        return -8;
+      }
+      buf = nbuf;
+    }
+
+    memcpy(buf + buf_len, in + pos, chunk_size);
+    buf_len += chunk_size;
+    pos += chunk_size;
+
+    if (pos + 1 >= in_len || in[pos] != '\r' || in[pos + 1] != '\n') {
+      free(buf);
+      return -9;
+    }
+    pos += 2;
+  }
+
+  if (buf_len + 1 > alloc) {
+    char *nbuf = realloc(buf, buf_len + 1);
+    if (!nbuf) {
+      free(buf);
+      return -10;
+    }
+    buf = nbuf;
+  }
+  buf[buf_len] = '\0';
+
+  *out = buf;
+  *out_len = buf_len;
+  return 0;
+}
+
+static char *build_chunked_body(size_t chunks, size_t payload, size_t *len) {
+  size_t cap = chunks * (payload + 16) + 16;
+  char *body = malloc(cap);
+  if (!body) {
+    return NULL;
+  }
+
+  size_t pos = 0;
+  for (size_t i = 0; i < chunks; i++) {
+    pos += (size_t)snprintf(body + pos, cap - pos, "%zx\r\n", payload);
+    for (size_t j = 0; j < payload; j++) {
+      body[pos++] = (char)('a' + (i + j) % 26);
+    }
+    body[pos++] = '\r';
+    body[pos++] = '\n';
+  }
+  pos += (size_t)snprintf(body + pos, cap - pos, "0\r\n\r\n");
+
+  *len = pos;
+  return body;
+}
+
+int main(void) {
+  size_t raw_len = 0;
+  char *raw = build_chunked_body(CHUNK_COUNT, CHUNK_PAYLOAD, &raw_len);
+  char *scratch = malloc(raw_len);
+  if (!raw || !scratch) {
+    fprintf(stderr, "allocation failed\n");
+    return 1;
+  }
+
+  /* Both decoders must agree before timing means anything */
+  char *expected = NULL;
+  size_t expected_len = 0;
+  HttpChunkedDecoder decoder;
+  size_t consumed = 0;
+  memcpy(scratch, raw, raw_len);
+  http_chunked_init(&decoder);
+  long decoded = http_chunked_decode(&decoder, scratch, raw_len, &consumed);
+  if (legacy_decode_chunked((const uint8_t *)raw, raw_len, &expected,
+                            &expected_len) != 0 ||
+      decoded != (long)expected_len || consumed != raw_len ||
+      memcmp(scratch, expected, expected_len) != 0) {
+    fprintf(stderr, "decoder mismatch\n");
+    return 1;
+  }
+  free(expected);
+
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    char *out = NULL;
+    size_t out_len = 0;
+    legacy_decode_chunked((const uint8_t *)raw, raw_len, &out, &out_len);
+    bench_consume(out);
+    free(out);
+  }
+  bench_report("chunked_decode_1000", "legacy_alloc", ITERATIONS,
+               bench_now_ns() - start, raw_len);
+
+  start = bench_now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    memcpy(scratch, raw, raw_len);
+    http_chunked_init(&decoder);
+    decoded = http_chunked_decode(&decoder, scratch, raw_len, &consumed);
+    bench_consume((void *)(uintptr_t)decoded);
+  }
+  bench_report("chunked_decode_1000", "in_place", ITERATIONS,
+               bench_now_ns() - start, raw_len);
+
+  /* Same body delivered in 1400-byte reads, each landing at the tail of the
+   * already-decoded payload the way the client receives into its body */
+  start = bench_now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    http_chunked_init(&decoder);
+    size_t out_len = 0;
+    for (size_t off = 0; off < raw_len; off += 1400) {
+      size_t n = raw_len - off < 1400 ? raw_len - off : 1400;
+      memcpy(scratch + out_len, raw + off, n);
+      decoded = http_chunked_decode(&decoder, scratch + out_len, n, &consumed);
+      out_len += (size_t)decoded;
+    }
+    bench_consume((void *)(uintptr_t)out_len);
+  }
+  bench_report("chunked_decode_1000", "in_place_streamed", ITERATIONS,
+               bench_now_ns() - start, raw_len);
+
+  free(scratch);
+  free(raw);
+  return 0;
+}
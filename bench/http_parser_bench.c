@@ -0,0 +1,161 @@
+/**
+ * http_parser_bench.c - Response header parsing and 100 KB body receive
+ *
+ * Times HttpParser on what the weather server sends: a header block with
+ * caching headers (Date, Cache-Control, ETag, Last-Modified, Expires) and a
+ * small JSON body, then a 100 KB body framed by Content-Length and by chunks
+ * of mixed sizes. Bodies are delivered in 1400-byte reads the way
+ * receive_response() in http_client.c sees them off the socket: fed to the
+ * parser until the headers are in, then copied into the body window and
+ * committed, where chunked framing is decoded in place.
+ */
+
+#include "bench.h"
+#include "http_parser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER_ITERATIONS 500000
+#define BODY_ITERATIONS 5000
+#define BODY_SIZE (100 * 1024)
+#define SEGMENT 1400
+
+static const char *const HEADERS =
+    "HTTP/1.1 200 OK\r\n"
+    "Server: just-weather/1.0\r\n"
+    "Date: Sat, 17 Oct 2026 10:00:00 GMT\r\n"
+    "Content-Type: application/json; charset=utf-8\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: public, max-age=600\r\n"
+    "ETag: \"5f2b1c9e-7d4a-4e6f-9a1b-3c8d2e7f0a64\"\r\n"
+    "Last-Modified: Sat, 17 Oct 2026 09:55:00 GMT\r\n"
+    "Expires: Sat, 17 Oct 2026 10:10:00 GMT\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "X-Request-Id: 8d3f1a2b9c4e5d6f\r\n";
+
+static const char *const SMALL_BODY =
+    "{\"success\":true,\"data\":{\"temperature\":12.5,\"wind\":3.1}}";
+
+/* Chunk sizes cycle through these, as a server flushing as it renders */
+static const size_t CHUNK_SIZES[] = {8192, 4096, 1371, 16384, 512, 3000};
+
+static void fill_payload(char *out, size_t len) {
+  static const char pattern[] = "{\"time\":\"2026-10-17T10:00\",\"t\":12.5},";
+  for (size_t i = 0; i < len; i++) {
+    out[i] = pattern[i % (sizeof(pattern) - 1)];
+  }
+}
+
+static char *build_response(int chunked, size_t *len) {
+  size_t cap = strlen(HEADERS) + BODY_SIZE + BODY_SIZE / 256 * 16 + 256;
+  char *raw = malloc(cap);
+  if (!raw) {
+    return NULL;
+  }
+
+  size_t pos = (size_t)snprintf(raw, cap, "%s", HEADERS);
+  if (!chunked) {
+    pos += (size_t)snprintf(raw + pos, cap - pos,
+                            "Content-Length: %d\r\n\r\n", BODY_SIZE);
+    fill_payload(raw + pos, BODY_SIZE);
+    *len = pos + BODY_SIZE;
+    return raw;
+  }
+
+  pos += (size_t)snprintf(raw + pos, cap - pos,
+                          "Transfer-Encoding: chunked\r\n\r\n");
+  size_t left = BODY_SIZE;
+  for (size_t i = 0; left > 0; i++) {
+    size_t size = CHUNK_SIZES[i % (sizeof(CHUNK_SIZES) / sizeof(CHUNK_SIZES[0]))];
+    size = size < left ? size : left;
+    pos += (size_t)snprintf(raw + pos, cap - pos, "%zx\r\n", size);
+    fill_payload(raw + pos, size);
+    pos += size;
+    raw[pos++] = '\r';
+    raw[pos++] = '\n';
+    left -= size;
+  }
+  pos += (size_t)snprintf(raw + pos, cap - pos, "0\r\n\r\n");
+  *len = pos;
+  return raw;
+}
+
+/* Returns the body length, or 0 if the parser did not finish the message */
+static size_t receive(HttpParser *parser, const char *raw, size_t raw_len) {
+  http_parser_init(parser);
+  size_t pos = 0;
+  while (!http_parser_is_done(parser) && pos < raw_len) {
+    size_t n = raw_len - pos < SEGMENT ? raw_len - pos : SEGMENT;
+    size_t window_len = 0;
+    char *window = http_parser_body_window(parser, &window_len);
+    if (window) {
+      n = n < window_len ? n : window_len;
+      memcpy(window, raw + pos, n);
+      if (http_parser_body_commit(parser, n) != 0) {
+        break;
+      }
+    } else if (http_parser_feed(parser, raw + pos, n) < 0) {
+      break;
+    }
+    pos += n;
+  }
+  size_t body_len = http_parser_is_done(parser) ? parser->body_len : 0;
+  http_parser_reset(parser);
+  return body_len;
+}
+
+static int bench_body(HttpParser *parser, int chunked) {
+  size_t raw_len = 0;
+  char *raw = build_response(chunked, &raw_len);
+  if (!raw || receive(parser, raw, raw_len) != BODY_SIZE) {
+    fprintf(stderr, "http_parser_bench: %s body not parsed\n",
+            chunked ? "chunked" : "content-length");
+    free(raw);
+    return -1;
+  }
+
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < BODY_ITERATIONS; i++) {
+    bench_consume((void *)(uintptr_t)receive(parser, raw, raw_len));
+  }
+  bench_report("http_parser",
+               chunked ? "body_100k/chunked" : "body_100k/content_length",
+               BODY_ITERATIONS, bench_now_ns() - start, raw_len);
+  free(raw);
+  return 0;
+}
+
+int main(void) {
+  HttpParser parser;
+  char response[2048];
+  int len = snprintf(response, sizeof(response),
+                     "%sContent-Length: %zu\r\n\r\n%s", HEADERS,
+                     strlen(SMALL_BODY), SMALL_BODY);
+
+  /* The headers must come out right before timing means anything */
+  http_parser_init(&parser);
+  if (http_parser_feed(&parser, response, (size_t)len) != len ||
+      !http_parser_is_done(&parser) || parser.max_age != 600 ||
+      strcmp(parser.etag, "\"5f2b1c9e-7d4a-4e6f-9a1b-3c8d2e7f0a64\"") != 0) {
+    fprintf(stderr, "http_parser_bench: headers not parsed\n");
+    return 1;
+  }
+  http_parser_reset(&parser);
+
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < HEADER_ITERATIONS; i++) {
+    http_parser_init(&parser);
+    http_parser_feed(&parser, response, (size_t)len);
+    bench_consume((void *)(uintptr_t)parser.status_code);
+    http_parser_reset(&parser);
+  }
+  bench_report("http_parser", "response_headers", HEADER_ITERATIONS,
+               bench_now_ns() - start, (size_t)len);
+
+  if (bench_body(&parser, 0) != 0 || bench_body(&parser, 1) != 0) {
+    return 1;
+  }
+  return 0;
+}
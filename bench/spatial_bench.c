@@ -0,0 +1,181 @@
+/**
+ * spatial_bench.c - Spatial cache hit rate by cell size, and index cost
+ *
+ * Replays GPS traffic: devices spread over a city each report fixes that
+ * jitter around their position, and every fix asks for current weather.
+ * For each geohash precision, with and without a radius search, a fix hits
+ * when its cell, or one within the radius, was fetched before; the baseline
+ * keys on coordinates rounded to 4 decimals, as the client does without
+ * spatial caching. Hit rates are printed as {"hit_rate":...} records next to
+ * the cell size. A last case times radius queries against a full index.
+ */
+
+#include "bench.h"
+#include "geohash.h"
+#include "spatial_index.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEVICES 500
+#define FIXES 50000
+#define JITTER_M 15.0
+#define CITY_RADIUS_M 8000.0
+#define CENTER_LAT 59.3293
+#define CENTER_LON 18.0686
+#define QUERIES 200000
+
+#define METERS_PER_DEGREE 111195.0
+
+static const int PRECISIONS[] = {0, 6, 7, 8, 9};
+static const double RADII[] = {0.0, 100.0};
+
+typedef struct {
+  double lat;
+  double lon;
+} Position;
+
+static double uniform(void) {
+  return (rand() + 0.5) / ((double)RAND_MAX + 1.0);
+}
+
+/* Box-Muller: one standard normal sample */
+static double gaussian(void) {
+  return sqrt(-2.0 * log(uniform())) * cos(2.0 * M_PI * uniform());
+}
+
+static Position offset(Position from, double north_m, double east_m) {
+  Position to = {
+      from.lat + north_m / METERS_PER_DEGREE,
+      from.lon + east_m / (METERS_PER_DEGREE * cos(from.lat * M_PI / 180.0))};
+  return to;
+}
+
+/* The cell a fix is cached under, and the point it is indexed at */
+static void cell_of(Position fix, int precision, char *key, Position *center) {
+  if (precision == 0) {
+    snprintf(key, SPATIAL_KEY_MAX, "lat=%.4f:lon=%.4f", fix.lat, fix.lon);
+    center->lat = round(fix.lat * 1e4) / 1e4;
+    center->lon = round(fix.lon * 1e4) / 1e4;
+    return;
+  }
+  geohash_encode(fix.lat, fix.lon, precision, key);
+  geohash_decode(key, &center->lat, &center->lon, NULL, NULL);
+}
+
+static int has_point(SpatialIndex *index, const char *key, Position at) {
+  SpatialMatch matches[4];
+  size_t found = spatial_index_nearby(index, at.lat, at.lon, 0.01, matches, 4);
+  for (size_t i = 0; i < found; i++) {
+    if (strcmp(matches[i].key, key) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void run_hit_rate(const Position *devices, int precision,
+                         double radius_m) {
+  SpatialIndex *index = spatial_index_create(FIXES);
+  if (!index) {
+    fprintf(stderr, "spatial_bench: spatial_index_create failed\n");
+    exit(1);
+  }
+
+  srand(7);
+  size_t cell_hits = 0;
+  size_t nearby_hits = 0;
+  for (size_t i = 0; i < FIXES; i++) {
+    Position fix = offset(devices[(size_t)rand() % DEVICES],
+                          gaussian() * JITTER_M, gaussian() * JITTER_M);
+    char key[SPATIAL_KEY_MAX];
+    Position center;
+    cell_of(fix, precision, key, &center);
+
+    if (has_point(index, key, center)) {
+      cell_hits++;
+      continue;
+    }
+    SpatialMatch match;
+    if (radius_m > 0 && spatial_index_nearby(index, fix.lat, fix.lon, radius_m,
+                                             &match, 1) > 0) {
+      nearby_hits++;
+      continue;
+    }
+    spatial_index_insert(index, key, center.lat, center.lon);
+  }
+
+  double height = 0, width = 0;
+  if (precision > 0) {
+    geohash_cell_size(precision, CENTER_LAT, &height, &width);
+  }
+  printf("{\"bench\":\"spatial_cache\",\"case\":\"hit_rate/p%d/r%.0f\","
+         "\"cell_height_m\":%.1f,\"cell_width_m\":%.1f,\"fixes\":%d,"
+         "\"cell_hits\":%zu,\"nearby_hits\":%zu,\"entries\":%zu,"
+         "\"hit_rate\":%.3f}\n",
+         precision, radius_m, height, width, FIXES, cell_hits, nearby_hits,
+         spatial_index_count(index),
+         (double)(cell_hits + nearby_hits) / FIXES);
+  fflush(stdout);
+
+  spatial_index_destroy(index);
+}
+
+static void run_query_cost(void) {
+  const size_t points = 10000;
+  SpatialIndex *index = spatial_index_create(points);
+  Position center = {CENTER_LAT, CENTER_LON};
+
+  srand(11);
+  char key[SPATIAL_KEY_MAX];
+  uint64_t start = bench_now_ns();
+  for (size_t i = 0; i < points; i++) {
+    Position point = offset(center, (uniform() * 2 - 1) * CITY_RADIUS_M,
+                            (uniform() * 2 - 1) * CITY_RADIUS_M);
+    snprintf(key, sizeof(key), "point%zu", i);
+    spatial_index_insert(index, key, point.lat, point.lon);
+  }
+  bench_report("spatial_index", "insert/10000", points,
+               bench_now_ns() - start, 0);
+
+  SpatialMatch matches[8];
+  size_t found = 0;
+  start = bench_now_ns();
+  for (size_t i = 0; i < QUERIES; i++) {
+    Position query = offset(center, (uniform() * 2 - 1) * CITY_RADIUS_M,
+                            (uniform() * 2 - 1) * CITY_RADIUS_M);
+    found += spatial_index_nearby(index, query.lat, query.lon, 100.0, matches,
+                                  8);
+  }
+  bench_report("spatial_index", "nearby_100m/10000", QUERIES,
+               bench_now_ns() - start, 0);
+  bench_consume((void *)(uintptr_t)found);
+
+  spatial_index_destroy(index);
+}
+
+int main(void) {
+  Position center = {CENTER_LAT, CENTER_LON};
+  Position devices[DEVICES];
+  srand(3);
+  for (size_t i = 0; i < DEVICES; i++) {
+    double distance = sqrt(uniform()) * CITY_RADIUS_M;
+    double bearing = uniform() * 2.0 * M_PI;
+    devices[i] =
+        offset(center, distance * cos(bearing), distance * sin(bearing));
+  }
+
+  for (size_t p = 0; p < sizeof(PRECISIONS) / sizeof(PRECISIONS[0]); p++) {
+    for (size_t r = 0; r < sizeof(RADII) / sizeof(RADII[0]); r++) {
+      if (PRECISIONS[p] == 0 && RADII[r] > 0) {
+        continue; /* the baseline has no radius search */
+      }
+      run_hit_rate(devices, PRECISIONS[p], RADII[r]);
+    }
+  }
+  run_query_cost();
+
+  return 0;
+}
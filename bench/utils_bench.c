@@ -0,0 +1,119 @@
+/**
+ * utils_bench.c - String helpers on the request path: URL encoding, cache
+ * key normalization and MD5
+ *
+ * Inputs are city names as users type them: ASCII, Latin with diacritics,
+ * Cyrillic and CJK in UTF-8, with spaces and mixed case. Each case cycles
+ * through all names, so the figures are an average over the mix; the bytes
+ * per op behind mb_per_s are the mean name length. MD5 hashes cache keys
+ * built from the normalized names, the shape of input it would see keying
+ * entries.
+ */
+
+#include "bench.h"
+#include "hash_md5.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ITERATIONS 1000000
+#define KEY_SIZE 256
+
+static const char *const CITIES[] = {
+    "Stockholm",
+    "New York",
+    "Rio de Janeiro",
+    "São Paulo",
+    "Zürich",
+    "Kraków",
+    "Malmö",
+    "Reykjavík",
+    "Ho Chi Minh City",
+    "Москва",
+    "Санкт-Петербург",
+    "東京",
+    "北京市",
+    "  Los   Angeles ",
+    "LLANFAIRPWLLGWYNGYLL",
+    "Saint-Étienne-du-Rouvray",
+};
+
+#define CITY_COUNT (sizeof(CITIES) / sizeof(CITIES[0]))
+
+static size_t mean_length(const char *const *strings, size_t count) {
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    total += strlen(strings[i]);
+  }
+  return total / count;
+}
+
+static void bench_url_encode(void) {
+  uint64_t start = bench_now_ns();
+  for (size_t i = 0; i < ITERATIONS; i++) {
+    char *encoded = url_encode(CITIES[i % CITY_COUNT]);
+    bench_consume(encoded);
+    free(encoded);
+  }
+  bench_report("utils", "url_encode/cities", ITERATIONS,
+               bench_now_ns() - start, mean_length(CITIES, CITY_COUNT));
+}
+
+static void bench_normalize(void) {
+  char out[KEY_SIZE];
+  uint64_t start = bench_now_ns();
+  for (size_t i = 0; i < ITERATIONS; i++) {
+    normalize_string_for_cache(CITIES[i % CITY_COUNT], out, sizeof(out));
+    bench_consume((void *)(uintptr_t)out[0]);
+  }
+  bench_report("utils", "normalize_string_for_cache/cities", ITERATIONS,
+               bench_now_ns() - start, mean_length(CITIES, CITY_COUNT));
+}
+
+static void bench_md5(void) {
+  char keys[CITY_COUNT][KEY_SIZE];
+  const char *key_ptrs[CITY_COUNT];
+  size_t key_lens[CITY_COUNT];
+  for (size_t i = 0; i < CITY_COUNT; i++) {
+    char normalized[KEY_SIZE];
+    normalize_string_for_cache(CITIES[i], normalized, sizeof(normalized));
+    snprintf(keys[i], KEY_SIZE, "weather:city=%s:country=se:region=",
+             normalized);
+    key_ptrs[i] = keys[i];
+    key_lens[i] = strlen(keys[i]);
+  }
+
+  char hash[HASH_MD5_STRING_LENGTH];
+  uint64_t start = bench_now_ns();
+  for (size_t i = 0; i < ITERATIONS; i++) {
+    size_t k = i % CITY_COUNT;
+    hash_md5_string(key_ptrs[k], key_lens[k], hash, sizeof(hash));
+    bench_consume((void *)(uintptr_t)hash[0]);
+  }
+  bench_report("utils", "hash_md5_string/cache_keys", ITERATIONS,
+               bench_now_ns() - start, mean_length(key_ptrs, CITY_COUNT));
+}
+
+int main(void) {
+  /* Known answers first: a regression here would make the timings moot */
+  char check[KEY_SIZE];
+  char *encoded = url_encode("São Paulo");
+  normalize_string_for_cache("  Los   Angeles ", check, sizeof(check));
+  int ok = encoded && strcmp(encoded, "S%C3%A3o+Paulo") == 0 &&
+           strcmp(check, "los_angeles") == 0;
+  free(encoded);
+  char hash[HASH_MD5_STRING_LENGTH];
+  ok = ok && hash_md5_string("", 0, hash, sizeof(hash)) == 0 &&
+       strcmp(hash, "d41d8cd98f00b204e9800998ecf8427e") == 0;
+  if (!ok) {
+    fprintf(stderr, "utils_bench: helper output mismatch\n");
+    return 1;
+  }
+
+  bench_url_encode();
+  bench_normalize();
+  bench_md5();
+  return 0;
+}
@@ -0,0 +1,190 @@
+#include "mock_config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void mock_config_defaults(MockConfig *config) {
+  memset(config, 0, sizeof(*config));
+  snprintf(config->host, sizeof(config->host), "127.0.0.1");
+  config->port = MOCK_DEFAULT_PORT;
+  config->latency.kind = MOCK_LATENCY_NONE;
+  config->chunk_size = 1024;
+  config->keep_alive = 1;
+  config->idle_timeout_s = 30;
+  config->error_status = 503;
+  config->not_modified = MOCK_NOT_MODIFIED_MATCH;
+  config->max_age = -1;
+  config->forecast_hours = 24;
+  config->seed = 1;
+}
+
+void mock_config_usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "\n"
+          "Serves /v1/current, /v1/weather, /v1/cities, / and /echo with\n"
+          "deterministic payloads, and /stats with request counters.\n"
+          "\n"
+          "  --host ADDR            Address to listen on (127.0.0.1)\n"
+          "  --port N               Port to listen on (%d)\n"
+          "  --latency DIST         Delay before each response:\n"
+          "                           none, fixed:MS, uniform:MIN:MAX,\n"
+          "                           exp:MEAN, lognormal:MEDIAN:SIGMA\n"
+          "  --chunked              Chunked bodies instead of Content-Length\n"
+          "  --chunk-size N         Payload bytes per chunk (1024)\n"
+          "  --no-keep-alive        Close the connection after each response\n"
+          "  --idle-timeout S       Close idle connections after S seconds (30)\n"
+          "  --error-rate P         Share of requests answered with an error\n"
+          "  --error-status N       Status of those errors (503); 200 sends\n"
+          "                         {\"success\":false,...}\n"
+          "  --drop-rate P          Share of requests whose connection closes\n"
+          "                         without a response\n"
+          "  --validators           Send ETag and Last-Modified, answer\n"
+          "                         conditional requests\n"
+          "  --not-modified MODE    match (default), always or never: when\n"
+          "                         a conditional request gets a 304\n"
+          "  --max-age S            Send Cache-Control: max-age=S\n"
+          "  --forecast-hours N     Hourly entries per /v1/weather (24)\n"
+          "  --seed N               Seed of every random choice (1)\n"
+          "  --quiet                No startup line on stderr\n",
+          program, MOCK_DEFAULT_PORT);
+}
+
+static int parse_latency(MockLatency *latency, const char *spec) {
+  char extra;
+  latency->a = latency->b = 0;
+  if (strcmp(spec, "none") == 0) {
+    latency->kind = MOCK_LATENCY_NONE;
+    return 0;
+  }
+  if (sscanf(spec, "fixed:%lf%c", &latency->a, &extra) == 1) {
+    latency->kind = MOCK_LATENCY_FIXED;
+    return latency->a >= 0 ? 0 : -1;
+  }
+  if (sscanf(spec, "uniform:%lf:%lf%c", &latency->a, &latency->b, &extra) ==
+      2) {
+    latency->kind = MOCK_LATENCY_UNIFORM;
+    return latency->a >= 0 && latency->b >= latency->a ? 0 : -1;
+  }
+  if (sscanf(spec, "exp:%lf%c", &latency->a, &extra) == 1) {
+    latency->kind = MOCK_LATENCY_EXP;
+    return latency->a > 0 ? 0 : -1;
+  }
+  if (sscanf(spec, "lognormal:%lf:%lf%c", &latency->a, &latency->b,
+             &extra) == 2) {
+    latency->kind = MOCK_LATENCY_LOGNORMAL;
+    return latency->a > 0 && latency->b >= 0 ? 0 : -1;
+  }
+  return -1;
+}
+
+static int parse_rate(const char *text, double *rate) {
+  char *end;
+  *rate = strtod(text, &end);
+  return *end == '\0' && *rate >= 0 && *rate <= 1 ? 0 : -1;
+}
+
+static int parse_long(const char *text, long min, long max, long *value) {
+  char *end;
+  *value = strtol(text, &end, 10);
+  return *text && *end == '\0' && *value >= min && *value <= max ? 0 : -1;
+}
+
+int mock_config_parse(MockConfig *config, int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    const char *option = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    long number;
+    int ok = 1;
+
+    if (strcmp(option, "--help") == 0 || strcmp(option, "-h") == 0) {
+      return 1;
+    } else if (strcmp(option, "--chunked") == 0) {
+      config->chunked = 1;
+      continue;
+    } else if (strcmp(option, "--no-keep-alive") == 0) {
+      config->keep_alive = 0;
+      continue;
+    } else if (strcmp(option, "--validators") == 0) {
+      config->validators = 1;
+      continue;
+    } else if (strcmp(option, "--quiet") == 0) {
+      config->quiet = 1;
+      continue;
+    } else if (!value) {
+      ok = 0;
+    } else if (strcmp(option, "--host") == 0) {
+      ok = strlen(value) < sizeof(config->host);
+      if (ok) {
+        snprintf(config->host, sizeof(config->host), "%s", value);
+      }
+    } else if (strcmp(option, "--port") == 0) {
+      ok = parse_long(value, 1, 65535, &number) == 0;
+      config->port = (int)number;
+    } else if (strcmp(option, "--latency") == 0) {
+      ok = parse_latency(&config->latency, value) == 0;
+    } else if (strcmp(option, "--chunk-size") == 0) {
+      ok = parse_long(value, 1, 1 << 20, &number) == 0;
+      config->chunk_size = (size_t)number;
+    } else if (strcmp(option, "--idle-timeout") == 0) {
+      ok = parse_long(value, 1, 86400, &number) == 0;
+      config->idle_timeout_s = (int)number;
+    } else if (strcmp(option, "--error-rate") == 0) {
+      ok = parse_rate(value, &config->error_rate) == 0;
+    } else if (strcmp(option, "--error-status") == 0) {
+      ok = parse_long(value, 200, 599, &number) == 0;
+      config->error_status = (int)number;
+    } else if (strcmp(option, "--drop-rate") == 0) {
+      ok = parse_rate(value, &config->drop_rate) == 0;
+    } else if (strcmp(option, "--not-modified") == 0) {
+      if (strcmp(value, "match") == 0) {
+        config->not_modified = MOCK_NOT_MODIFIED_MATCH;
+      } else if (strcmp(value, "always") == 0) {
+        config->not_modified = MOCK_NOT_MODIFIED_ALWAYS;
+      } else if (strcmp(value, "never") == 0) {
+        config->not_modified = MOCK_NOT_MODIFIED_NEVER;
+      } else {
+        ok = 0;
+      }
+    } else if (strcmp(option, "--max-age") == 0) {
+      ok = parse_long(value, 0, 31536000, &config->max_age) == 0;
+    } else if (strcmp(option, "--forecast-hours") == 0) {
+      ok = parse_long(value, 0, 24 * 366, &number) == 0;
+      config->forecast_hours = (size_t)number;
+    } else if (strcmp(option, "--seed") == 0) {
+      char *end;
+      config->seed = strtoull(value, &end, 10);
+      ok = *value && *end == '\0';
+    } else {
+      ok = 0;
+    }
+
+    if (!ok) {
+      fprintf(stderr, "mock-server: invalid option %s%s%s\n", option,
+              value ? " " : "", value ? value : "");
+      return -1;
+    }
+    i++;
+  }
+  return 0;
+}
+
+double mock_latency_sample(const MockLatency *latency, double u1, double u2) {
+  switch (latency->kind) {
+  case MOCK_LATENCY_FIXED:
+    return latency->a;
+  case MOCK_LATENCY_UNIFORM:
+    return latency->a + (latency->b - latency->a) * u1;
+  case MOCK_LATENCY_EXP:
+    return -latency->a * log(u1);
+  case MOCK_LATENCY_LOGNORMAL: {
+    /* Box-Muller: one standard normal from two uniforms */
+    double normal = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+    return latency->a * exp(latency->b * normal);
+  }
+  default:
+    return 0;
+  }
+}
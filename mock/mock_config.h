@@ -0,0 +1,72 @@
+#ifndef MOCK_CONFIG_H
+#define MOCK_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MOCK_DEFAULT_PORT 10680
+
+typedef enum {
+  MOCK_LATENCY_NONE,
+  MOCK_LATENCY_FIXED,     /* a = ms */
+  MOCK_LATENCY_UNIFORM,   /* a..b ms */
+  MOCK_LATENCY_EXP,       /* mean a ms */
+  MOCK_LATENCY_LOGNORMAL, /* median a ms, sigma b */
+} MockLatencyKind;
+
+typedef struct {
+  MockLatencyKind kind;
+  double a;
+  double b;
+} MockLatency;
+
+typedef enum {
+  MOCK_NOT_MODIFIED_MATCH,  /* 304 when the validators match */
+  MOCK_NOT_MODIFIED_ALWAYS, /* 304 to every conditional request */
+  MOCK_NOT_MODIFIED_NEVER,  /* validators sent, never honored */
+} MockNotModified;
+
+/*
+  How the mock weather server answers
+    Every random choice (latency, errors, drops) comes from a generator
+  seeded with seed and the request's sequence number, so a run replays the
+  same decisions for the same requests in the same order.
+*/
+typedef struct {
+  char host[64];
+  int port;
+
+  MockLatency latency;
+
+  int chunked;       /* Transfer-Encoding: chunked instead of Content-Length */
+  size_t chunk_size; /* payload bytes per chunk */
+  int keep_alive;    /* 0 closes every connection after its response */
+  int idle_timeout_s;
+
+  double error_rate;  /* share of requests answered with error_status */
+  int error_status;   /* 200 sends an API error: {"success":false,...} */
+  double drop_rate;   /* share of requests whose connection closes unanswered */
+
+  int validators;     /* send ETag / Last-Modified and answer conditionals */
+  MockNotModified not_modified;
+  long max_age;       /* Cache-Control: max-age, -1 for none */
+
+  size_t forecast_hours; /* hourly entries in a /v1/weather response */
+  uint64_t seed;
+  int quiet;
+} MockConfig;
+
+void mock_config_defaults(MockConfig *config);
+
+/*
+  Parses command line options into config. Returns 0 on success, 1 when
+  --help was asked for, -1 on a bad option (with a message on stderr).
+*/
+int mock_config_parse(MockConfig *config, int argc, char **argv);
+
+void mock_config_usage(const char *program);
+
+/* Milliseconds to wait before answering, for a uniform u1, u2 in (0, 1) */
+double mock_latency_sample(const MockLatency *latency, double u1, double u2);
+
+#endif
@@ -0,0 +1,400 @@
+#include "mock_payloads.h"
+
+#include "utils.h"
+
+#include <jansson.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define MOCK_MAX_CITIES 10 /* per /v1/cities response, as the API pages */
+#define MOCK_PARAM_MAX 256
+/* Decimals as written, 2.2 rather than 2.2000000000000002 */
+#define MOCK_DUMP_FLAGS (JSON_COMPACT | JSON_REAL_PRECISION(10))
+
+/* Forecasts and observations are all stamped from here */
+#define MOCK_EPOCH 1767268800 /* 2026-01-01T12:00:00Z */
+
+typedef struct {
+  const char *name;
+  const char *country;
+  const char *region;
+  double lat;
+  double lon;
+} MockCity;
+
+static const MockCity CITIES[] = {
+    {"Stockholm", "SE", "Stockholm", 59.3293, 18.0686},
+    {"Stockport", "GB", "England", 53.4106, -2.1575},
+    {"Stockton", "US", "California", 37.9577, -121.2908},
+    {"Stoke-on-Trent", "GB", "England", 53.0027, -2.1794},
+    {"Stuttgart", "DE", "Baden-Württemberg", 48.7758, 9.1829},
+    {"Stavanger", "NO", "Rogaland", 58.9700, 5.7331},
+    {"Strasbourg", "FR", "Grand Est", 48.5734, 7.7521},
+    {"St. Louis", "US", "Missouri", 38.6270, -90.1994},
+    {"St. Petersburg", "US", "Florida", 27.7676, -82.6403},
+    {"Sydney", "AU", "New South Wales", -33.8688, 151.2093},
+    {"Seattle", "US", "Washington", 47.6062, -122.3321},
+    {"San Jose", "US", "California", 37.3382, -121.8863},
+    {"San Francisco", "US", "California", 37.7749, -122.4194},
+    {"San Diego", "US", "California", 32.7157, -117.1611},
+    {"Santiago", "CL", "Santiago Metropolitan", -33.4489, -70.6693},
+    {"São Paulo", "BR", "São Paulo", -23.5505, -46.6333},
+    {"Seoul", "KR", "Seoul", 37.5665, 126.9780},
+    {"Shanghai", "CN", "Shanghai", 31.2304, 121.4737},
+    {"Singapore", "SG", "Singapore", 1.3521, 103.8198},
+    {"Sofia", "BG", "Sofia City", 42.6977, 23.3219},
+    {"London", "GB", "England", 51.5074, -0.1278},
+    {"Los Angeles", "US", "California", 34.0522, -118.2437},
+    {"Lisbon", "PT", "Lisbon", 38.7223, -9.1393},
+    {"Lyon", "FR", "Auvergne-Rhône-Alpes", 45.7640, 4.8357},
+    {"Luleå", "SE", "Norrbotten", 65.5848, 22.1547},
+    {"Malmö", "SE", "Skåne", 55.6050, 13.0038},
+    {"Madrid", "ES", "Madrid", 40.4168, -3.7038},
+    {"Manchester", "GB", "England", 53.4808, -2.2426},
+    {"Melbourne", "AU", "Victoria", -37.8136, 144.9631},
+    {"Mexico City", "MX", "Mexico City", 19.4326, -99.1332},
+    {"Moscow", "RU", "Moscow", 55.7558, 37.6173},
+    {"Mumbai", "IN", "Maharashtra", 19.0760, 72.8777},
+    {"Munich", "DE", "Bavaria", 48.1351, 11.5820},
+    {"New York", "US", "New York", 40.7128, -74.0060},
+    {"New Delhi", "IN", "Delhi", 28.6139, 77.2090},
+    {"Oslo", "NO", "Oslo", 59.9139, 10.7522},
+    {"Paris", "FR", "Île-de-France", 48.8566, 2.3522},
+    {"Prague", "CZ", "Prague", 50.0755, 14.4378},
+    {"Kraków", "PL", "Lesser Poland", 50.0647, 19.9450},
+    {"Kyiv", "UA", "Kyiv", 50.4501, 30.5234},
+    {"Kharkiv", "UA", "Kharkiv", 49.9935, 36.2304},
+    {"Berlin", "DE", "Berlin", 52.5200, 13.4050},
+    {"Bergen", "NO", "Vestland", 60.3913, 5.3221},
+    {"Buenos Aires", "AR", "Buenos Aires", -34.6037, -58.3816},
+    {"Tokyo", "JP", "Tokyo", 35.6762, 139.6503},
+    {"Toronto", "CA", "Ontario", 43.6532, -79.3832},
+    {"Reykjavík", "IS", "Capital Region", 64.1466, -21.9426},
+    {"Rome", "IT", "Lazio", 41.9028, 12.4964},
+    {"Zürich", "CH", "Zürich", 47.3769, 8.5417},
+    {"Göteborg", "SE", "Västra Götaland", 57.7089, 11.9746},
+};
+
+#define CITY_COUNT (sizeof(CITIES) / sizeof(CITIES[0]))
+
+static uint64_t fnv1a(const char *text, uint64_t hash) {
+  for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+    hash ^= *p;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+/* A value in [min, max) picked by bits of hash, the same for the same hash */
+static double spread(uint64_t hash, int salt, double min, double max) {
+  uint64_t mixed = hash ^ ((uint64_t)salt * 0x9e3779b97f4a7c15ull);
+  mixed ^= mixed >> 31;
+  mixed *= 0xbf58476d1ce4e5b9ull;
+  mixed ^= mixed >> 29;
+  return min + (max - min) * (double)(mixed >> 11) / 9007199254740992.0;
+}
+
+static double round_to(double value, double step) {
+  return round(value / step) * step;
+}
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+/*
+  Copies the URL-decoded value of query parameter name into out. Returns 0
+  when the parameter is present, -1 otherwise.
+*/
+static int query_param(const char *query, const char *name, char *out,
+                       size_t out_size) {
+  size_t name_len = strlen(name);
+  const char *p = query;
+  while (p && *p) {
+    const char *end = strchr(p, '&');
+    if (!end) {
+      end = p + strlen(p);
+    }
+    if ((size_t)(end - p) > name_len && strncmp(p, name, name_len) == 0 &&
+        p[name_len] == '=') {
+      size_t j = 0;
+      for (const char *s = p + name_len + 1; s < end && j + 1 < out_size;
+           s++) {
+        if (*s == '+') {
+          out[j++] = ' ';
+        } else if (*s == '%' && end - s > 2 && hex_value(s[1]) >= 0 &&
+                   hex_value(s[2]) >= 0) {
+          out[j++] = (char)(hex_value(s[1]) * 16 + hex_value(s[2]));
+          s += 2;
+        } else {
+          out[j++] = *s;
+        }
+      }
+      out[j] = '\0';
+      return 0;
+    }
+    p = *end ? end + 1 : NULL;
+  }
+  return -1;
+}
+
+static void format_time(long offset_s, char *out, size_t out_size) {
+  time_t at = (time_t)MOCK_EPOCH + offset_s;
+  struct tm tm;
+  gmtime_r(&at, &tm);
+  strftime(out, out_size, "%Y-%m-%dT%H:%M", &tm);
+}
+
+/* WMO codes: clear, mainly clear, partly cloudy, overcast, fog, drizzle,
+ * rain, snow, thunderstorm */
+static const int WEATHER_CODES[] = {0, 1, 2, 3, 45, 51, 61, 71, 95};
+
+/* Plausible conditions at a place, hour hours after MOCK_EPOCH: colder
+ * toward the poles, warmest mid-afternoon local time */
+static json_t *conditions(double lat, double lon, uint64_t hash, long hour) {
+  uint64_t at = hash + (uint64_t)hour;
+  long local_hour = ((12 + hour + (long)round(lon / 15.0)) % 24 + 24) % 24;
+  double daily = 4.0 * sin(2.0 * M_PI * (double)(local_hour - 9) / 24.0);
+  double temperature = 28.0 - 0.45 * fabs(lat) + daily + spread(at, 1, -3, 3);
+  double wind = spread(at, 2, 0, 14);
+  double rain = spread(at, 6, -3, 2);
+  size_t code = (size_t)spread(at, 8, 0, sizeof(WEATHER_CODES) /
+                                             sizeof(WEATHER_CODES[0]));
+  char time[32];
+  format_time(hour * 3600, time, sizeof(time));
+
+  json_t *json = json_object();
+  json_object_set_new(json, "time", json_string(time));
+  json_object_set_new(json, "temperature", json_real(round_to(temperature, 0.1)));
+  json_object_set_new(json, "apparent_temperature",
+                      json_real(round_to(temperature - wind * 0.3, 0.1)));
+  json_object_set_new(json, "humidity",
+                      json_integer((json_int_t)spread(at, 3, 30, 100)));
+  json_object_set_new(json, "pressure",
+                      json_real(round_to(spread(at, 4, 990, 1035), 0.1)));
+  json_object_set_new(json, "windspeed", json_real(round_to(wind, 0.1)));
+  json_object_set_new(json, "winddirection",
+                      json_integer((json_int_t)spread(at, 5, 0, 360)));
+  json_object_set_new(json, "precipitation",
+                      json_real(rain > 0 ? round_to(rain, 0.1) : 0.0));
+  json_object_set_new(json, "weathercode", json_integer(WEATHER_CODES[code]));
+  json_object_set_new(json, "is_day",
+                      json_integer(local_hour >= 6 && local_hour < 18));
+  return json;
+}
+
+static json_t *city_json(const MockCity *city) {
+  json_t *json = json_object();
+  json_object_set_new(json, "name", json_string(city->name));
+  json_object_set_new(json, "country", json_string(city->country));
+  json_object_set_new(json, "region", json_string(city->region));
+  json_object_set_new(json, "latitude", json_real(city->lat));
+  json_object_set_new(json, "longitude", json_real(city->lon));
+  return json;
+}
+
+static int finish(json_t *data, int status, MockResponse *response) {
+  json_t *document = json_object();
+  json_object_set_new(document, "success", json_true());
+  json_object_set_new(document, "data", data);
+
+  response->status = status;
+  response->content_type = "application/json";
+  response->body = json_dumps(document, MOCK_DUMP_FLAGS);
+  json_decref(document);
+  if (!response->body) {
+    return -1;
+  }
+  response->body_len = strlen(response->body);
+  return 0;
+}
+
+int mock_error(int status, const char *message, MockResponse *response) {
+  json_t *error = json_object();
+  json_object_set_new(error, "code", json_integer(status));
+  json_object_set_new(error, "message", json_string(message));
+  json_t *document = json_object();
+  json_object_set_new(document, "success", json_false());
+  json_object_set_new(document, "error", error);
+
+  response->status = status;
+  response->content_type = "application/json";
+  response->failed = 1;
+  response->body = json_dumps(document, MOCK_DUMP_FLAGS);
+  json_decref(document);
+  if (!response->body) {
+    return -1;
+  }
+  response->body_len = strlen(response->body);
+  return 0;
+}
+
+void mock_response_free(MockResponse *response) {
+  free(response->body);
+  response->body = NULL;
+  response->body_len = 0;
+}
+
+static int route_current(const char *query, MockResponse *response) {
+  char lat_text[MOCK_PARAM_MAX];
+  char lon_text[MOCK_PARAM_MAX];
+  char *lat_end;
+  char *lon_end;
+  if (query_param(query, "lat", lat_text, sizeof(lat_text)) != 0 ||
+      query_param(query, "lon", lon_text, sizeof(lon_text)) != 0) {
+    return mock_error(400, "lat and lon are required", response);
+  }
+  double lat = strtod(lat_text, &lat_end);
+  double lon = strtod(lon_text, &lon_end);
+  if (*lat_end || *lon_end || !validate_latitude(lat) ||
+      !validate_longitude(lon)) {
+    return mock_error(400, "Invalid coordinates", response);
+  }
+
+  char key[64];
+  snprintf(key, sizeof(key), "%.4f,%.4f", lat, lon);
+  json_t *data = conditions(lat, lon, fnv1a(key, 14695981039346656037ull), 0);
+  json_object_set_new(data, "latitude", json_real(round_to(lat, 0.0001)));
+  json_object_set_new(data, "longitude", json_real(round_to(lon, 0.0001)));
+  return finish(data, 200, response);
+}
+
+static int route_weather(const MockConfig *config, const char *query,
+                         MockResponse *response) {
+  char city[MOCK_PARAM_MAX];
+  char country[MOCK_PARAM_MAX] = "";
+  char region[MOCK_PARAM_MAX] = "";
+  if (query_param(query, "city", city, sizeof(city)) != 0 ||
+      !validate_city_name(city)) {
+    return mock_error(400, "city is required", response);
+  }
+  query_param(query, "country", country, sizeof(country));
+  query_param(query, "region", region, sizeof(region));
+
+  /* Known cities sit where they are; any other name gets a place of its
+   * own, so load tests can ask for as many distinct cities as they like */
+  char normalized[MOCK_PARAM_MAX];
+  char candidate[MOCK_PARAM_MAX];
+  normalize_string_for_cache(city, normalized, sizeof(normalized));
+  MockCity found = {city, country, region, 0, 0};
+  uint64_t hash = fnv1a(normalized, 14695981039346656037ull);
+  hash = fnv1a(country, hash);
+  found.lat = round_to(spread(hash, 10, -60, 70), 0.0001);
+  found.lon = round_to(spread(hash, 11, -180, 180), 0.0001);
+  for (size_t i = 0; i < CITY_COUNT; i++) {
+    normalize_string_for_cache(CITIES[i].name, candidate, sizeof(candidate));
+    if (strcmp(candidate, normalized) == 0 &&
+        (!*country || strcasecmp(country, CITIES[i].country) == 0)) {
+      found = CITIES[i];
+      break;
+    }
+  }
+
+  json_t *hourly = json_array();
+  for (size_t h = 0; h < config->forecast_hours; h++) {
+    json_t *entry = conditions(found.lat, found.lon, hash, (long)h);
+    json_object_del(entry, "apparent_temperature");
+    json_object_del(entry, "is_day");
+    json_array_append_new(hourly, entry);
+  }
+
+  json_t *data = json_object();
+  json_object_set_new(data, "location", city_json(&found));
+  json_object_set_new(data, "current",
+                      conditions(found.lat, found.lon, hash, 0));
+  json_object_set_new(data, "hourly", hourly);
+  return finish(data, 200, response);
+}
+
+static int route_cities(const char *query, MockResponse *response) {
+  char text[MOCK_PARAM_MAX];
+  if (query_param(query, "query", text, sizeof(text)) != 0 ||
+      strlen(text) < 2) {
+    return mock_error(400, "query must be at least 2 characters", response);
+  }
+
+  /* Prefix of the normalized name, as the client's prefix index assumes */
+  char prefix[MOCK_PARAM_MAX];
+  char candidate[MOCK_PARAM_MAX];
+  normalize_string_for_cache(text, prefix, sizeof(prefix));
+  size_t prefix_len = strlen(prefix);
+
+  json_t *cities = json_array();
+  for (size_t i = 0; i < CITY_COUNT && json_array_size(cities) < MOCK_MAX_CITIES;
+       i++) {
+    normalize_string_for_cache(CITIES[i].name, candidate, sizeof(candidate));
+    if (strncmp(candidate, prefix, prefix_len) == 0) {
+      json_array_append_new(cities, city_json(&CITIES[i]));
+    }
+  }
+
+  json_t *data = json_object();
+  json_object_set_new(data, "cities", cities);
+  json_object_set_new(data, "count", json_integer((json_int_t)json_array_size(cities)));
+  return finish(data, 200, response);
+}
+
+static int route_home(MockResponse *response) {
+  json_t *endpoints = json_array();
+  json_array_append_new(endpoints, json_string("/v1/current?lat=&lon="));
+  json_array_append_new(endpoints,
+                        json_string("/v1/weather?city=&country=&region="));
+  json_array_append_new(endpoints, json_string("/v1/cities?query="));
+  json_array_append_new(endpoints, json_string("/echo"));
+
+  json_t *data = json_object();
+  json_object_set_new(data, "name", json_string("just-weather mock server"));
+  json_object_set_new(data, "version", json_string("1.0"));
+  json_object_set_new(data, "endpoints", endpoints);
+  return finish(data, 200, response);
+}
+
+int mock_route(const MockConfig *config, const char *target,
+               const char *request, MockResponse *response) {
+  memset(response, 0, sizeof(*response));
+
+  char path[MOCK_PARAM_MAX];
+  const char *query = strchr(target, '?');
+  size_t path_len = query ? (size_t)(query - target) : strlen(target);
+  if (path_len >= sizeof(path)) {
+    return mock_error(404, "Not found", response);
+  }
+  memcpy(path, target, path_len);
+  path[path_len] = '\0';
+  query = query ? query + 1 : "";
+
+  if (strcmp(path, "/v1/current") == 0) {
+    return route_current(query, response);
+  }
+  if (strcmp(path, "/v1/weather") == 0) {
+    return route_weather(config, query, response);
+  }
+  if (strcmp(path, "/v1/cities") == 0) {
+    return route_cities(query, response);
+  }
+  if (strcmp(path, "/") == 0) {
+    return route_home(response);
+  }
+  if (strcmp(path, "/echo") == 0) {
+    response->status = 200;
+    response->content_type = "text/plain";
+    response->body = strdup(request);
+    response->body_len = response->body ? strlen(request) : 0;
+    return response->body ? 0 : -1;
+  }
+  return mock_error(404, "Not found", response);
+}
@@ -0,0 +1,31 @@
+#ifndef MOCK_PAYLOADS_H
+#define MOCK_PAYLOADS_H
+
+#include "mock_config.h"
+
+#include <stddef.h>
+
+typedef struct {
+  int status;
+  const char *content_type;
+  char *body; /* malloc'd, NUL-terminated */
+  size_t body_len;
+  int failed; /* a {"success":false,...} document, whatever the status */
+} MockResponse;
+
+/*
+  Answers a GET of target (path and query string) the way the weather API
+  does: {"success":true,"data":...} documents whose values derive from the
+  request alone, so the same request always gets the same bytes. request is
+  the raw request head, which /echo sends back. Returns 0, or -1 when out of
+  memory.
+*/
+int mock_route(const MockConfig *config, const char *target,
+               const char *request, MockResponse *response);
+
+/* {"success":false,"error":{"message":...}} with the given status */
+int mock_error(int status, const char *message, MockResponse *response);
+
+void mock_response_free(MockResponse *response);
+
+#endif
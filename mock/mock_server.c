@@ -0,0 +1,535 @@
+/**
+ * mock_server.c - Deterministic stand-in for the weather API
+ *
+ * Serves the endpoints the client calls on localhost:10680 so client
+ * benchmarks and regression runs need no backend. Payloads derive from the
+ * request alone; latency, injected errors and dropped connections come from
+ * a generator seeded per request (see MockConfig), and /stats reports what
+ * the server did. One thread per connection, keep-alive and pipelining
+ * supported; every response goes out in a single write so that a client
+ * with Nagle's algorithm on the other end never waits on a partial one.
+ */
+
+#include "mock_config.h"
+#include "mock_payloads.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MOCK_MAX_REQUEST 65536
+#define MOCK_VALIDATOR_MAX 128
+#define MOCK_HEADER_MAX 1024
+
+static MockConfig config;
+static char last_modified[64]; /* of every resource: when the server started */
+
+static atomic_bool stop_requested;
+static atomic_uint_least64_t next_sequence;
+
+static struct {
+  atomic_uint_least64_t connections;
+  atomic_uint_least64_t requests;
+  atomic_uint_least64_t ok;
+  atomic_uint_least64_t not_modified;
+  atomic_uint_least64_t errors;
+  atomic_uint_least64_t injected_errors;
+  atomic_uint_least64_t dropped;
+} stats;
+
+typedef struct {
+  char method[16];
+  char target[2048];
+  int http_minor;
+  int keep_alive;
+  size_t content_length;
+  char if_none_match[MOCK_VALIDATOR_MAX];
+  char if_modified_since[MOCK_VALIDATOR_MAX];
+} MockRequest;
+
+static void request_stop(int signal_number) {
+  (void)signal_number;
+  atomic_store(&stop_requested, 1);
+}
+
+/* splitmix64: a well-mixed 64-bit value per step of state */
+static uint64_t next_random(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+/* Uniform in (0, 1): never 0, so log() of it is finite */
+static double next_unit(uint64_t *state) {
+  return ((double)(next_random(state) >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static void format_http_date(time_t at, char *out, size_t out_size) {
+  struct tm tm;
+  gmtime_r(&at, &tm);
+  strftime(out, out_size, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+}
+
+static const char *reason_phrase(int status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 304:
+    return "Not Modified";
+  case 400:
+    return "Bad Request";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 429:
+    return "Too Many Requests";
+  case 500:
+    return "Internal Server Error";
+  case 502:
+    return "Bad Gateway";
+  case 503:
+    return "Service Unavailable";
+  case 504:
+    return "Gateway Timeout";
+  default:
+    return "Status";
+  }
+}
+
+static int send_all(int fd, const char *data, size_t len) {
+  size_t sent = 0;
+  while (sent < len) {
+    ssize_t n = send(fd, data + sent, len - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return -1;
+    }
+    sent += (size_t)n;
+  }
+  return 0;
+}
+
+static void copy_header_value(const char *value, size_t len, char *out,
+                              size_t out_size) {
+  while (len > 0 && (*value == ' ' || *value == '\t')) {
+    value++;
+    len--;
+  }
+  while (len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t')) {
+    len--;
+  }
+  if (len >= out_size) {
+    len = 0; /* too long to be a validator we sent */
+  }
+  memcpy(out, value, len);
+  out[len] = '\0';
+}
+
+/*
+  Parses the request head in head (NUL-terminated, without the blank line).
+  Returns 0, or -1 when it is not an HTTP/1.x request line.
+*/
+static int parse_request(const char *head, MockRequest *request) {
+  memset(request, 0, sizeof(*request));
+  int major = 0;
+  if (sscanf(head, "%15s %2047s HTTP/%d.%d", request->method,
+             request->target, &major, &request->http_minor) != 4 ||
+      major != 1) {
+    return -1;
+  }
+  request->keep_alive = request->http_minor >= 1;
+
+  const char *line = strstr(head, "\r\n");
+  while (line && line[2]) {
+    line += 2;
+    const char *end = strstr(line, "\r\n");
+    size_t line_len = end ? (size_t)(end - line) : strlen(line);
+    const char *colon = memchr(line, ':', line_len);
+    if (colon) {
+      size_t name_len = (size_t)(colon - line);
+      const char *value = colon + 1;
+      size_t value_len = line_len - name_len - 1;
+      char text[MOCK_VALIDATOR_MAX];
+
+      if (name_len == 10 && strncasecmp(line, "Connection", 10) == 0) {
+        copy_header_value(value, value_len, text, sizeof(text));
+        if (strcasecmp(text, "close") == 0) {
+          request->keep_alive = 0;
+        } else if (strcasecmp(text, "keep-alive") == 0) {
+          request->keep_alive = 1;
+        }
+      } else if (name_len == 14 &&
+                 strncasecmp(line, "Content-Length", 14) == 0) {
+        copy_header_value(value, value_len, text, sizeof(text));
+        request->content_length = strtoul(text, NULL, 10);
+      } else if (name_len == 13 &&
+                 strncasecmp(line, "If-None-Match", 13) == 0) {
+        copy_header_value(value, value_len, request->if_none_match,
+                          sizeof(request->if_none_match));
+      } else if (name_len == 17 &&
+                 strncasecmp(line, "If-Modified-Since", 17) == 0) {
+        copy_header_value(value, value_len, request->if_modified_since,
+                          sizeof(request->if_modified_since));
+      }
+    }
+    line = end;
+  }
+  return 0;
+}
+
+static int is_not_modified(const MockRequest *request, const char *etag) {
+  int conditional = request->if_none_match[0] || request->if_modified_since[0];
+  switch (config.not_modified) {
+  case MOCK_NOT_MODIFIED_ALWAYS:
+    return conditional;
+  case MOCK_NOT_MODIFIED_NEVER:
+    return 0;
+  default:
+    /* If-None-Match wins over If-Modified-Since when both are sent */
+    if (request->if_none_match[0]) {
+      return strcmp(request->if_none_match, etag) == 0 ||
+             strcmp(request->if_none_match, "*") == 0;
+    }
+    return request->if_modified_since[0] &&
+           strcmp(request->if_modified_since, last_modified) == 0;
+  }
+}
+
+/*
+  Sends status, headers and body in one write: chunked framing, when on, is
+  laid out in the same buffer.
+*/
+static int send_response(int fd, const MockRequest *request,
+                         const MockResponse *response, const char *etag,
+                         int keep_alive) {
+  int has_body =
+      response->status != 304 && strcmp(request->method, "HEAD") != 0;
+  int chunked = config.chunked && request->http_minor >= 1 &&
+                response->status != 304;
+  size_t chunks = chunked ? response->body_len / config.chunk_size + 1 : 0;
+  size_t capacity = MOCK_HEADER_MAX + response->body_len + chunks * 24 + 8;
+  char *out = malloc(capacity);
+  if (!out) {
+    return -1;
+  }
+
+  char date[64];
+  format_http_date(time(NULL), date, sizeof(date));
+  size_t pos = (size_t)snprintf(
+      out, capacity,
+      "HTTP/1.1 %d %s\r\n"
+      "Date: %s\r\n"
+      "Server: just-weather-mock/1.0\r\n"
+      "Connection: %s\r\n",
+      response->status, reason_phrase(response->status), date,
+      keep_alive ? "keep-alive" : "close");
+  if (response->status != 304) {
+    pos += (size_t)snprintf(out + pos, capacity - pos,
+                            "Content-Type: %s; charset=utf-8\r\n",
+                            response->content_type);
+  }
+  if (config.max_age >= 0 &&
+      (response->status == 200 || response->status == 304)) {
+    pos += (size_t)snprintf(out + pos, capacity - pos,
+                            "Cache-Control: public, max-age=%ld\r\n",
+                            config.max_age);
+  }
+  if (etag[0]) {
+    pos += (size_t)snprintf(out + pos, capacity - pos,
+                            "ETag: %s\r\nLast-Modified: %s\r\n", etag,
+                            last_modified);
+  }
+  if (chunked) {
+    pos += (size_t)snprintf(out + pos, capacity - pos,
+                            "Transfer-Encoding: chunked\r\n\r\n");
+  } else if (response->status != 304) {
+    pos += (size_t)snprintf(out + pos, capacity - pos,
+                            "Content-Length: %zu\r\n\r\n", response->body_len);
+  } else {
+    pos += (size_t)snprintf(out + pos, capacity - pos, "\r\n");
+  }
+
+  if (has_body && chunked) {
+    for (size_t off = 0; off < response->body_len; off += config.chunk_size) {
+      size_t n = response->body_len - off < config.chunk_size
+                     ? response->body_len - off
+                     : config.chunk_size;
+      pos += (size_t)snprintf(out + pos, capacity - pos, "%zx\r\n", n);
+      memcpy(out + pos, response->body + off, n);
+      pos += n;
+      out[pos++] = '\r';
+      out[pos++] = '\n';
+    }
+    pos += (size_t)snprintf(out + pos, capacity - pos, "0\r\n\r\n");
+  } else if (has_body) {
+    memcpy(out + pos, response->body, response->body_len);
+    pos += response->body_len;
+  }
+
+  int result = send_all(fd, out, pos);
+  free(out);
+  return result;
+}
+
+static int stats_response(MockResponse *response) {
+  char body[512];
+  int len = snprintf(
+      body, sizeof(body),
+      "{\"connections\":%llu,\"requests\":%llu,\"ok\":%llu,"
+      "\"not_modified\":%llu,\"errors\":%llu,\"injected_errors\":%llu,"
+      "\"dropped\":%llu}",
+      (unsigned long long)atomic_load(&stats.connections),
+      (unsigned long long)atomic_load(&stats.requests),
+      (unsigned long long)atomic_load(&stats.ok),
+      (unsigned long long)atomic_load(&stats.not_modified),
+      (unsigned long long)atomic_load(&stats.errors),
+      (unsigned long long)atomic_load(&stats.injected_errors),
+      (unsigned long long)atomic_load(&stats.dropped));
+  response->status = 200;
+  response->content_type = "application/json";
+  response->body = strdup(body);
+  response->body_len = (size_t)len;
+  return response->body ? 0 : -1;
+}
+
+/*
+  Answers one request. Returns 1 to keep the connection, 0 to close it after
+  the response, -1 to close it at once.
+*/
+static int handle(int fd, const MockRequest *request, const char *head) {
+  MockResponse response;
+  memset(&response, 0, sizeof(response));
+  char etag[MOCK_VALIDATOR_MAX] = "";
+  int keep_alive = config.keep_alive && request->keep_alive;
+
+  /* Counters are read without latency, errors or drops */
+  if (strcmp(request->target, "/stats") == 0) {
+    if (stats_response(&response) != 0) {
+      return -1;
+    }
+    int sent = send_response(fd, request, &response, etag, keep_alive);
+    mock_response_free(&response);
+    return sent == 0 ? keep_alive : -1;
+  }
+
+  atomic_fetch_add(&stats.requests, 1);
+  uint64_t state = config.seed ^ (atomic_fetch_add(&next_sequence, 1) *
+                                  0xd1b54a32d192ed03ull);
+  double u1 = next_unit(&state);
+  double u2 = next_unit(&state);
+  double delay_ms = mock_latency_sample(&config.latency, u1, u2);
+  if (delay_ms > 0) {
+    struct timespec delay;
+    delay.tv_sec = (time_t)(delay_ms / 1000.0);
+    delay.tv_nsec = (long)((delay_ms - (double)delay.tv_sec * 1000.0) * 1e6);
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+    }
+  }
+
+  if (next_unit(&state) < config.drop_rate) {
+    atomic_fetch_add(&stats.dropped, 1);
+    return -1;
+  }
+
+  int routed;
+  if (strcmp(request->method, "GET") != 0 &&
+      strcmp(request->method, "HEAD") != 0) {
+    routed = mock_error(405, "Only GET is supported", &response);
+  } else if (next_unit(&state) < config.error_rate) {
+    atomic_fetch_add(&stats.injected_errors, 1);
+    routed = mock_error(config.error_status, "Injected error", &response);
+  } else {
+    routed = mock_route(&config, request->target, head, &response);
+  }
+  if (routed != 0) {
+    return -1;
+  }
+
+  if (config.validators && response.status == 200 && !response.failed) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < response.body_len; i++) {
+      hash = (hash ^ (unsigned char)response.body[i]) * 1099511628211ull;
+    }
+    snprintf(etag, sizeof(etag), "\"%016llx\"", (unsigned long long)hash);
+    if (is_not_modified(request, etag)) {
+      response.status = 304;
+    }
+  }
+
+  if (response.status == 304) {
+    atomic_fetch_add(&stats.not_modified, 1);
+  } else if (response.status == 200 && !response.failed) {
+    atomic_fetch_add(&stats.ok, 1);
+  } else {
+    atomic_fetch_add(&stats.errors, 1);
+  }
+
+  int sent = send_response(fd, request, &response, etag, keep_alive);
+  mock_response_free(&response);
+  return sent == 0 ? keep_alive : -1;
+}
+
+static void *serve_connection(void *arg) {
+  int fd = (int)(intptr_t)arg;
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  struct timeval timeout = {config.idle_timeout_s, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  char *buffer = malloc(MOCK_MAX_REQUEST + 1);
+  size_t buffered = 0;
+  int keep = buffer != NULL;
+
+  while (keep > 0 && !atomic_load(&stop_requested)) {
+    /* Pipelined requests may already be buffered behind the last one */
+    buffer[buffered] = '\0';
+    char *end = strstr(buffer, "\r\n\r\n");
+    if (!end) {
+      if (buffered == MOCK_MAX_REQUEST) {
+        break;
+      }
+      ssize_t n = recv(fd, buffer + buffered, MOCK_MAX_REQUEST - buffered, 0);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      buffered += (size_t)n;
+      continue;
+    }
+
+    *end = '\0';
+    size_t head_len = (size_t)(end - buffer) + 4;
+    MockRequest request;
+    if (parse_request(buffer, &request) != 0 ||
+        request.content_length > MOCK_MAX_REQUEST - head_len) {
+      MockResponse response;
+      static const MockRequest malformed = {.method = "GET", .http_minor = 1};
+      if (mock_error(400, "Malformed request", &response) == 0) {
+        send_response(fd, &malformed, &response, "", 0);
+        mock_response_free(&response);
+      }
+      break;
+    }
+
+    /* Request bodies are read and ignored */
+    while (buffered < head_len + request.content_length) {
+      ssize_t n = recv(fd, buffer + buffered, MOCK_MAX_REQUEST - buffered, 0);
+      if (n <= 0 && !(n < 0 && errno == EINTR)) {
+        keep = -1;
+        break;
+      }
+      buffered += n > 0 ? (size_t)n : 0;
+    }
+    if (keep < 0) {
+      break;
+    }
+
+    keep = handle(fd, &request, buffer);
+    size_t used = head_len + request.content_length;
+    memmove(buffer, buffer + used, buffered - used);
+    buffered -= used;
+  }
+
+  free(buffer);
+  close(fd);
+  return NULL;
+}
+
+static int listen_on(const char *host, int port) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+    fprintf(stderr, "mock-server: invalid address %s\n", host);
+    return -1;
+  }
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("mock-server: socket");
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    fprintf(stderr, "mock-server: cannot listen on %s:%d: %s\n", host, port,
+            strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int main(int argc, char **argv) {
+  mock_config_defaults(&config);
+  int parsed = mock_config_parse(&config, argc, argv);
+  if (parsed != 0) {
+    mock_config_usage(argv[0]);
+    return parsed > 0 ? 0 : 1;
+  }
+  format_http_date(time(NULL), last_modified, sizeof(last_modified));
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = request_stop; /* no SA_RESTART: wake poll() up */
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  int listen_fd = listen_on(config.host, config.port);
+  if (listen_fd < 0) {
+    return 1;
+  }
+  if (!config.quiet) {
+    fprintf(stderr, "mock-server: listening on %s:%d\n", config.host,
+            config.port);
+  }
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  while (!atomic_load(&stop_requested)) {
+    struct pollfd pfd = {listen_fd, POLLIN, 0};
+    if (poll(&pfd, 1, 1000) <= 0) {
+      continue;
+    }
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+    atomic_fetch_add(&stats.connections, 1);
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, serve_connection,
+                       (void *)(intptr_t)fd) != 0) {
+      close(fd);
+    }
+  }
+
+  pthread_attr_destroy(&attr);
+  close(listen_fd);
+  if (!config.quiet) {
+    fprintf(stderr, "mock-server: stopped\n");
+  }
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include "async_engine.hpp"
+
+#include <stdexcept>
+
+namespace weather {
+
+AsyncEngine::AsyncEngine(ConnectionPool* pool, int timeout_ms)
+    : pool_(pool)
+    , timeout_ms_(timeout_ms) {
+    loop_ = event_loop_create();
+    if (!loop_) {
+        throw std::runtime_error("Failed to create event loop");
+    }
+    event_loop_set_wake_callback(loop_, &AsyncEngine::onWake, this);
+}
+
+AsyncEngine::~AsyncEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    if (thread_.joinable()) {
+        event_loop_wakeup(loop_);
+        thread_.join();
+    }
+
+    event_loop_destroy(loop_);
+}
+
+void AsyncEngine::submit(const std::string& url, Completion done,
+                         const std::string& etag,
+                         const std::string& last_modified) {
+    char host[256];
+    char path[512];
+    int port = 0;
+    PoolAddresses* addresses = nullptr;
+    if (http_parse_url(url.c_str(), host, &port, path) == 0) {
+        addresses = connection_pool_resolve(pool_, host, port);
+    }
+
+    auto* request = new Request{this, url, etag, last_modified, std::move(done),
+                                addresses};
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (failed_) {
+            connection_pool_release_addresses(pool_, addresses);
+            delete request;
+            throw std::runtime_error("Event loop failed");
+        }
+        queue_.push_back(request);
+        pending_++;
+
+        // The I/O thread only exists once something asynchronous is used
+        if (!thread_.joinable()) {
+            thread_ = std::thread(&AsyncEngine::run, this);
+        }
+    }
+
+    event_loop_wakeup(loop_);
+}
+
+size_t AsyncEngine::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+void AsyncEngine::onWake(EventLoop*, void* userdata) {
+    static_cast<AsyncEngine*>(userdata)->startQueued();
+}
+
+void AsyncEngine::onResponse(HttpAsyncResult* result, void* userdata) {
+    auto* request = static_cast<Request*>(userdata);
+    request->engine->complete(request, *result);
+}
+
+void AsyncEngine::startQueued() {
+    std::vector<Request*> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch.swap(queue_);
+    }
+
+    for (Request* request : batch) {
+        bool resolved = request->addresses != nullptr;
+        if (http_async_get(loop_, pool_, request->url.c_str(), request->addresses,
+                           request->etag.c_str(), request->last_modified.c_str(),
+                           timeout_ms_, &AsyncEngine::onResponse, request) != 0) {
+            HttpAsyncResult failed{};
+            failed.error = resolved ? "Failed to start request"
+                                    : "Failed to resolve host";
+            complete(request, failed);
+        }
+    }
+}
+
+void AsyncEngine::complete(Request* request, HttpAsyncResult& result) {
+    try {
+        request->done(result);
+    }
+    catch (...) {
+        // Completions report their own errors; never unwind into C code
+    }
+    delete request;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_--;
+}
+
+void AsyncEngine::run() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ && pending_ == 0) {
+                break;
+            }
+        }
+
+        if (event_loop_run_once(loop_, -1) < 0) {
+            failAll();
+            break;
+        }
+    }
+}
+
+void AsyncEngine::failAll() {
+    std::vector<Request*> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed_ = true;
+        batch.swap(queue_);
+    }
+
+    for (Request* request : batch) {
+        connection_pool_release_addresses(pool_, request->addresses);
+        HttpAsyncResult failed{};
+        failed.error = "Event loop failed";
+        complete(request, failed);
+    }
+
+    // Every request in flight has a deadline; bringing them all forward
+    // completes each one, so no completion or future is left hanging
+    event_loop_fire_timers(loop_);
+}
+
+} // namespace weather
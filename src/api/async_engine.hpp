@@ -0,0 +1,91 @@
+#pragma once
+
+extern "C" {
+#include "../network/connection_pool.h"
+#include "../network/event_loop.h"
+#include "../network/http_async.h"
+#include "../network/http_client.h"
+}
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace weather {
+
+/**
+ * Non-blocking HTTP engine behind the asynchronous WeatherClient API.
+ *
+ * A single I/O thread, started on first use, runs an EventLoop that drives
+ * every in-flight request, so any number of requests overlap without a
+ * thread per call. Completions run on that I/O thread and must not block.
+ */
+class AsyncEngine {
+public:
+    /**
+     * Called exactly once per submitted request, on the I/O thread. The
+     * result's body may be taken by setting it to nullptr.
+     */
+    using Completion = std::function<void(HttpAsyncResult& result)>;
+
+    AsyncEngine(ConnectionPool* pool, int timeout_ms);
+
+    /**
+     * Waits for every submitted request to complete (each is bounded by its
+     * deadline), then stops the I/O thread.
+     */
+    ~AsyncEngine();
+
+    AsyncEngine(const AsyncEngine&) = delete;
+    AsyncEngine& operator=(const AsyncEngine&) = delete;
+
+    /**
+     * Queues a GET for url, conditional on whichever of etag and
+     * last_modified is non-empty. Thread-safe. Resolves the url's host on
+     * the calling thread (through the pool's cache) so that DNS never
+     * blocks the I/O thread.
+     * @throws std::runtime_error once the event loop has failed
+     */
+    void submit(const std::string& url, Completion done,
+                const std::string& etag = std::string(),
+                const std::string& last_modified = std::string());
+
+    /**
+     * Number of requests submitted and not yet completed
+     */
+    size_t pending() const;
+
+private:
+    struct Request {
+        AsyncEngine* engine;
+        std::string url;
+        std::string etag;
+        std::string last_modified;
+        Completion done;
+        PoolAddresses* addresses; // owned until handed to http_async_get
+    };
+
+    static void onWake(EventLoop* loop, void* userdata);
+    static void onResponse(HttpAsyncResult* result, void* userdata);
+
+    void run();
+    void startQueued();
+    void complete(Request* request, HttpAsyncResult& result);
+    void failAll();
+
+    EventLoop* loop_ = nullptr;
+    ConnectionPool* pool_;
+    int timeout_ms_;
+
+    mutable std::mutex mutex_;
+    std::vector<Request*> queue_;
+    size_t pending_ = 0;
+    bool stopping_ = false;
+    bool failed_ = false; // the event loop failed, the I/O thread is gone
+    std::thread thread_;
+};
+
+} // namespace weather
@@ -1,21 +1,35 @@
 #include "weather_client.hpp"
+#include "async_engine.hpp"
 
 // C library headers
 extern "C" {
+#include "../network/connection_pool.h"
 #include "../network/http_client.h"
 #include "../utils/client_cache.h"
+#include "../utils/geohash.h"
+#include "../utils/spatial_index.h"
 #include "../utils/utils.h"
 }
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <mutex>
 #include <sstream>
 #include <iomanip>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace weather {
 
 // Use constants from C headers:
-// CACHE_MAX_ENTRIES and CACHE_DEFAULT_TTL are defined in client_cache.h
+// The defaults for ClientConfig::cache_max_entries, cache_soft_ttl_s,
+// cache_hard_ttl_s and cache_write_behind_bytes mirror CACHE_MAX_ENTRIES,
+// CACHE_DEFAULT_TTL, CACHE_DEFAULT_HARD_TTL and CACHE_WRITE_BEHIND_BYTES
 
 /**
  * Private implementation class (Pimpl idiom)
@@ -23,41 +37,352 @@ namespace weather {
  */
 class WeatherClient::Impl {
 public:
-    HttpClient* http_client = nullptr;
+    ConnectionPool* pool = nullptr;
     ClientCache* cache = nullptr;
+    std::unique_ptr<AsyncEngine> async;
+    int timeout_ms;
 
-    explicit Impl(int timeout_ms) {
-        http_client = http_client_create(timeout_ms);
-        if (!http_client) {
-            throw WeatherClientException("Failed to create HTTP client");
+    // Spatial cache: cells fetched so far, for the radius search
+    SpatialIndex* spatial = nullptr;
+    int spatial_precision;
+    double spatial_radius_m;
+    std::atomic<uint64_t> spatial_lookups{0};
+    std::atomic<uint64_t> spatial_cell_hits{0};
+    std::atomic<uint64_t> spatial_nearby_hits{0};
+
+    // City search prefix index, see findCities
+    size_t cities_page_size;
+    size_t cities_max_queries;
+
+    std::atomic<uint64_t> fetches{0};
+    std::atomic<uint64_t> coalesced{0};
+
+    explicit Impl(const ClientConfig& config)
+        : timeout_ms(config.timeout_ms)
+        , spatial_precision(config.spatial_cache_precision)
+        , spatial_radius_m(config.spatial_cache_radius_m)
+        , cities_page_size(config.cities_page_size)
+        , cities_max_queries(config.cache_max_entries) {
+        if (spatial_precision < 0 || spatial_precision > GEOHASH_MAX_PRECISION ||
+            spatial_radius_m < 0) {
+            throw WeatherClientException("Invalid spatial cache configuration");
+        }
+
+        pool = connection_pool_create(config.pool_max_idle,
+                                      config.pool_idle_timeout_ms,
+                                      config.pool_max_age_ms);
+        if (!pool) {
+            throw WeatherClientException("Failed to create connection pool");
         }
 
-        cache = client_cache_create(CACHE_MAX_ENTRIES, CACHE_DEFAULT_TTL);
+        cache = client_cache_create(config.cache_max_entries,
+                                    config.cache_soft_ttl_s,
+                                    config.cache_hard_ttl_s,
+                                    config.cache_write_behind_bytes);
         if (!cache) {
-            http_client_destroy(http_client);
+            connection_pool_destroy(pool);
             throw WeatherClientException("Failed to create cache");
         }
+
+        try {
+            async = std::make_unique<AsyncEngine>(pool, config.timeout_ms);
+        }
+        catch (const std::exception& e) {
+            client_cache_destroy(cache);
+            connection_pool_destroy(pool);
+            throw WeatherClientException(e.what());
+        }
+
+        if (spatial_precision > 0 && spatial_radius_m > 0) {
+            spatial = spatial_index_create(config.spatial_cache_max_cells);
+            if (!spatial) {
+                async.reset();
+                client_cache_destroy(cache);
+                connection_pool_destroy(pool);
+                throw WeatherClientException("Failed to create spatial index");
+            }
+        }
     }
 
     ~Impl() {
-        if (http_client) {
-            http_client_destroy(http_client);
+        // Drain in-flight requests while the pool and cache still exist
+        async.reset();
+
+        for (HttpClient* client : idle_clients) {
+            http_client_destroy(client);
+        }
+        if (pool) {
+            connection_pool_destroy(pool);
         }
         if (cache) {
             client_cache_destroy(cache);
         }
+        spatial_index_destroy(spatial);
     }
 
     // Delete copy operations
     Impl(const Impl&) = delete;
     Impl& operator=(const Impl&) = delete;
+
+    /**
+     * Hands out an HttpClient for the duration of one synchronous request.
+     * Each holds its own response buffer, so concurrent callers never share
+     * one; all of them draw sockets from the same connection pool.
+     */
+    HttpClient* acquireHttpClient() {
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            if (!idle_clients.empty()) {
+                HttpClient* client = idle_clients.back();
+                idle_clients.pop_back();
+                return client;
+            }
+        }
+
+        HttpClient* client = http_client_create_with_pool(timeout_ms, pool);
+        if (!client) {
+            throw WeatherClientException("Failed to create HTTP client");
+        }
+        return client;
+    }
+
+    void releaseHttpClient(HttpClient* client) {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        idle_clients.push_back(client);
+    }
+
+    /**
+     * Returns a leased HttpClient when the request is done
+     */
+    class HttpClientLease {
+    public:
+        explicit HttpClientLease(Impl& impl)
+            : impl_(impl), client_(impl.acquireHttpClient()) {}
+
+        ~HttpClientLease() { impl_.releaseHttpClient(client_); }
+
+        HttpClientLease(const HttpClientLease&) = delete;
+        HttpClientLease& operator=(const HttpClientLease&) = delete;
+
+        HttpClient* get() const { return client_; }
+
+    private:
+        Impl& impl_;
+        HttpClient* client_;
+    };
+
+    /**
+     * Sends the request synchronously, conditional on validators if given,
+     * and caches the result. When the request revalidated cached, a 304
+     * returns cached itself.
+     * @throws WeatherClientException on transport, HTTP or API errors
+     */
+    JsonPtr fetch(const RequestSpec& spec, const CacheValidators* validators,
+                  json_t* cached);
+
+    /**
+     * Single-flight: the first caller to miss on cache_key leads the request
+     * for it and gets false. Later callers get true until the leader calls
+     * landFlight, which hands its outcome to their waiter.
+     */
+    bool joinFlight(const std::string& cache_key, ResponseCallback& waiter) {
+        std::lock_guard<std::mutex> lock(flights_mutex);
+        auto flight = flights.find(cache_key);
+        if (flight == flights.end()) {
+            flights.emplace(cache_key, std::vector<ResponseCallback>());
+            fetches++;
+            return false;
+        }
+        flight->second.push_back(std::move(waiter));
+        coalesced++;
+        return true;
+    }
+
+    /**
+     * Ends the flight for cache_key with result, or with error if set
+     */
+    void landFlight(const std::string& cache_key, json_t* result,
+                    std::exception_ptr error) {
+        std::vector<ResponseCallback> waiters;
+        {
+            std::lock_guard<std::mutex> lock(flights_mutex);
+            auto flight = flights.find(cache_key);
+            if (flight == flights.end()) {
+                return;
+            }
+            waiters = std::move(flight->second);
+            flights.erase(flight);
+        }
+
+        for (ResponseCallback& waiter : waiters) {
+            try {
+                waiter(error ? JsonPtr() : JsonPtr(json_incref(result)), error);
+            }
+            catch (...) {
+                // One caller's failure is none of the others' business
+            }
+        }
+    }
+
+    /**
+     * The fresh entry a flight for cache_key may have cached between a
+     * caller's cache miss and its joinFlight, making it the next leader
+     */
+    JsonPtr landedResult(const std::string& cache_key) {
+        CacheState state;
+        JsonPtr cached(client_cache_lookup(cache, cache_key.c_str(), &state, nullptr));
+        return state == CACHE_FRESH ? std::move(cached) : JsonPtr();
+    }
+
+    /**
+     * Parses a completed asynchronous request and caches the result. When
+     * the request revalidated cached, a 304 returns cached itself.
+     * @throws WeatherClientException on transport, HTTP or API errors
+     */
+    JsonPtr completeRequest(HttpAsyncResult& response, const RequestSpec& spec,
+                            json_t* cached = nullptr);
+
+    /**
+     * Revalidates a stale cache entry in the background, unless a refresh
+     * for its key is already running. If it fails, the stale entry is
+     * served until it expires.
+     */
+    void refreshInBackground(const RequestSpec& spec,
+                             const CacheValidators& validators, json_t* stale) {
+        const std::string& cache_key = spec.cache_key;
+        {
+            std::lock_guard<std::mutex> lock(refresh_mutex);
+            if (!refreshing.insert(cache_key).second) {
+                return;
+            }
+        }
+
+        // Completions must be copyable, so the document is shared
+        std::shared_ptr<json_t> document(json_incref(stale), json_decref);
+        try {
+            async->submit(spec.url,
+                [this, spec, document](HttpAsyncResult& response) {
+                    try {
+                        completeRequest(response, spec, document.get());
+                    }
+                    catch (const std::exception&) {
+                        // Keep serving the stale entry
+                    }
+                    finishRefresh(spec.cache_key);
+                },
+                validators.etag, validators.last_modified);
+        }
+        catch (const std::exception&) {
+            finishRefresh(cache_key);
+        }
+    }
+
+    /**
+     * Serves current weather for lat/lon from the spatial cache: the fresh
+     * entry of the request's own cell, else that of the nearest cell within
+     * the configured radius. Returns null on a miss or with spatial caching
+     * off.
+     */
+    JsonPtr findNearby(const std::string& cache_key, double lat, double lon) {
+        if (spatial_precision == 0) {
+            return JsonPtr();
+        }
+        spatial_lookups++;
+
+        JsonPtr own(client_cache_get(cache, cache_key.c_str()));
+        if (own) {
+            spatial_cell_hits++;
+            return own;
+        }
+        if (!spatial) {
+            return JsonPtr();
+        }
+
+        SpatialMatch matches[8];
+        size_t found = spatial_index_nearby(spatial, lat, lon, spatial_radius_m,
+                                            matches, 8);
+        for (size_t i = 0; i < found; i++) {
+            if (cache_key == matches[i].key) {
+                continue;
+            }
+
+            CacheState state;
+            JsonPtr nearby(client_cache_lookup(cache, matches[i].key, &state, nullptr));
+            if (state == CACHE_FRESH) {
+                spatial_nearby_hits++;
+                return nearby;
+            }
+            if (state == CACHE_MISS) {
+                spatial_index_remove(spatial, matches[i].key, matches[i].lat,
+                                     matches[i].lon);
+            }
+        }
+        return JsonPtr();
+    }
+
+    /**
+     * Makes the cell of lat/lon, cached under cache_key, visible to the
+     * radius search of findNearby
+     */
+    void indexCell(const std::string& cache_key, double lat, double lon) {
+        char cell[GEOHASH_MAX_PRECISION + 1];
+        double center_lat, center_lon;
+        if (!spatial || geohash_encode(lat, lon, spatial_precision, cell) != 0 ||
+            geohash_decode(cell, &center_lat, &center_lon, nullptr, nullptr) != 0) {
+            return;
+        }
+
+        if (spatial_index_insert(spatial, cache_key.c_str(), center_lat, center_lon) != 0) {
+            // Full: start over rather than probe the cache for every cell;
+            // cells in use come back as they are fetched again
+            spatial_index_clear(spatial);
+            spatial_index_insert(spatial, cache_key.c_str(), center_lat, center_lon);
+        }
+    }
+
+    /**
+     * Answers the normalized city query from the cached result of its
+     * longest shorter prefix known to be complete, filtered by city name.
+     * Returns null when no such result is fresh in the cache.
+     */
+    JsonPtr findCities(const std::string& query);
+
+    /**
+     * Records the result of the normalized city query as complete if it is,
+     * so that findCities may answer longer queries from it
+     */
+    void indexCities(const std::string& query, json_t* result);
+
+    static std::string citiesCacheKey(const std::string& query) {
+        return buildCacheKey("cities", "query=" + query);
+    }
+
+private:
+
+    void finishRefresh(const std::string& cache_key) {
+        std::lock_guard<std::mutex> lock(refresh_mutex);
+        refreshing.erase(cache_key);
+    }
+
+    std::mutex clients_mutex;
+    std::vector<HttpClient*> idle_clients;
+
+    std::mutex refresh_mutex;
+    std::unordered_set<std::string> refreshing; // cache keys being refreshed
+
+    std::mutex cities_mutex;
+    std::unordered_set<std::string> complete_queries; // normalized city queries
+
+    std::mutex flights_mutex;
+    // Cache keys being fetched, with the callers waiting for each
+    std::unordered_map<std::string, std::vector<ResponseCallback>> flights;
 };
 
 // WeatherClient implementation
 
 WeatherClient::WeatherClient(const ClientConfig& config)
     : config_(config)
-    , pimpl_(std::make_unique<Impl>(config.timeout_ms)) {
+    , pimpl_(std::make_unique<Impl>(config)) {
 }
 
 WeatherClient::~WeatherClient() = default;
@@ -82,36 +407,12 @@ std::string WeatherClient::buildCacheKey(const std::string& endpoint,
     return endpoint + ":" + params;
 }
 
-JsonPtr WeatherClient::makeRequest(const std::string& url,
-                                   const std::string& cache_key) {
-    // Check cache first
-    char* cached = client_cache_get(pimpl_->cache, cache_key.c_str());
-    if (cached) {
-        json_error_t json_err;
-        json_t* result = json_loads(cached, 0, &json_err);
-        free(cached);
-
-        if (result) {
-            return JsonPtr(result);
-        }
-    }
-
-    // Make HTTP request
-    char* error = nullptr;
-    if (http_client_get(pimpl_->http_client, url.c_str(), &error) != 0) {
-        std::string error_msg = error ? error : "HTTP request failed";
-        if (error) {
-            free(error);
-        }
-        throw WeatherClientException(error_msg);
-    }
-
-    const char* body = http_client_get_body(pimpl_->http_client);
-    if (!body) {
-        throw WeatherClientException("Empty response from server");
-    }
+namespace {
 
-    // Parse JSON
+/**
+ * Parses a response body, turning API-level failures into exceptions
+ */
+JsonPtr parseResponse(const char* body) {
     json_error_t json_err;
     json_t* result = json_loads(body, 0, &json_err);
     if (!result) {
@@ -139,33 +440,389 @@ JsonPtr WeatherClient::makeRequest(const std::string& url,
         }
     }
 
-    // Cache the successful response
-    client_cache_set(pimpl_->cache, cache_key.c_str(), body);
-
     return JsonPtr(result);
 }
 
-JsonPtr WeatherClient::getCurrentWeather(double lat, double lon) {
+/**
+ * Copies response validators (either may be null) into their cache form
+ */
+CacheValidators makeValidators(const char* etag, const char* last_modified) {
+    CacheValidators validators{};
+    std::snprintf(validators.etag, sizeof(validators.etag), "%s", etag ? etag : "");
+    std::snprintf(validators.last_modified, sizeof(validators.last_modified), "%s",
+                  last_modified ? last_modified : "");
+    return validators;
+}
+
+/**
+ * Seconds a response stays fresh: the configured override if any, else what
+ * the server said, else -1 for the cache default
+ */
+time_t entryTtl(int ttl_override_s, long server_freshness) {
+    return ttl_override_s > 0 ? ttl_override_s : server_freshness;
+}
+
+/**
+ * Handles a 304 Not Modified: only a revalidation of cached may get one
+ */
+JsonPtr revalidated(ClientCache* cache, const std::string& cache_key, json_t* cached,
+                    time_t ttl) {
+    if (!cached) {
+        throw WeatherClientException("Unexpected 304 Not Modified");
+    }
+    client_cache_revalidate(cache, cache_key.c_str(), cached, ttl);
+    return JsonPtr(json_incref(cached));
+}
+
+/**
+ * Normalized form of a city search query, as cached
+ */
+std::string normalizeQuery(const std::string& query) {
+    char normalized[256];
+    normalize_string_for_cache(query.c_str(), normalized, sizeof(normalized));
+    return normalized;
+}
+
+/**
+ * The array of city records in a /v1/cities response, or null
+ */
+json_t* cityList(json_t* document) {
+    json_t* data = json_object_get(document, "data");
+    if (json_is_array(data)) {
+        return data;
+    }
+    json_t* cities = json_object_get(data, "cities");
+    return json_is_array(cities) ? cities : nullptr;
+}
+
+/**
+ * Whether the normalized name of city starts with the normalized prefix
+ */
+bool nameStartsWith(json_t* city, const std::string& prefix) {
+    const char* name = json_string_value(json_object_get(city, "name"));
+    if (!name) {
+        return false;
+    }
+    char normalized[256];
+    normalize_string_for_cache(name, normalized, sizeof(normalized));
+    return std::strncmp(normalized, prefix.c_str(), prefix.size()) == 0;
+}
+
+/**
+ * Copy of a /v1/cities response keeping only the cities whose name starts
+ * with prefix. The cached document is left alone: the copy shares its city
+ * records but not the objects leading to them.
+ */
+JsonPtr filterCities(json_t* document, const std::string& prefix) {
+    json_t* cities = cityList(document);
+    json_t* filtered = json_array();
+    size_t index;
+    json_t* city;
+    json_array_foreach(cities, index, city) {
+        if (nameStartsWith(city, prefix)) {
+            json_array_append(filtered, city);
+        }
+    }
+
+    JsonPtr result(json_copy(document));
+    json_t* data = json_object_get(document, "data");
+    if (json_is_array(data)) {
+        json_object_set_new(result.get(), "data", filtered);
+    } else {
+        json_t* data_copy = json_copy(data);
+        json_object_set_new(data_copy, "cities", filtered);
+        if (json_is_integer(json_object_get(data_copy, "count"))) {
+            json_object_set_new(data_copy, "count",
+                                json_integer(static_cast<json_int_t>(json_array_size(filtered))));
+        }
+        json_object_set_new(result.get(), "data", data_copy);
+    }
+    return result;
+}
+
+} // namespace
+
+JsonPtr WeatherClient::Impl::findCities(const std::string& query) {
+    if (cities_page_size == 0) {
+        return JsonPtr();
+    }
+
+    // Longest prefix first: its result is the smallest superset of the answer
+    for (size_t length = query.size(); length-- > 1;) {
+        std::string prefix = query.substr(0, length);
+        {
+            std::lock_guard<std::mutex> lock(cities_mutex);
+            if (complete_queries.count(prefix) == 0) {
+                continue;
+            }
+        }
+
+        CacheState state;
+        JsonPtr cached(client_cache_lookup(cache, citiesCacheKey(prefix).c_str(),
+                                           &state, nullptr));
+        if (state == CACHE_FRESH) {
+            return filterCities(cached.get(), query);
+        }
+        if (state == CACHE_MISS) {
+            std::lock_guard<std::mutex> lock(cities_mutex);
+            complete_queries.erase(prefix);
+        }
+    }
+    return JsonPtr();
+}
+
+void WeatherClient::Impl::indexCities(const std::string& query, json_t* result) {
+    json_t* cities = cityList(result);
+    if (cities_page_size == 0 || !cities || json_array_size(cities) >= cities_page_size) {
+        return;
+    }
+
+    // Filtering by name prefix only reproduces the server if it matched that way
+    size_t index;
+    json_t* city;
+    json_array_foreach(cities, index, city) {
+        if (!nameStartsWith(city, query)) {
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(cities_mutex);
+    if (complete_queries.size() >= cities_max_queries) {
+        // Entries evicted from the cache are dropped as they are found
+        // missing; past that, start over
+        complete_queries.clear();
+    }
+    complete_queries.insert(query);
+}
+
+JsonPtr WeatherClient::Impl::completeRequest(HttpAsyncResult& response,
+                                             const RequestSpec& spec,
+                                             json_t* cached) {
+    if (response.error) {
+        throw WeatherClientException(response.error);
+    }
+    time_t ttl = entryTtl(spec.ttl_override_s, response.freshness);
+    if (response.status_code == 304) {
+        return revalidated(cache, spec.cache_key, cached, ttl);
+    }
+    if (response.status_code < 200 || response.status_code >= 600) {
+        throw WeatherClientException("HTTP " + std::to_string(response.status_code));
+    }
+    if (!response.body) {
+        throw WeatherClientException("Empty response from server");
+    }
+
+    JsonPtr result = parseResponse(response.body);
+    if (!response.no_store) {
+        CacheValidators validators = makeValidators(response.etag, response.last_modified);
+        client_cache_set(cache, spec.cache_key.c_str(), result.get(), response.body,
+                         response.body_size, &validators, ttl);
+    }
+    return result;
+}
+
+JsonPtr WeatherClient::Impl::fetch(const RequestSpec& spec,
+                                   const CacheValidators* validators,
+                                   json_t* cached) {
+    HttpClientLease http(*this);
+    char* error = nullptr;
+    if (http_client_get_conditional(http.get(), spec.url.c_str(),
+                                    validators ? validators->etag : nullptr,
+                                    validators ? validators->last_modified : nullptr,
+                                    &error) != 0) {
+        std::string error_msg = error ? error : "HTTP request failed";
+        if (error) {
+            free(error);
+        }
+        throw WeatherClientException(error_msg);
+    }
+
+    time_t ttl = entryTtl(spec.ttl_override_s, http_client_get_freshness(http.get()));
+    if (http_client_get_status_code(http.get()) == 304) {
+        return revalidated(cache, spec.cache_key, cached, ttl);
+    }
+
+    const char* body = http_client_get_body(http.get());
+    if (!body) {
+        throw WeatherClientException("Empty response from server");
+    }
+
+    JsonPtr result = parseResponse(body);
+
+    // Cache the successful response with what it takes to revalidate it,
+    // unless the server forbids keeping it
+    if (!http_client_get_no_store(http.get())) {
+        CacheValidators received = makeValidators(http_client_get_etag(http.get()),
+                                                  http_client_get_last_modified(http.get()));
+        client_cache_set(cache, spec.cache_key.c_str(), result.get(), body,
+                         http_client_get_body_size(http.get()), &received, ttl);
+    }
+
+    return result;
+}
+
+JsonPtr WeatherClient::makeRequest(const RequestSpec& spec) {
+    const std::string& cache_key = spec.cache_key;
+    // Check cache first: a hit shares the cached document, no parse. A stale
+    // one is returned as well and revalidated behind the caller's back.
+    CacheState state;
+    CacheValidators validators;
+    JsonPtr cached(client_cache_lookup(pimpl_->cache, cache_key.c_str(), &state,
+                                       &validators));
+    if (state == CACHE_FRESH) {
+        return cached;
+    }
+    if (state == CACHE_STALE) {
+        pimpl_->refreshInBackground(spec, validators, cached.get());
+        return cached;
+    }
+
+    // Share an identical request in flight. Waiting is bounded like the
+    // request itself: past that the leader is overdue, so go alone.
+    auto shared = std::make_shared<std::promise<JsonPtr>>();
+    std::future<JsonPtr> outcome = shared->get_future();
+    ResponseCallback waiter = [shared](JsonPtr result, std::exception_ptr error) {
+        if (error) {
+            shared->set_exception(error);
+        } else {
+            shared->set_value(std::move(result));
+        }
+    };
+    // Make HTTP request, conditional if an expired entry can be revalidated
+    const CacheValidators* conditional = state == CACHE_EXPIRED ? &validators : nullptr;
+    if (pimpl_->joinFlight(cache_key, waiter)) {
+        if (outcome.wait_for(std::chrono::milliseconds(pimpl_->timeout_ms)) ==
+            std::future_status::ready) {
+            return outcome.get();
+        }
+        return pimpl_->fetch(spec, conditional, cached.get());
+    }
+
+    JsonPtr result;
+    try {
+        result = pimpl_->landedResult(cache_key);
+        if (!result) {
+            result = pimpl_->fetch(spec, conditional, cached.get());
+        }
+    }
+    catch (...) {
+        pimpl_->landFlight(cache_key, nullptr, std::current_exception());
+        throw;
+    }
+    pimpl_->landFlight(cache_key, result.get(), nullptr);
+    return result;
+}
+
+void WeatherClient::makeRequestAsync(const RequestSpec& spec,
+                                     ResponseCallback callback) {
+    CacheState state;
+    CacheValidators validators;
+    JsonPtr cached(client_cache_lookup(pimpl_->cache, spec.cache_key.c_str(),
+                                       &state, &validators));
+    if (state == CACHE_FRESH || state == CACHE_STALE) {
+        if (state == CACHE_STALE) {
+            pimpl_->refreshInBackground(spec, validators, cached.get());
+        }
+        callback(std::move(cached), nullptr);
+        return;
+    }
+
+    // Capture Impl rather than this: a WeatherClient may be moved while its
+    // requests are in flight, its Impl never is
+    Impl* impl = pimpl_.get();
+    if (impl->joinFlight(spec.cache_key, callback)) {
+        return;
+    }
+    if (JsonPtr landed = impl->landedResult(spec.cache_key)) {
+        impl->landFlight(spec.cache_key, landed.get(), nullptr);
+        callback(std::move(landed), nullptr);
+        return;
+    }
+
+    std::shared_ptr<json_t> expired(cached.release(), json_decref);
+    if (state != CACHE_EXPIRED) {
+        validators = CacheValidators{};
+    }
+
+    try {
+        impl->async->submit(spec.url,
+            [impl, spec, expired, callback = std::move(callback)](
+                    HttpAsyncResult& response) {
+                JsonPtr result;
+                try {
+                    result = impl->completeRequest(response, spec, expired.get());
+                }
+                catch (...) {
+                    impl->landFlight(spec.cache_key, nullptr, std::current_exception());
+                    callback(JsonPtr(), std::current_exception());
+                    return;
+                }
+                impl->landFlight(spec.cache_key, result.get(), nullptr);
+                callback(std::move(result), nullptr);
+            },
+            validators.etag, validators.last_modified);
+    }
+    catch (...) {
+        impl->landFlight(spec.cache_key, nullptr, std::current_exception());
+        throw;
+    }
+}
+
+template <typename Starter>
+std::future<JsonPtr> WeatherClient::toFuture(Starter&& start) {
+    auto promise = std::make_shared<std::promise<JsonPtr>>();
+    std::future<JsonPtr> future = promise->get_future();
+
+    try {
+        start([promise](JsonPtr result, std::exception_ptr error) {
+            if (error) {
+                promise->set_exception(error);
+            } else {
+                promise->set_value(std::move(result));
+            }
+        });
+    }
+    catch (...) {
+        // Argument validation failures surface through the future as well
+        promise->set_exception(std::current_exception());
+    }
+
+    return future;
+}
+
+WeatherClient::RequestSpec WeatherClient::currentWeatherRequest(double lat,
+                                                                double lon) const {
     if (!validate_latitude(lat) || !validate_longitude(lon)) {
         throw WeatherClientException("Invalid coordinates");
     }
 
+    // Spatial caching asks for the center of the cell, which names the entry
+    std::ostringstream params;
+    if (config_.spatial_cache_precision > 0) {
+        char cell[GEOHASH_MAX_PRECISION + 1];
+        if (geohash_encode(lat, lon, config_.spatial_cache_precision, cell) != 0 ||
+            geohash_decode(cell, &lat, &lon, nullptr, nullptr) != 0) {
+            throw WeatherClientException("Invalid coordinates");
+        }
+        params << "cell=" << cell;
+    } else {
+        params << "lat=" << std::fixed << std::setprecision(4) << lat
+               << ":lon=" << std::fixed << std::setprecision(4) << lon;
+    }
+
     std::ostringstream url;
     url << "http://" << config_.host << ":" << config_.port
         << "/v1/current?lat=" << std::fixed << std::setprecision(4) << lat
         << "&lon=" << std::fixed << std::setprecision(4) << lon;
 
-    std::ostringstream params;
-    params << "lat=" << std::fixed << std::setprecision(4) << lat
-           << ":lon=" << std::fixed << std::setprecision(4) << lon;
-
-    std::string cache_key = buildCacheKey("current", params.str());
-    return makeRequest(url.str(), cache_key);
+    return {url.str(), buildCacheKey("current", params.str()),
+            config_.cache_ttl_current_s};
 }
 
-JsonPtr WeatherClient::getWeatherByCity(const std::string& city,
-                                        const std::optional<std::string>& country,
-                                        const std::optional<std::string>& region) {
+WeatherClient::RequestSpec WeatherClient::weatherByCityRequest(
+        const std::string& city,
+        const std::optional<std::string>& country,
+        const std::optional<std::string>& region) const {
     if (!validate_city_name(city.c_str())) {
         throw WeatherClientException("Invalid city name");
     }
@@ -219,11 +876,11 @@ JsonPtr WeatherClient::getWeatherByCity(const std::string& city,
            << ":country=" << normalized_country
            << ":region=" << normalized_region;
 
-    std::string cache_key = buildCacheKey("weather", params.str());
-    return makeRequest(url.str(), cache_key);
+    return {url.str(), buildCacheKey("weather", params.str()),
+            config_.cache_ttl_weather_s};
 }
 
-JsonPtr WeatherClient::searchCities(const std::string& query) {
+WeatherClient::RequestSpec WeatherClient::citiesRequest(const std::string& query) const {
     if (query.length() < 2) {
         throw WeatherClientException("Query must be at least 2 characters");
     }
@@ -240,31 +897,240 @@ JsonPtr WeatherClient::searchCities(const std::string& query) {
     free(query_encoded);
 
     // Normalize query for cache key
-    char normalized_query[256];
-    normalize_string_for_cache(query.c_str(), normalized_query,
-                              sizeof(normalized_query));
+    return {url.str(), Impl::citiesCacheKey(normalizeQuery(query)),
+            config_.cache_ttl_cities_s};
+}
 
-    std::ostringstream params;
-    params << "query=" << normalized_query;
+WeatherClient::RequestSpec WeatherClient::homepageRequest() const {
+    std::ostringstream url;
+    url << "http://" << config_.host << ":" << config_.port << "/";
+
+    return {url.str(), buildCacheKey("homepage", ""), config_.cache_ttl_homepage_s};
+}
+
+JsonPtr WeatherClient::getCurrentWeather(double lat, double lon) {
+    RequestSpec spec = currentWeatherRequest(lat, lon);
+    if (JsonPtr nearby = pimpl_->findNearby(spec.cache_key, lat, lon)) {
+        return nearby;
+    }
+
+    JsonPtr result = makeRequest(spec);
+    pimpl_->indexCell(spec.cache_key, lat, lon);
+    return result;
+}
+
+JsonPtr WeatherClient::getWeatherByCity(const std::string& city,
+                                        const std::optional<std::string>& country,
+                                        const std::optional<std::string>& region) {
+    RequestSpec spec = weatherByCityRequest(city, country, region);
+    return makeRequest(spec);
+}
+
+JsonPtr WeatherClient::searchCities(const std::string& query) {
+    RequestSpec spec = citiesRequest(query);
+    std::string normalized = normalizeQuery(query);
+    if (JsonPtr filtered = pimpl_->findCities(normalized)) {
+        return filtered;
+    }
 
-    std::string cache_key = buildCacheKey("cities", params.str());
-    return makeRequest(url.str(), cache_key);
+    JsonPtr result = makeRequest(spec);
+    pimpl_->indexCities(normalized, result.get());
+    return result;
 }
 
 JsonPtr WeatherClient::getHomepage() {
-    std::ostringstream url;
-    url << "http://" << config_.host << ":" << config_.port << "/";
+    RequestSpec spec = homepageRequest();
+    return makeRequest(spec);
+}
+
+std::future<JsonPtr> WeatherClient::getCurrentWeatherAsync(double lat, double lon) {
+    return toFuture([&](ResponseCallback callback) {
+        getCurrentWeatherAsync(lat, lon, std::move(callback));
+    });
+}
+
+void WeatherClient::getCurrentWeatherAsync(double lat, double lon,
+                                           ResponseCallback callback) {
+    RequestSpec spec = currentWeatherRequest(lat, lon);
+    if (JsonPtr nearby = pimpl_->findNearby(spec.cache_key, lat, lon)) {
+        callback(std::move(nearby), nullptr);
+        return;
+    }
+
+    Impl* impl = pimpl_.get();
+    std::string cache_key = spec.cache_key;
+    makeRequestAsync(spec,
+        [impl, cache_key, lat, lon, callback = std::move(callback)](
+                JsonPtr result, std::exception_ptr error) {
+            if (result) {
+                impl->indexCell(cache_key, lat, lon);
+            }
+            callback(std::move(result), error);
+        });
+}
+
+std::future<JsonPtr> WeatherClient::getWeatherByCityAsync(
+        const std::string& city,
+        const std::optional<std::string>& country,
+        const std::optional<std::string>& region) {
+    return toFuture([&](ResponseCallback callback) {
+        getWeatherByCityAsync(city, country, region, std::move(callback));
+    });
+}
+
+void WeatherClient::getWeatherByCityAsync(const std::string& city,
+                                          const std::optional<std::string>& country,
+                                          const std::optional<std::string>& region,
+                                          ResponseCallback callback) {
+    makeRequestAsync(weatherByCityRequest(city, country, region),
+                     std::move(callback));
+}
+
+std::future<JsonPtr> WeatherClient::searchCitiesAsync(const std::string& query) {
+    return toFuture([&](ResponseCallback callback) {
+        searchCitiesAsync(query, std::move(callback));
+    });
+}
+
+void WeatherClient::searchCitiesAsync(const std::string& query,
+                                      ResponseCallback callback) {
+    RequestSpec spec = citiesRequest(query);
+    std::string normalized = normalizeQuery(query);
+    if (JsonPtr filtered = pimpl_->findCities(normalized)) {
+        callback(std::move(filtered), nullptr);
+        return;
+    }
 
-    std::string cache_key = buildCacheKey("homepage", "");
-    return makeRequest(url.str(), cache_key);
+    Impl* impl = pimpl_.get();
+    makeRequestAsync(spec,
+        [impl, normalized, callback = std::move(callback)](
+                JsonPtr result, std::exception_ptr error) {
+            if (result) {
+                impl->indexCities(normalized, result.get());
+            }
+            callback(std::move(result), error);
+        });
+}
+
+std::future<JsonPtr> WeatherClient::getHomepageAsync() {
+    return toFuture([&](ResponseCallback callback) {
+        getHomepageAsync(std::move(callback));
+    });
+}
+
+void WeatherClient::getHomepageAsync(ResponseCallback callback) {
+    makeRequestAsync(homepageRequest(), std::move(callback));
+}
+
+std::vector<BatchResult> WeatherClient::getCurrentWeatherBatch(
+        const std::vector<Coordinates>& points) {
+    return runBatch(points.size(),
+        [&](size_t i) {
+            return currentWeatherRequest(points[i].lat, points[i].lon).cache_key;
+        },
+        [&](size_t i, ResponseCallback callback) {
+            getCurrentWeatherAsync(points[i].lat, points[i].lon, std::move(callback));
+        });
+}
+
+std::vector<BatchResult> WeatherClient::getWeatherByCityBatch(
+        const std::vector<CityQuery>& cities) {
+    return runBatch(cities.size(),
+        [&](size_t i) {
+            const CityQuery& query = cities[i];
+            return weatherByCityRequest(query.city, query.country, query.region).cache_key;
+        },
+        [&](size_t i, ResponseCallback callback) {
+            const CityQuery& query = cities[i];
+            getWeatherByCityAsync(query.city, query.country, query.region,
+                                  std::move(callback));
+        });
+}
+
+std::vector<BatchResult> WeatherClient::runBatch(
+        size_t count,
+        const std::function<std::string(size_t)>& cache_key,
+        const std::function<void(size_t, ResponseCallback)>& start) {
+    std::vector<BatchResult> results(count);
+
+    // Items sharing a cache key copy the result of the first of them
+    const size_t none = static_cast<size_t>(-1);
+    std::vector<size_t> source(count, none);
+    std::vector<size_t> leaders;
+    std::unordered_map<std::string, size_t> first_by_key;
+    for (size_t i = 0; i < count; i++) {
+        try {
+            auto first = first_by_key.emplace(cache_key(i), i);
+            source[i] = first.first->second;
+            if (first.second) {
+                leaders.push_back(i);
+            }
+        }
+        catch (...) {
+            results[i].error = std::current_exception();
+        }
+    }
+
+    // Completions may outlive this frame's locals by a notify, so they
+    // share the window state instead
+    struct Window {
+        std::mutex mutex;
+        std::condition_variable changed;
+        size_t in_flight = 0;
+    };
+    auto window = std::make_shared<Window>();
+    size_t max_in_flight = std::max<size_t>(config_.batch_max_in_flight, 1);
+
+    for (size_t i : leaders) {
+        {
+            std::unique_lock<std::mutex> lock(window->mutex);
+            window->changed.wait(lock, [&] { return window->in_flight < max_in_flight; });
+            window->in_flight++;
+        }
+
+        // Cache hits complete on this thread, misses on the I/O thread
+        BatchResult* slot = &results[i];
+        try {
+            start(i, [window, slot](JsonPtr result, std::exception_ptr error) {
+                std::lock_guard<std::mutex> lock(window->mutex);
+                slot->result = std::move(result);
+                slot->error = error;
+                window->in_flight--;
+                window->changed.notify_all();
+            });
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(window->mutex);
+            slot->error = std::current_exception();
+            window->in_flight--;
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(window->mutex);
+        window->changed.wait(lock, [&] { return window->in_flight == 0; });
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        size_t first = source[i];
+        if (first == none || first == i) {
+            continue;
+        }
+        if (results[first].result) {
+            results[i].result = JsonPtr(json_incref(results[first].result.get()));
+        }
+        results[i].error = results[first].error;
+    }
+    return results;
 }
 
 JsonPtr WeatherClient::echo() {
     std::ostringstream url;
     url << "http://" << config_.host << ":" << config_.port << "/echo";
 
+    Impl::HttpClientLease http(*pimpl_);
     char* error = nullptr;
-    if (http_client_get(pimpl_->http_client, url.str().c_str(), &error) != 0) {
+    if (http_client_get(http.get(), url.str().c_str(), &error) != 0) {
         std::string error_msg = error ? error : "HTTP request failed";
         if (error) {
             free(error);
@@ -272,7 +1138,7 @@ JsonPtr WeatherClient::echo() {
         throw WeatherClientException(error_msg);
     }
 
-    const char* body = http_client_get_body(pimpl_->http_client);
+    const char* body = http_client_get_body(http.get());
     if (!body) {
         throw WeatherClientException("Empty response");
     }
@@ -287,6 +1153,34 @@ void WeatherClient::clearCache() {
     if (pimpl_ && pimpl_->cache) {
         client_cache_clear(pimpl_->cache);
     }
+    if (pimpl_ && pimpl_->spatial) {
+        spatial_index_clear(pimpl_->spatial);
+    }
+    // The cities prefix index forgets queries as it finds them missing
+}
+
+SpatialCacheStats WeatherClient::getSpatialCacheStats() const {
+    SpatialCacheStats stats;
+    stats.precision = config_.spatial_cache_precision;
+    stats.radius_m = config_.spatial_cache_radius_m;
+    if (stats.precision > 0) {
+        geohash_cell_size(stats.precision, 0.0, &stats.cell_height_m, &stats.cell_width_m);
+    }
+    if (pimpl_) {
+        stats.lookups = pimpl_->spatial_lookups;
+        stats.cell_hits = pimpl_->spatial_cell_hits;
+        stats.nearby_hits = pimpl_->spatial_nearby_hits;
+    }
+    return stats;
+}
+
+RequestStats WeatherClient::getRequestStats() const {
+    RequestStats stats;
+    if (pimpl_) {
+        stats.fetches = pimpl_->fetches;
+        stats.coalesced = pimpl_->coalesced;
+    }
+    return stats;
 }
 
 void WeatherClient::setTimeout(int timeout_ms) {
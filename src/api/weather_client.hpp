@@ -1,10 +1,16 @@
 #pragma once
 
 #include <jansson.h>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
 #include <optional>
 #include <stdexcept>
+#include <vector>
 
 namespace weather {
 
@@ -19,6 +25,9 @@ public:
 
 /**
  * RAII wrapper for jansson json_t objects
+ *
+ * Documents returned by WeatherClient may be shared with its cache and
+ * other callers; treat them as read-only.
  */
 class JsonPtr {
 public:
@@ -71,12 +80,121 @@ struct ClientConfig {
     int port = 10680;
     int timeout_ms = 5000;
 
+    // Keep-alive connection pool (per host:port)
+    int pool_max_idle = 4;
+    int pool_idle_timeout_ms = 30000;
+    int pool_max_age_ms = 300000;
+
+    // In-memory response cache
+    size_t cache_max_entries = 50;
+    // Seconds a cached response is fresh, and after which it is dropped. In
+    // between it is served stale while one background request refreshes it.
+    int cache_soft_ttl_s = 300;
+    int cache_hard_ttl_s = 3600;
+    // Bytes of disk writes queued behind responses; 0 writes synchronously
+    size_t cache_write_behind_bytes = 1024 * 1024;
+    // Per-endpoint fresh time in seconds, overriding the server's
+    // Cache-Control / Expires. 0 follows the server, or cache_soft_ttl_s if
+    // it says nothing. Responses marked no-store are never cached.
+    int cache_ttl_current_s = 0;
+    int cache_ttl_weather_s = 0;
+    int cache_ttl_cities_s = 0;
+    int cache_ttl_homepage_s = 0;
+
+    // Spatial cache for current weather. Coordinates are snapped to the
+    // geohash cell of this many characters (1-12; 7 is about 150 x 150 m,
+    // 8 about 38 x 19 m) and requested at its center, so fixes within a cell
+    // share an entry. 0 keeps coordinates exact.
+    int spatial_cache_precision = 0;
+    // Also serve the fresh entry of any cell whose center lies within this
+    // many meters of the request; 0 only shares entries within a cell
+    double spatial_cache_radius_m = 0;
+    // Cells the radius search keeps track of
+    size_t spatial_cache_max_cells = 4096;
+
+    // Requests a batch call keeps in flight at once, each on a connection
+    // of its own
+    size_t batch_max_in_flight = 16;
+
+    // Local prefix index for city search: a query that extends an earlier
+    // one whose result was complete is answered by filtering that cached
+    // result by city name, without a request. A result is complete when it
+    // holds fewer cities than this, the most the server returns per query,
+    // and every name in it starts with its query; 0 disables the index.
+    size_t cities_page_size = 10;
+
     ClientConfig() = default;
     ClientConfig(const std::string& h, int p) : host(h), port(p) {}
 };
 
+/**
+ * Spatial cache counters for current weather, alongside the cell size they
+ * were measured with (see ClientConfig::spatial_cache_precision)
+ */
+struct SpatialCacheStats {
+    int precision = 0;
+    double cell_height_m = 0;
+    double cell_width_m = 0; // at the equator; cells narrow towards the poles
+    double radius_m = 0;
+    uint64_t lookups = 0;
+    uint64_t cell_hits = 0;   // fresh entry for the request's own cell
+    uint64_t nearby_hits = 0; // fresh entry of another cell within radius_m
+
+    double hitRate() const {
+        return lookups ? static_cast<double>(cell_hits + nearby_hits) / lookups : 0.0;
+    }
+};
+
+/**
+ * Requests that missed the cache: those sent to the server, and those that
+ * found an identical request in flight and shared its result instead
+ */
+struct RequestStats {
+    uint64_t fetches = 0;
+    uint64_t coalesced = 0;
+};
+
+/**
+ * One point of a getCurrentWeatherBatch() call
+ */
+struct Coordinates {
+    double lat = 0;
+    double lon = 0;
+};
+
+/**
+ * One city of a getWeatherByCityBatch() call
+ */
+struct CityQuery {
+    std::string city;
+    std::optional<std::string> country;
+    std::optional<std::string> region;
+};
+
+/**
+ * Outcome of one item of a batch call: exactly one of result and error is
+ * set, error holding the WeatherClientException the single call would
+ * have thrown
+ */
+struct BatchResult {
+    JsonPtr result;
+    std::exception_ptr error;
+};
+
+/**
+ * Completion callback for asynchronous requests: exactly one of result and
+ * error is set. On a cache hit it runs immediately on the calling thread,
+ * otherwise on the thread that completed the request it was coalesced with
+ * (the client's I/O thread for asynchronous ones), where it must not block.
+ */
+using ResponseCallback = std::function<void(JsonPtr result, std::exception_ptr error)>;
+
 /**
  * Main weather client class using OOP principles
+ *
+ * One instance may be shared by any number of threads: synchronous calls
+ * each lease their own HTTP state, all of it backed by one connection pool
+ * and one lock-striped cache.
  */
 class WeatherClient {
 public:
@@ -121,7 +239,9 @@ public:
                              const std::optional<std::string>& region = std::nullopt);
 
     /**
-     * Search for cities by query
+     * Search for cities by query. Extending a query whose cached result was
+     * complete (see ClientConfig::cities_page_size) filters that result
+     * locally instead of asking the server.
      * @param query Search query (minimum 2 characters)
      * @return JSON response wrapped in JsonPtr
      * @throws WeatherClientException on error
@@ -135,6 +255,39 @@ public:
      */
     JsonPtr getHomepage();
 
+    /**
+     * Asynchronous variants of the calls above. Requests overlap on a single
+     * I/O thread owned by the client (started on first use); the future
+     * overloads hold the result or the WeatherClientException, the callback
+     * overloads hand either to callback.
+     */
+    std::future<JsonPtr> getCurrentWeatherAsync(double lat, double lon);
+    void getCurrentWeatherAsync(double lat, double lon, ResponseCallback callback);
+
+    std::future<JsonPtr> getWeatherByCityAsync(const std::string& city,
+                                               const std::optional<std::string>& country = std::nullopt,
+                                               const std::optional<std::string>& region = std::nullopt);
+    void getWeatherByCityAsync(const std::string& city,
+                               const std::optional<std::string>& country,
+                               const std::optional<std::string>& region,
+                               ResponseCallback callback);
+
+    std::future<JsonPtr> searchCitiesAsync(const std::string& query);
+    void searchCitiesAsync(const std::string& query, ResponseCallback callback);
+
+    std::future<JsonPtr> getHomepageAsync();
+    void getHomepageAsync(ResponseCallback callback);
+
+    /**
+     * Batch variants of getCurrentWeather and getWeatherByCity. Items that
+     * share a cache key are fetched once, cache hits are served at once, and
+     * the misses are spread over at most ClientConfig::batch_max_in_flight
+     * concurrent requests. Returns one result per item, in input order; a
+     * failed item does not affect the others.
+     */
+    std::vector<BatchResult> getCurrentWeatherBatch(const std::vector<Coordinates>& points);
+    std::vector<BatchResult> getWeatherByCityBatch(const std::vector<CityQuery>& cities);
+
     /**
      * Echo test endpoint
      * @return JSON response wrapped in JsonPtr
@@ -147,6 +300,17 @@ public:
      */
     void clearCache();
 
+    /**
+     * Spatial cache counters since the client was created; all zero unless
+     * ClientConfig::spatial_cache_precision is set
+     */
+    SpatialCacheStats getSpatialCacheStats() const;
+
+    /**
+     * Fetch and coalescing counters since the client was created
+     */
+    RequestStats getRequestStats() const;
+
     /**
      * Set request timeout
      * @param timeout_ms Timeout in milliseconds
@@ -167,6 +331,15 @@ private:
     ClientConfig config_;
     std::unique_ptr<Impl> pimpl_;
 
+    /**
+     * URL, cache key and configured fresh time (0 for none) of one API call
+     */
+    struct RequestSpec {
+        std::string url;
+        std::string cache_key;
+        int ttl_override_s = 0;
+    };
+
     /**
      * Helper method to build cache keys
      */
@@ -174,10 +347,41 @@ private:
                                      const std::string& params);
 
     /**
-     * Helper method to make HTTP requests with caching
+     * Validate arguments and build the request for each endpoint
+     * @throws WeatherClientException on invalid arguments
+     */
+    RequestSpec currentWeatherRequest(double lat, double lon) const;
+    RequestSpec weatherByCityRequest(const std::string& city,
+                                     const std::optional<std::string>& country,
+                                     const std::optional<std::string>& region) const;
+    RequestSpec citiesRequest(const std::string& query) const;
+    RequestSpec homepageRequest() const;
+
+    /**
+     * Helper method to make HTTP requests with caching. Concurrent misses
+     * for one cache key, synchronous or not, share a single request.
+     */
+    JsonPtr makeRequest(const RequestSpec& spec);
+
+    /**
+     * Asynchronous counterpart of makeRequest
+     */
+    void makeRequestAsync(const RequestSpec& spec, ResponseCallback callback);
+
+    /**
+     * Runs count batch items: cache_key(i) names item i (throwing if it is
+     * invalid) and start(i, callback) begins it asynchronously
+     */
+    std::vector<BatchResult> runBatch(
+        size_t count,
+        const std::function<std::string(size_t)>& cache_key,
+        const std::function<void(size_t, ResponseCallback)>& start);
+
+    /**
+     * Adapts a callback-based request to a future
      */
-    JsonPtr makeRequest(const std::string& url,
-                       const std::string& cache_key);
+    template <typename Starter>
+    static std::future<JsonPtr> toFuture(Starter&& start);
 };
 
 } // namespace weather
@@ -1,9 +1,10 @@
 #include "cli.hpp"
 #include "command.hpp"
 #include "command_parser.hpp"
+#include "commands/batch_command.hpp"
 
 #include <iostream>
-#include <sstream>
+#include <stdexcept>
 #include <vector>
 
 CLI::CLI(weather::WeatherClient& client)
@@ -23,22 +24,28 @@ void CLI::printUsageStatic(const std::string& p) {
         "  " << p << " homepage\n"
         "  " << p << " echo\n"
         "  " << p << " clear-cache\n"
+        "  " << p << " batch [--jobs N] [--order input|completion] [file]\n"
+        "                 # One command per line of file or stdin, NDJSON out\n"
+        "  " << p << " bench [--duration S] [--concurrency N] [--mix current=W,weather=W,cities=W]\n"
+        "                 [--hit-ratio R] [--keys N] [--json]\n"
+        "                 [--rate R] [--ramp FROM:TO:STEPS] [--arrival fixed|poisson]\n"
+        "                 [--max-in-flight N]\n"
+        "                 # Measure client throughput and latency percentiles;\n"
+        "                 # with a rate or ramp, open loop at that request rate\n"
+        "  " << p << " daemon [--socket <path>]\n"
+        "                 # Keep cache and connections warm for the commands\n"
+        "                 # above, which use the daemon while it runs\n"
         "  " << p << " interactive    # Enter interactive mode\n\n"
         "Examples:\n"
         "  " << p << " current 59.33 18.07\n"
         "  " << p << " weather Stockholm SE\n"
         "  " << p << " cities Stock\n"
+        "  " << p << " batch --jobs 8 < commands.txt\n"
+        "  " << p << " bench --duration 5 --concurrency 16 --json\n"
+        "  " << p << " bench --ramp 500:4000:8 --duration 3 --arrival poisson\n"
         "  " << p << " interactive\n";
 }
 
-static std::vector<std::string> split(const std::string& s) {
-    std::istringstream iss{s};
-    std::vector<std::string> tokens;
-    std::string t;
-    while (iss >> t) tokens.push_back(t);
-    return tokens;
-}
-
 void CLI::runInteractive() {
     std::string line;
 
@@ -67,6 +74,8 @@ void CLI::runInteractive() {
             std::cout << "  homepage                        - Get API homepage\n";
             std::cout << "  echo                            - Test echo endpoint\n";
             std::cout << "  clear-cache                     - Clear client cache\n";
+            std::cout << "  batch [--jobs N] [--order input|completion] <file>\n";
+            std::cout << "                                  - Run the commands in file, NDJSON out\n";
             std::cout << "  help                            - Show this help\n";
             std::cout << "  quit / exit / q                 - Exit interactive mode\n\n";
             std::cout << "Examples:\n";
@@ -77,9 +86,18 @@ void CLI::runInteractive() {
         }
 
         try {
-            auto tokens = split(line);
+            auto tokens = CommandParser::tokenize(line);
             if (!tokens.empty()) {
                 auto cmd = CommandParser::parse(client_, tokens);
+
+                // stdin is this session's own input, not a list of commands
+                auto* batch = dynamic_cast<BatchCommand*>(cmd.get());
+                if (batch && batch->readsStdin()) {
+                    throw std::invalid_argument(
+                        "batch needs a file in interactive mode: "
+                        "batch [--jobs N] [--order input|completion] <file>");
+                }
+
                 cmd->execute();
             }
         }
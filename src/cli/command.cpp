@@ -0,0 +1,24 @@
+#include "command.hpp"
+
+#include <iostream>
+#include <jansson.h>
+#include <stdexcept>
+
+void Command::execute() {
+    auto json = run();
+    std::cout << render(json) << std::endl;
+}
+
+weather::JsonPtr Command::run() {
+    throw std::logic_error("Command has no JSON result");
+}
+
+std::string Command::render(const weather::JsonPtr& result) const {
+    char* json_str = json_dumps(result.get(), JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+    if (!json_str) {
+        throw std::runtime_error("Failed to serialize JSON");
+    }
+    std::string text = json_str;
+    free(json_str);
+    return text;
+}
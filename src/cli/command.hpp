@@ -1,7 +1,26 @@
 #pragma once
 
+#include "../api/weather_client.hpp"
+
+#include <string>
+
 class Command {
 public:
     virtual ~Command() = default;
-    virtual void execute() = 0;
+
+    /**
+     * Runs the command and prints its result
+     */
+    virtual void execute();
+
+    /**
+     * Runs the command and returns its result as JSON, for batch mode
+     * @throws std::logic_error for commands without one
+     */
+    virtual weather::JsonPtr run();
+
+    /**
+     * Text execute() prints for result: the JSON, pretty-printed
+     */
+    virtual std::string render(const weather::JsonPtr& result) const;
 };
@@ -5,9 +5,23 @@
 #include "commands/homepage_command.hpp"
 #include "commands/echo_command.hpp"
 #include "commands/clear_cache_command.hpp"
+#include "commands/batch_command.hpp"
+#include "commands/bench_command.hpp"
+#include "commands/daemon_command.hpp"
+#include "daemon.hpp"
 
+#include <cstdio>
+#include <sstream>
 #include <stdexcept>
 
+std::vector<std::string> CommandParser::tokenize(const std::string& line) {
+    std::istringstream iss{line};
+    std::vector<std::string> tokens;
+    std::string t;
+    while (iss >> t) tokens.push_back(t);
+    return tokens;
+}
+
 std::unique_ptr<Command>
 CommandParser::parse(weather::WeatherClient& client,
                      const std::vector<std::string>& t) {
@@ -63,5 +77,98 @@ CommandParser::parse(weather::WeatherClient& client,
         return std::make_unique<ClearCacheCommand>(client);
     }
 
+    if (cmd == "batch") {
+        const char* usage = "Usage: batch [--jobs N] [--order input|completion] [file]";
+        int jobs = 4;
+        BatchCommand::Order order = BatchCommand::Order::Input;
+        std::string path;
+
+        for (size_t i = 1; i < t.size(); ++i) {
+            if (t[i] == "--jobs" && i + 1 < t.size()) {
+                jobs = std::stoi(t[++i]);
+                if (jobs < 1 || jobs > 1024)
+                    throw std::invalid_argument(usage);
+            } else if (t[i] == "--order" && i + 1 < t.size()) {
+                const std::string& value = t[++i];
+                if (value == "input")
+                    order = BatchCommand::Order::Input;
+                else if (value == "completion")
+                    order = BatchCommand::Order::Completion;
+                else
+                    throw std::invalid_argument(usage);
+            } else if (path.empty() && t[i].rfind("--", 0) != 0) {
+                path = t[i];
+            } else {
+                throw std::invalid_argument(usage);
+            }
+        }
+
+        return std::make_unique<BatchCommand>(client, path, jobs, order);
+    }
+
+    if (cmd == "bench") {
+        const char* usage = "Usage: bench [--duration S] [--concurrency N] "
+                            "[--mix current=W,weather=W,cities=W] [--hit-ratio R] "
+                            "[--keys N] [--rate R] [--ramp FROM:TO:STEPS] "
+                            "[--arrival fixed|poisson] [--max-in-flight N] [--json]";
+        BenchOptions options;
+
+        for (size_t i = 1; i < t.size(); ++i) {
+            bool has_value = i + 1 < t.size();
+            if (t[i] == "--json") {
+                options.json = true;
+            } else if (t[i] == "--duration" && has_value) {
+                options.duration_s = std::stod(t[++i]);
+            } else if (t[i] == "--concurrency" && has_value) {
+                options.concurrency = std::stoi(t[++i]);
+            } else if (t[i] == "--mix" && has_value) {
+                options.parseMix(t[++i]);
+            } else if (t[i] == "--hit-ratio" && has_value) {
+                options.hit_ratio = std::stod(t[++i]);
+            } else if (t[i] == "--keys" && has_value) {
+                options.hot_keys = std::stoul(t[++i]);
+            } else if (t[i] == "--rate" && has_value) {
+                options.rate = std::stod(t[++i]);
+            } else if (t[i] == "--ramp" && has_value) {
+                char extra;
+                if (std::sscanf(t[++i].c_str(), "%lf:%lf:%d%c", &options.rate,
+                                &options.ramp_to_rate, &options.ramp_steps, &extra) != 3)
+                    throw std::invalid_argument(usage);
+            } else if (t[i] == "--arrival" && has_value) {
+                const std::string& arrival = t[++i];
+                if (arrival == "fixed")
+                    options.arrival = BenchOptions::Arrival::Fixed;
+                else if (arrival == "poisson")
+                    options.arrival = BenchOptions::Arrival::Poisson;
+                else
+                    throw std::invalid_argument(usage);
+            } else if (t[i] == "--max-in-flight" && has_value) {
+                options.max_in_flight = std::stoul(t[++i]);
+            } else {
+                throw std::invalid_argument(usage);
+            }
+        }
+        if (!(options.duration_s > 0) || options.concurrency < 1 ||
+            options.concurrency > 4096 || !(options.hit_ratio >= 0) ||
+            options.hit_ratio > 1 || options.hot_keys < 1 || options.hot_keys > 100000 ||
+            !(options.rate >= 0) || options.rate > 1e6 || options.ramp_steps < 1 ||
+            options.ramp_steps > 100 || options.max_in_flight < 1 ||
+            (options.ramp_steps > 1 &&
+             (!(options.rate > 0) || !(options.ramp_to_rate > 0) || options.ramp_to_rate > 1e6)))
+            throw std::invalid_argument(usage);
+
+        return std::make_unique<BenchCommand>(client, options);
+    }
+
+    if (cmd == "daemon") {
+        std::string path = Daemon::socketPath();
+        if (t.size() == 3 && t[1] == "--socket")
+            path = t[2];
+        else if (t.size() != 1)
+            throw std::invalid_argument("Usage: daemon [--socket <path>]");
+
+        return std::make_unique<DaemonCommand>(client, path);
+    }
+
     throw std::invalid_argument("Unknown command: " + cmd);
 }
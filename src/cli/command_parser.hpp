@@ -15,4 +15,9 @@ public:
     static std::unique_ptr<Command>
     parse(weather::WeatherClient& client,
           const std::vector<std::string>& tokens);
+
+    /**
+     * Splits a command line into whitespace-separated tokens
+     */
+    static std::vector<std::string> tokenize(const std::string& line);
 };
@@ -0,0 +1,172 @@
+#include "batch_command.hpp"
+#include "../command_parser.hpp"
+#include "../../api/weather_client.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <jansson.h>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Records a worker may run ahead of the oldest unprinted one in input
+// order, per job; bounds what is buffered behind a slow command
+constexpr size_t kReorderWindowPerJob = 256;
+// Distinct error messages listed in the summary
+constexpr size_t kSummaryErrors = 10;
+
+} // namespace
+
+BatchCommand::BatchCommand(weather::WeatherClient& c, const std::string& path,
+                           int jobs, Order order)
+    : client_(c), path_(path), jobs_(jobs), order_(order) {}
+
+std::string BatchCommand::runLine(size_t line_number, const std::string& line,
+                                  bool& ok, std::string& error) {
+    json_t* record = json_object();
+    json_object_set_new(record, "line", json_integer(static_cast<json_int_t>(line_number)));
+    json_object_set_new(record, "command", json_string(line.c_str()));
+
+    try {
+        auto tokens = CommandParser::tokenize(line);
+        if (tokens[0] == "batch" || tokens[0] == "interactive") {
+            throw std::invalid_argument("Not available in batch mode: " + tokens[0]);
+        }
+        auto result = CommandParser::parse(client_, tokens)->run();
+        json_object_set_new(record, "ok", json_true());
+        json_object_set(record, "result", result.get());
+        ok = true;
+    }
+    catch (const std::exception& e) {
+        json_object_set_new(record, "ok", json_false());
+        json_object_set_new(record, "error", json_string(e.what()));
+        error = e.what();
+        ok = false;
+    }
+
+    std::string out;
+    char* json_str = json_dumps(record, JSON_COMPACT | JSON_PRESERVE_ORDER);
+    if (json_str) {
+        out = json_str;
+        free(json_str);
+    }
+    json_decref(record);
+    return out;
+}
+
+void BatchCommand::execute() {
+    std::ifstream file;
+    std::istream* in = &std::cin;
+    if (!path_.empty()) {
+        file.open(path_);
+        if (!file) {
+            throw std::invalid_argument("Cannot open " + path_);
+        }
+        in = &file;
+    }
+
+    std::mutex mutex;
+    std::condition_variable printed;
+    size_t line_number = 0;  // lines read
+    size_t next_sequence = 0; // commands started
+    size_t next_print = 0;    // oldest command not printed, in input order
+    std::map<size_t, std::string> finished; // records waiting for next_print
+    size_t succeeded = 0;
+    std::map<std::string, size_t> errors; // failures by message
+    const size_t window = kReorderWindowPerJob * static_cast<size_t>(jobs_);
+
+    auto worker = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            printed.wait(lock, [&] {
+                return order_ == Order::Completion || next_sequence - next_print < window;
+            });
+
+            std::string line;
+            size_t number = 0;
+            while (std::getline(*in, line)) {
+                number = ++line_number;
+                size_t start = line.find_first_not_of(" \t\r");
+                if (start != std::string::npos && line[start] != '#') {
+                    line.erase(line.find_last_not_of(" \t\r") + 1);
+                    break;
+                }
+                number = 0;
+            }
+            if (number == 0) {
+                return;
+            }
+            size_t sequence = next_sequence++;
+
+            lock.unlock();
+            bool ok = false;
+            std::string error;
+            std::string record = runLine(number, line, ok, error);
+            lock.lock();
+
+            if (ok) {
+                succeeded++;
+            } else {
+                errors[error]++;
+            }
+
+            if (order_ == Order::Completion) {
+                std::cout << record << '\n';
+                continue;
+            }
+            finished.emplace(sequence, std::move(record));
+            while (!finished.empty() && finished.begin()->first == next_print) {
+                std::cout << finished.begin()->second << '\n';
+                finished.erase(finished.begin());
+                next_print++;
+            }
+            printed.notify_all();
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < jobs_; i++) {
+        workers.emplace_back(worker);
+    }
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    std::cout.flush();
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    // Summary
+    size_t failed = next_sequence - succeeded;
+    weather::RequestStats stats = client_.getRequestStats();
+    std::fprintf(stderr,
+                 "batch: %zu commands in %.3f s (%.1f/s) with %d jobs: %zu ok, %zu failed; "
+                 "%llu fetched, %llu coalesced\n",
+                 next_sequence, seconds, seconds > 0 ? next_sequence / seconds : 0.0, jobs_,
+                 succeeded, failed, static_cast<unsigned long long>(stats.fetches),
+                 static_cast<unsigned long long>(stats.coalesced));
+
+    std::vector<std::pair<std::string, size_t>> by_count(errors.begin(), errors.end());
+    std::stable_sort(by_count.begin(), by_count.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+    for (size_t i = 0; i < by_count.size() && i < kSummaryErrors; i++) {
+        std::fprintf(stderr, "  %6zu x %s\n", by_count[i].second, by_count[i].first.c_str());
+    }
+    if (by_count.size() > kSummaryErrors) {
+        std::fprintf(stderr, "  ... %zu more distinct errors\n",
+                     by_count.size() - kSummaryErrors);
+    }
+
+    if (failed > 0) {
+        throw std::runtime_error(std::to_string(failed) + " batch commands failed");
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../command.hpp"
+#include <cstddef>
+#include <string>
+
+namespace weather {
+    class WeatherClient;
+}
+
+/**
+ * Runs one command per line of a file or stdin, jobs of them at a time on
+ * one shared client, printing one NDJSON record per command:
+ *
+ *   {"line": 3, "command": "current 59.33 18.07", "ok": true, "result": {...}}
+ *   {"line": 4, "command": "current 999 0", "ok": false, "error": "..."}
+ *
+ * Blank lines and lines starting with '#' are skipped. Commands overlap,
+ * so one such as clear-cache takes effect somewhere among its neighbours.
+ * A summary of throughput and errors goes to stderr at the end.
+ */
+class BatchCommand final : public Command {
+public:
+    enum class Order {
+        Input,      // records in the order of their lines
+        Completion  // records as soon as their command finishes
+    };
+
+    BatchCommand(weather::WeatherClient& client, const std::string& path,
+                 int jobs, Order order);
+
+    /**
+     * @throws std::runtime_error if any command failed, after the summary
+     */
+    void execute() override;
+
+    /**
+     * True when the commands come from stdin rather than a file
+     */
+    bool readsStdin() const { return path_.empty(); }
+
+private:
+    /**
+     * Runs the command on one line and returns its record
+     */
+    std::string runLine(size_t line_number, const std::string& line, bool& ok,
+                        std::string& error);
+
+    weather::WeatherClient& client_;
+    std::string path_;  // empty for stdin
+    int jobs_;
+    Order order_;
+};
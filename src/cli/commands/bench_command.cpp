@@ -0,0 +1,514 @@
+#include "bench_command.hpp"
+#include "../latency_histogram.hpp"
+#include "../../api/weather_client.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+enum Kind { kCurrent, kWeather, kCities, kKinds };
+enum Path { kHit, kMiss, kPaths };
+
+const char* const kKindNames[kKinds] = {"current", "weather", "cities"};
+const char* const kPathNames[kPaths] = {"hit", "miss"};
+
+// Distinct points pointFor() spreads keys over: 0.01 degree steps, far
+// enough apart to get separate cache entries
+constexpr uint64_t kLatSteps = 16000;
+constexpr uint64_t kLonSteps = 35800;
+
+struct CaseStats {
+    LatencyHistogram latency;
+    uint64_t errors = 0;
+};
+
+using Stats = std::array<std::array<CaseStats, kPaths>, kKinds>;
+
+weather::Coordinates pointFor(uint64_t n) {
+    n %= kLatSteps * kLonSteps;
+    return {-80.0 + static_cast<double>(n % kLatSteps) * 0.01,
+            -179.0 + static_cast<double>(n / kLatSteps) * 0.01};
+}
+
+/**
+ * Name of key n of a kind; fixed width, so no name is a prefix of another
+ * and the cities prefix index cannot answer a cold query from a hot one
+ */
+std::string nameFor(const char* prefix, uint64_t n) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%012llu", prefix, static_cast<unsigned long long>(n));
+    return name;
+}
+
+void call(weather::WeatherClient& client, Kind kind, Path path, uint64_t n) {
+    switch (kind) {
+    case kCurrent: {
+        weather::Coordinates point = pointFor(n);
+        client.getCurrentWeather(point.lat, point.lon);
+        break;
+    }
+    case kWeather:
+        client.getWeatherByCity(nameFor(path == kHit ? "Benchhot" : "Benchcold", n));
+        break;
+    default:
+        client.searchCities(nameFor(path == kHit ? "benchhot" : "benchcold", n));
+        break;
+    }
+}
+
+void callAsync(weather::WeatherClient& client, Kind kind, Path path, uint64_t n,
+               weather::ResponseCallback callback) {
+    switch (kind) {
+    case kCurrent: {
+        weather::Coordinates point = pointFor(n);
+        client.getCurrentWeatherAsync(point.lat, point.lon, std::move(callback));
+        break;
+    }
+    case kWeather:
+        client.getWeatherByCityAsync(nameFor(path == kHit ? "Benchhot" : "Benchcold", n),
+                                     std::nullopt, std::nullopt, std::move(callback));
+        break;
+    default:
+        client.searchCitiesAsync(nameFor(path == kHit ? "benchhot" : "benchcold", n),
+                                 std::move(callback));
+        break;
+    }
+}
+
+uint64_t elapsedNs(std::chrono::steady_clock::time_point since,
+                   std::chrono::steady_clock::time_point until) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(until - since).count());
+}
+
+std::string formatNs(uint64_t ns) {
+    char text[32];
+    if (ns < 1000) {
+        std::snprintf(text, sizeof(text), "%llu ns", static_cast<unsigned long long>(ns));
+    } else if (ns < 1000000) {
+        std::snprintf(text, sizeof(text), "%.1f us", ns / 1e3);
+    } else if (ns < 1000000000) {
+        std::snprintf(text, sizeof(text), "%.2f ms", ns / 1e6);
+    } else {
+        std::snprintf(text, sizeof(text), "%.2f s", ns / 1e9);
+    }
+    return text;
+}
+
+void printCase(const BenchOptions& options, const std::string& name, const CaseStats& stats,
+               double seconds) {
+    const LatencyHistogram& latency = stats.latency;
+    double rate = seconds > 0 ? latency.count() / seconds : 0.0;
+    if (options.json) {
+        std::printf("{\"bench\":\"client\",\"case\":\"%s\",\"concurrency\":%d,"
+                    "\"duration_s\":%.3f,\"requests\":%llu,\"errors\":%llu,"
+                    "\"req_per_s\":%.1f,\"mean_us\":%.3f,\"p50_us\":%.3f,"
+                    "\"p90_us\":%.3f,\"p99_us\":%.3f,\"p999_us\":%.3f,\"max_us\":%.3f}\n",
+                    name.c_str(), options.concurrency, seconds,
+                    static_cast<unsigned long long>(latency.count()),
+                    static_cast<unsigned long long>(stats.errors), rate,
+                    latency.mean() / 1e3, latency.percentile(50) / 1e3,
+                    latency.percentile(90) / 1e3, latency.percentile(99) / 1e3,
+                    latency.percentile(99.9) / 1e3, latency.max() / 1e3);
+        return;
+    }
+    std::printf("  %-14s %10llu %8llu %11.1f %10s %10s %10s %10s %10s\n", name.c_str(),
+                static_cast<unsigned long long>(latency.count()),
+                static_cast<unsigned long long>(stats.errors), rate,
+                formatNs(latency.percentile(50)).c_str(),
+                formatNs(latency.percentile(90)).c_str(),
+                formatNs(latency.percentile(99)).c_str(),
+                formatNs(latency.percentile(99.9)).c_str(),
+                formatNs(latency.max()).c_str());
+}
+
+} // namespace
+
+void BenchOptions::parseMix(const std::string& mix) {
+    unsigned weights[kKinds] = {0, 0, 0};
+    std::istringstream items{mix};
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t eq = item.find('=');
+        const char* const* kind = std::find(kKindNames, kKindNames + kKinds,
+                                            item.substr(0, eq));
+        if (eq == std::string::npos || kind == kKindNames + kKinds) {
+            throw std::invalid_argument("Invalid mix entry: " + item);
+        }
+        weights[kind - kKindNames] = static_cast<unsigned>(std::stoul(item.substr(eq + 1)));
+    }
+    if (weights[kCurrent] + weights[kWeather] + weights[kCities] == 0) {
+        throw std::invalid_argument("Mix needs a positive weight");
+    }
+    weight_current = weights[kCurrent];
+    weight_weather = weights[kWeather];
+    weight_cities = weights[kCities];
+}
+
+/**
+ * Which calls a run makes: kind by weight, hot or cold key by hit ratio
+ */
+struct BenchCommand::Workload {
+    struct Call {
+        Kind kind;
+        Path path;
+        uint64_t n;
+    };
+
+    Workload(const BenchOptions& options, uint64_t cold_base)
+        : weights{options.weight_current, options.weight_weather, options.weight_cities}
+        , total_weight(weights[kCurrent] + weights[kWeather] + weights[kCities])
+        , hit_ratio(options.hit_ratio)
+        , hot_keys(options.hot_keys)
+        , cold_base(cold_base) {}
+
+    Call pick(std::mt19937_64& rng) {
+        unsigned weight = static_cast<unsigned>(rng() % total_weight);
+        Kind kind = weight < weights[kCurrent] ? kCurrent
+                  : weight < weights[kCurrent] + weights[kWeather] ? kWeather
+                  : kCities;
+        Path path = std::uniform_real_distribution<double>(0.0, 1.0)(rng) < hit_ratio
+                  ? kHit : kMiss;
+        uint64_t n = path == kHit ? rng() % hot_keys : cold_base + cold_next++;
+        return {kind, path, n};
+    }
+
+    unsigned weights[kKinds];
+    unsigned total_weight;
+    double hit_ratio;
+    size_t hot_keys;
+    // Cold keys continue past the hot ones, from a point of their own each
+    // run so that they miss the disk cache too
+    uint64_t cold_base;
+    std::atomic<uint64_t> cold_next{0};
+};
+
+BenchCommand::BenchCommand(weather::WeatherClient& c, const BenchOptions& options)
+    : client_(c), options_(options) {}
+
+void BenchCommand::execute() {
+    const BenchOptions& o = options_;
+
+    // A client of its own, with room for every hot key between two uses
+    // of it, so that hits stay hits
+    weather::ClientConfig config = client_.getConfig();
+    size_t hot_total = o.hot_keys * kKinds;
+    config.cache_max_entries = std::max(
+        config.cache_max_entries,
+        static_cast<size_t>(2 * hot_total / std::max(o.hit_ratio, 0.01)) + 1024);
+    weather::WeatherClient client(config);
+
+    // Warm-up: cache every hot key
+    std::vector<weather::Coordinates> points;
+    std::vector<weather::CityQuery> cities;
+    std::vector<std::future<weather::JsonPtr>> searches;
+    for (size_t i = 0; i < o.hot_keys; i++) {
+        points.push_back(pointFor(i));
+        cities.push_back({nameFor("Benchhot", i), std::nullopt, std::nullopt});
+        if (o.weight_cities > 0) {
+            searches.push_back(client.searchCitiesAsync(nameFor("benchhot", i)));
+        }
+    }
+    std::vector<weather::BatchResult> warm;
+    if (o.weight_current > 0) {
+        warm = client.getCurrentWeatherBatch(points);
+    }
+    if (o.weight_weather > 0) {
+        std::vector<weather::BatchResult> more = client.getWeatherByCityBatch(cities);
+        std::move(more.begin(), more.end(), std::back_inserter(warm));
+    }
+    try {
+        for (weather::BatchResult& result : warm) {
+            if (result.error) {
+                std::rethrow_exception(result.error);
+            }
+        }
+        for (auto& search : searches) {
+            search.get();
+        }
+    }
+    catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Warm-up failed: ") + e.what());
+    }
+
+    std::random_device entropy;
+    Workload workload(o, o.hot_keys + entropy() % (kLatSteps * kLonSteps / 2));
+    if (o.rate > 0) {
+        runOpenLoop(client, workload);
+    } else {
+        runClosedLoop(client, workload);
+    }
+    std::fflush(stdout);
+}
+
+void BenchCommand::runClosedLoop(weather::WeatherClient& client, Workload& workload) const {
+    const BenchOptions& o = options_;
+    std::random_device entropy;
+    std::vector<Stats> per_thread(o.concurrency);
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(o.duration_s));
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < o.concurrency; t++) {
+        uint64_t seed = (static_cast<uint64_t>(entropy()) << 32) ^ entropy();
+        workers.emplace_back([&, t, seed] {
+            std::mt19937_64 rng(seed);
+            Stats& stats = per_thread[t];
+
+            while (std::chrono::steady_clock::now() < deadline) {
+                Workload::Call next = workload.pick(rng);
+                auto begin = std::chrono::steady_clock::now();
+                try {
+                    call(client, next.kind, next.path, next.n);
+                }
+                catch (const std::exception&) {
+                    stats[next.kind][next.path].errors++;
+                    continue;
+                }
+                stats[next.kind][next.path].latency.record(
+                    elapsedNs(begin, std::chrono::steady_clock::now()));
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Stats merged;
+    CaseStats by_path[kPaths];
+    CaseStats all;
+    for (const Stats& stats : per_thread) {
+        for (int k = 0; k < kKinds; k++) {
+            for (int p = 0; p < kPaths; p++) {
+                merged[k][p].latency.merge(stats[k][p].latency);
+                merged[k][p].errors += stats[k][p].errors;
+            }
+        }
+    }
+    for (int k = 0; k < kKinds; k++) {
+        for (int p = 0; p < kPaths; p++) {
+            by_path[p].latency.merge(merged[k][p].latency);
+            by_path[p].errors += merged[k][p].errors;
+            all.latency.merge(merged[k][p].latency);
+            all.errors += merged[k][p].errors;
+        }
+    }
+
+    if (!o.json) {
+        std::printf("bench: %.1f s, %d threads, mix current=%u weather=%u cities=%u, "
+                    "hit ratio %.2f, %zu hot keys per kind\n\n",
+                    seconds, o.concurrency, o.weight_current, o.weight_weather,
+                    o.weight_cities, o.hit_ratio, o.hot_keys);
+        std::printf("  %-14s %10s %8s %11s %10s %10s %10s %10s %10s\n", "case", "requests",
+                    "errors", "req/s", "p50", "p90", "p99", "p99.9", "max");
+    }
+    for (int k = 0; k < kKinds; k++) {
+        for (int p = 0; p < kPaths; p++) {
+            const CaseStats& stats = merged[k][p];
+            if (stats.latency.count() + stats.errors > 0) {
+                printCase(o, std::string(kKindNames[k]) + "/" + kPathNames[p], stats, seconds);
+            }
+        }
+    }
+    for (int p = 0; p < kPaths; p++) {
+        printCase(o, kPathNames[p], by_path[p], seconds);
+    }
+    printCase(o, "all", all, seconds);
+}
+
+void BenchCommand::runOpenLoop(weather::WeatherClient& client, Workload& workload) const {
+    using Clock = std::chrono::steady_clock;
+    const BenchOptions& o = options_;
+
+    struct Step {
+        double target_rate = 0;
+        uint64_t scheduled = 0;
+        uint64_t dropped = 0;     // not sent: max_in_flight reached
+        uint64_t completed = 0;   // successes that finished within the step
+        CaseStats paths[kPaths];  // by the step the call was due in
+        CaseStats all;
+    };
+
+    // Completions may run after this returns, on the client's I/O thread
+    // while it is destroyed, so they share the run's state
+    struct Run {
+        std::mutex mutex;
+        std::condition_variable drained;
+        std::vector<Step> steps;
+        size_t in_flight = 0;
+        Clock::time_point start;
+        Clock::duration step_length;
+    };
+    auto run = std::make_shared<Run>();
+    run->steps.resize(static_cast<size_t>(o.ramp_steps));
+    for (int k = 0; k < o.ramp_steps; k++) {
+        run->steps[k].target_rate =
+            o.ramp_steps > 1 ? o.rate + (o.ramp_to_rate - o.rate) * k / (o.ramp_steps - 1)
+                             : o.rate;
+    }
+    run->step_length = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(o.duration_s));
+
+    std::random_device entropy;
+    std::mt19937_64 rng((static_cast<uint64_t>(entropy()) << 32) ^ entropy());
+    std::exponential_distribution<double> poisson_gap(1.0);
+
+    run->start = Clock::now();
+    for (size_t k = 0; k < run->steps.size(); k++) {
+        double rate = run->steps[k].target_rate;
+        Clock::time_point step_end = run->start + run->step_length * static_cast<int>(k + 1);
+        Clock::time_point due = run->start + run->step_length * static_cast<int>(k);
+
+        while (due < step_end) {
+            std::this_thread::sleep_until(due);
+            Workload::Call next = workload.pick(rng);
+
+            bool send;
+            {
+                std::lock_guard<std::mutex> lock(run->mutex);
+                run->steps[k].scheduled++;
+                send = run->in_flight < o.max_in_flight;
+                if (send) {
+                    run->in_flight++;
+                } else {
+                    run->steps[k].dropped++;
+                }
+            }
+
+            if (send) {
+                // Timed from when the call was due, not from when it went
+                // out: a late send is latency the caller would have seen
+                auto done = [run, k, due, path = next.path](weather::JsonPtr result,
+                                                             std::exception_ptr error) {
+                    Clock::time_point now = Clock::now();
+                    std::lock_guard<std::mutex> lock(run->mutex);
+                    Step& step = run->steps[k];
+                    if (error) {
+                        step.paths[path].errors++;
+                        step.all.errors++;
+                    } else {
+                        uint64_t latency = elapsedNs(due, now);
+                        step.paths[path].latency.record(latency);
+                        step.all.latency.record(latency);
+                        size_t window = static_cast<size_t>((now - run->start) / run->step_length);
+                        if (window < run->steps.size()) {
+                            run->steps[window].completed++;
+                        }
+                    }
+                    run->in_flight--;
+                    run->drained.notify_all();
+                };
+                try {
+                    callAsync(client, next.kind, next.path, next.n, done);
+                }
+                catch (const std::exception&) {
+                    done(weather::JsonPtr(), std::current_exception());
+                }
+            }
+
+            double gap = o.arrival == BenchOptions::Arrival::Poisson ? poisson_gap(rng) / rate
+                                                                     : 1.0 / rate;
+            due += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(gap));
+        }
+    }
+
+    // Calls still running past the client timeout count as unfinished
+    std::unique_lock<std::mutex> lock(run->mutex);
+    run->drained.wait_for(lock, std::chrono::milliseconds(2 * client.getConfig().timeout_ms),
+                          [&] { return run->in_flight == 0; });
+    size_t unfinished = run->in_flight;
+
+    double seconds = std::chrono::duration<double>(run->step_length).count();
+    double saturation_rate = 0;
+    int saturated_step = -1;
+    for (size_t k = 0; k < run->steps.size(); k++) {
+        const Step& step = run->steps[k];
+        double achieved = step.completed / seconds;
+        saturation_rate = std::max(saturation_rate, achieved);
+        // Saturated: falls behind its schedule, or sheds load
+        if (saturated_step < 0 && (achieved < 0.95 * step.target_rate || step.dropped > 0)) {
+            saturated_step = static_cast<int>(k);
+        }
+    }
+
+    const char* arrival = o.arrival == BenchOptions::Arrival::Poisson ? "poisson" : "fixed";
+    if (!o.json) {
+        std::printf("bench: open loop, %s arrivals, %d step%s of %.1f s, mix current=%u "
+                    "weather=%u cities=%u, hit ratio %.2f, %zu hot keys per kind\n\n",
+                    arrival, o.ramp_steps, o.ramp_steps > 1 ? "s" : "", o.duration_s,
+                    o.weight_current, o.weight_weather, o.weight_cities, o.hit_ratio,
+                    o.hot_keys);
+        std::printf("  %10s %11s %9s %8s %7s %10s %10s %10s %10s %10s %10s\n", "target/s",
+                    "achieved/s", "sent", "dropped", "errors", "p50", "p90", "p99", "p99.9",
+                    "hit p99", "miss p99");
+    }
+    for (size_t k = 0; k < run->steps.size(); k++) {
+        const Step& step = run->steps[k];
+        const LatencyHistogram& latency = step.all.latency;
+        uint64_t sent = step.scheduled - step.dropped;
+        double achieved = step.completed / seconds;
+        if (o.json) {
+            std::printf("{\"bench\":\"client\",\"case\":\"open_loop/step%zu\",\"arrival\":\"%s\","
+                        "\"duration_s\":%.3f,\"target_rate\":%.1f,\"achieved_rate\":%.1f,"
+                        "\"sent\":%llu,\"dropped\":%llu,\"errors\":%llu,\"mean_us\":%.3f,"
+                        "\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"p999_us\":%.3f,"
+                        "\"max_us\":%.3f,\"hit_p99_us\":%.3f,\"miss_p99_us\":%.3f}\n",
+                        k + 1, arrival, seconds, step.target_rate, achieved,
+                        static_cast<unsigned long long>(sent),
+                        static_cast<unsigned long long>(step.dropped),
+                        static_cast<unsigned long long>(step.all.errors),
+                        latency.mean() / 1e3, latency.percentile(50) / 1e3,
+                        latency.percentile(90) / 1e3, latency.percentile(99) / 1e3,
+                        latency.percentile(99.9) / 1e3, latency.max() / 1e3,
+                        step.paths[kHit].latency.percentile(99) / 1e3,
+                        step.paths[kMiss].latency.percentile(99) / 1e3);
+            continue;
+        }
+        std::printf("  %10.1f %11.1f %9llu %8llu %7llu %10s %10s %10s %10s %10s %10s\n",
+                    step.target_rate, achieved, static_cast<unsigned long long>(sent),
+                    static_cast<unsigned long long>(step.dropped),
+                    static_cast<unsigned long long>(step.all.errors),
+                    formatNs(latency.percentile(50)).c_str(),
+                    formatNs(latency.percentile(90)).c_str(),
+                    formatNs(latency.percentile(99)).c_str(),
+                    formatNs(latency.percentile(99.9)).c_str(),
+                    formatNs(step.paths[kHit].latency.percentile(99)).c_str(),
+                    formatNs(step.paths[kMiss].latency.percentile(99)).c_str());
+    }
+
+    if (o.json) {
+        std::printf("{\"bench\":\"client\",\"case\":\"open_loop/saturation\","
+                    "\"saturation_rate\":%.1f,\"saturated\":%s,\"saturated_at_rate\":%.1f,"
+                    "\"unfinished\":%zu}\n",
+                    saturation_rate, saturated_step >= 0 ? "true" : "false",
+                    saturated_step >= 0 ? run->steps[saturated_step].target_rate : 0.0,
+                    unfinished);
+        return;
+    }
+    std::printf("\n");
+    if (saturated_step >= 0) {
+        std::printf("saturation: %.1f req/s at most; fell behind from %.1f req/s target\n",
+                    saturation_rate, run->steps[saturated_step].target_rate);
+    } else {
+        std::printf("saturation: not reached; kept up with %.1f req/s\n", saturation_rate);
+    }
+    if (unfinished > 0) {
+        std::printf("unfinished: %zu calls still running at exit\n", unfinished);
+    }
+}
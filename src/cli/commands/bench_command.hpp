@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../command.hpp"
+#include <cstddef>
+#include <string>
+
+namespace weather {
+    class WeatherClient;
+}
+
+/**
+ * Load shape of a bench run
+ */
+struct BenchOptions {
+    double duration_s = 10;
+    int concurrency = 8;
+    // Relative weights of the calls in the mix
+    unsigned weight_current = 70;
+    unsigned weight_weather = 20;
+    unsigned weight_cities = 10;
+    // Share of calls for a key cached during warm-up; the others ask for a
+    // key never requested before
+    double hit_ratio = 0.8;
+    size_t hot_keys = 100; // per kind of call
+    bool json = false;
+
+    // Open loop: requests per second issued at their scheduled times
+    // whether or not earlier ones completed; 0 runs closed loop instead,
+    // concurrency threads calling back to back
+    double rate = 0;
+    // Ramp: ramp_steps steps of duration_s each, rates evenly spaced from
+    // rate to ramp_to_rate
+    double ramp_to_rate = 0;
+    int ramp_steps = 1;
+    enum class Arrival {
+        Fixed,  // evenly spaced
+        Poisson // exponentially distributed gaps
+    } arrival = Arrival::Fixed;
+    // Scheduled requests are dropped, and counted, past this many in flight
+    size_t max_in_flight = 10000;
+
+    /**
+     * Sets the weights from "current=70,weather=20,cities=10"; kinds left
+     * out get weight 0
+     * @throws std::invalid_argument on a malformed mix
+     */
+    void parseMix(const std::string& mix);
+};
+
+/**
+ * Measures the client itself with a mix of current, weather and cities
+ * calls, each for a hot key (a cache hit) or a cold one (a miss, sent to
+ * the server). Prints throughput and p50/p90/p99/p99.9 latency as a table
+ * or as JSON lines like the benchmarks under bench/.
+ *
+ * Closed loop, concurrency threads call back to back for duration_s and
+ * results are broken down by kind and path. Closed loop waits out a stall
+ * instead of measuring it, so with a rate the calls are instead issued
+ * asynchronously on a schedule, each timed from when it was due. A ramp
+ * repeats that at increasing rates, giving a latency-vs-rate curve and
+ * the throughput at which the client and server saturate.
+ *
+ * Cold weather and cities calls ask for made-up names, so the miss path
+ * wants a server that answers those, such as the mock server.
+ */
+class BenchCommand final : public Command {
+public:
+    BenchCommand(weather::WeatherClient& client, const BenchOptions& options);
+    void execute() override;
+
+private:
+    struct Workload;
+
+    void runClosedLoop(weather::WeatherClient& client, Workload& workload) const;
+    void runOpenLoop(weather::WeatherClient& client, Workload& workload) const;
+
+    weather::WeatherClient& client_;
+    BenchOptions options_;
+};
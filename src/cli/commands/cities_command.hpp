@@ -10,7 +10,7 @@ namespace weather {
 class CitiesCommand final : public Command {
 public:
     CitiesCommand(weather::WeatherClient& client, const std::string& query);
-    void execute() override;
+    weather::JsonPtr run() override;
 
 private:
     weather::WeatherClient& client_;
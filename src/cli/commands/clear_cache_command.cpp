@@ -1,12 +1,16 @@
 #include "clear_cache_command.hpp"
 #include "../../api/weather_client.hpp"
 
-#include <iostream>
+#include <jansson.h>
 
 ClearCacheCommand::ClearCacheCommand(weather::WeatherClient& c)
     : client_(c) {}
 
-void ClearCacheCommand::execute() {
+weather::JsonPtr ClearCacheCommand::run() {
     client_.clearCache();
-    std::cout << "Cache cleared" << std::endl;
+    return weather::JsonPtr(json_pack("{s:b}", "cleared", 1));
+}
+
+std::string ClearCacheCommand::render(const weather::JsonPtr&) const {
+    return "Cache cleared";
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../command.hpp"
+#include <string>
 
 namespace weather {
     class WeatherClient;
@@ -9,7 +10,8 @@ namespace weather {
 class ClearCacheCommand final : public Command {
 public:
     explicit ClearCacheCommand(weather::WeatherClient& client);
-    void execute() override;
+    weather::JsonPtr run() override;
+    std::string render(const weather::JsonPtr& result) const override;
 
 private:
     weather::WeatherClient& client_;
@@ -0,0 +1,20 @@
+#include "daemon_command.hpp"
+#include "../daemon.hpp"
+#include "../../api/weather_client.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+DaemonCommand::DaemonCommand(weather::WeatherClient& c, const std::string& socket_path)
+    : client_(c), socket_path_(socket_path) {}
+
+void DaemonCommand::execute() {
+    try {
+        Daemon daemon(client_, socket_path_);
+        daemon.run();
+    }
+    catch (const std::runtime_error& e) {
+        std::cerr << "daemon: " << e.what() << std::endl;
+        throw;
+    }
+}
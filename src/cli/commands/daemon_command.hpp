@@ -0,0 +1,22 @@
+#pragma once
+
+#include "../command.hpp"
+#include <string>
+
+namespace weather {
+    class WeatherClient;
+}
+
+/**
+ * Serves the client's cache and connections to other CLI invocations over
+ * a Unix-domain socket until interrupted (see Daemon)
+ */
+class DaemonCommand final : public Command {
+public:
+    DaemonCommand(weather::WeatherClient& client, const std::string& socket_path);
+    void execute() override;
+
+private:
+    weather::WeatherClient& client_;
+    std::string socket_path_;
+};
@@ -9,7 +9,7 @@ namespace weather {
 class EchoCommand final : public Command {
 public:
     explicit EchoCommand(weather::WeatherClient& client);
-    void execute() override;
+    weather::JsonPtr run() override;
 
 private:
     weather::WeatherClient& client_;
@@ -9,7 +9,7 @@ namespace weather {
 class HomepageCommand final : public Command {
 public:
     explicit HomepageCommand(weather::WeatherClient& client);
-    void execute() override;
+    weather::JsonPtr run() override;
 
 private:
     weather::WeatherClient& client_;
@@ -14,7 +14,7 @@ public:
                    const std::string& city,
                    const std::optional<std::string>& country = std::nullopt,
                    const std::optional<std::string>& region = std::nullopt);
-    void execute() override;
+    weather::JsonPtr run() override;
 
 private:
     weather::WeatherClient& client_;
@@ -9,7 +9,7 @@ namespace weather {
 class CurrentCommand final : public Command {
 public:
     CurrentCommand(weather::WeatherClient& client, double lat, double lon);
-    void execute() override;
+    weather::JsonPtr run() override;
 
 private:
     weather::WeatherClient& client_;
@@ -0,0 +1,316 @@
+#include "daemon.hpp"
+#include "command.hpp"
+#include "command_parser.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <jansson.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// Exit codes, as CLI::runCommandLine returns them
+constexpr int kExitOk = 0;
+constexpr int kExitInvalidArgs = 1;
+constexpr int kExitServerError = 3;
+
+// Longest request or response line accepted
+constexpr size_t kMaxLine = 1 << 20;
+
+std::atomic<bool> stop_requested{false};
+
+void requestStop(int) {
+    stop_requested = true;
+}
+
+bool makeAddress(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+int connectTo(const std::string& path) {
+    sockaddr_un addr;
+    if (!makeAddress(path, addr)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/**
+ * Reads the next newline-terminated line of fd into line, keeping what
+ * follows it in buffer. Returns false on EOF, error or timeout.
+ */
+bool readLine(int fd, std::string& buffer, std::string& line) {
+    while (true) {
+        size_t end = buffer.find('\n');
+        if (end != std::string::npos) {
+            line.assign(buffer, 0, end);
+            buffer.erase(0, end + 1);
+            return true;
+        }
+        if (buffer.size() > kMaxLine) {
+            return false;
+        }
+
+        char chunk[4096];
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+std::string dumpLine(json_t* message) {
+    std::string line;
+    char* json_str = json_dumps(message, JSON_COMPACT);
+    if (json_str) {
+        line = json_str;
+        free(json_str);
+    }
+    json_decref(message);
+    return line + "\n";
+}
+
+} // namespace
+
+std::string Daemon::socketPath() {
+    const char* configured = std::getenv("JUST_WEATHER_SOCKET");
+    if (configured) {
+        return configured;
+    }
+    const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir && *runtime_dir) {
+        return std::string(runtime_dir) + "/just-weather-client.sock";
+    }
+    return "/tmp/just-weather-client-" + std::to_string(getuid()) + ".sock";
+}
+
+bool Daemon::forward(const std::string& path, const std::vector<std::string>& argv,
+                     int timeout_ms, int& exit_code) {
+    int fd = connectTo(path);
+    if (fd < 0) {
+        return false;
+    }
+
+    // Anyone may create a socket under /tmp: only trust our own daemon
+    ucred peer;
+    socklen_t peer_len = sizeof(peer);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_len) != 0 ||
+        peer.uid != getuid()) {
+        close(fd);
+        return false;
+    }
+
+    timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    json_t* args = json_array();
+    for (const std::string& arg : argv) {
+        json_array_append_new(args, json_string(arg.c_str()));
+    }
+    json_t* request = json_object();
+    json_object_set_new(request, "argv", args);
+
+    // From here on the daemon may already have run the command, so running
+    // it again locally could repeat it: every failure is the daemon's
+    std::string buffer;
+    std::string line;
+    const char* failure = nullptr;
+    if (!sendAll(fd, dumpLine(request))) {
+        failure = "could not send the command";
+    }
+    else if (errno = 0, !readLine(fd, buffer, line)) {
+        failure = errno == EAGAIN || errno == EWOULDBLOCK ? "timed out"
+                                                          : "closed without answering";
+    }
+    close(fd);
+
+    json_t* response = failure ? nullptr : json_loads(line.c_str(), 0, nullptr);
+    json_t* exit_field = json_object_get(response, "exit");
+    if (!failure && !json_is_integer(exit_field)) {
+        failure = "sent an invalid response";
+    }
+    if (failure) {
+        std::cerr << "Error: daemon at " << path << " " << failure << std::endl;
+        json_decref(response);
+        exit_code = kExitServerError;
+        return true;
+    }
+    exit_code = static_cast<int>(json_integer_value(exit_field));
+    const char* output = json_string_value(json_object_get(response, "output"));
+    if (output && *output) {
+        std::cout << output << std::endl;
+    }
+    json_decref(response);
+    return true;
+}
+
+Daemon::Daemon(weather::WeatherClient& client, const std::string& path)
+    : client_(client), path_(path) {
+    sockaddr_un addr;
+    if (!makeAddress(path, addr)) {
+        throw std::runtime_error("Invalid daemon socket path: '" + path + "'");
+    }
+
+    int live = connectTo(path);
+    if (live >= 0) {
+        close(live);
+        throw std::runtime_error("A daemon already listens on " + path);
+    }
+    unlink(path.c_str()); // stale socket of a daemon that did not exit cleanly
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+
+    // Only the owner may connect
+    mode_t old_mask = umask(077);
+    int bound = bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    int bind_errno = errno;
+    umask(old_mask);
+    if (bound != 0 || listen(listen_fd_, SOMAXCONN) != 0) {
+        int error = bound != 0 ? bind_errno : errno;
+        close(listen_fd_);
+        throw std::runtime_error("Cannot listen on " + path + ": " + std::strerror(error));
+    }
+}
+
+Daemon::~Daemon() {
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        unlink(path_.c_str());
+    }
+}
+
+void Daemon::run() {
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop; // no SA_RESTART: wake poll() up
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::cerr << "daemon: listening on " << path_ << std::endl;
+
+    while (!stop_requested) {
+        pollfd pfd = {listen_fd_, POLLIN, 0};
+        // The timeout catches a signal delivered to a connection thread
+        if (poll(&pfd, 1, 1000) <= 0) {
+            continue;
+        }
+
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            connections_.insert(fd);
+        }
+        std::thread([this, fd] { serve(fd); }).detach();
+    }
+
+    // Wake connections blocked reading, then wait for their threads
+    std::unique_lock<std::mutex> lock(connections_mutex_);
+    for (int fd : connections_) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    connection_closed_.wait(lock, [this] { return connections_.empty(); });
+    std::cerr << "daemon: stopped" << std::endl;
+}
+
+void Daemon::serve(int fd) {
+    std::string buffer;
+    std::string line;
+    while (readLine(fd, buffer, line)) {
+        if (!sendAll(fd, handle(line))) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    connections_.erase(fd);
+    close(fd);
+    connection_closed_.notify_all();
+}
+
+std::string Daemon::handle(const std::string& request) {
+    std::vector<std::string> argv;
+    json_t* parsed = json_loads(request.c_str(), 0, nullptr);
+    size_t index;
+    json_t* arg;
+    json_array_foreach(json_object_get(parsed, "argv"), index, arg) {
+        if (json_is_string(arg)) {
+            argv.emplace_back(json_string_value(arg));
+        }
+    }
+    json_decref(parsed);
+
+    int exit_code = kExitOk;
+    std::string output;
+    try {
+        if (argv.empty() || argv[0] == "daemon" || argv[0] == "batch" ||
+            argv[0] == "bench" || argv[0] == "interactive" || argv[0] == "-i") {
+            throw std::invalid_argument("Not available through the daemon");
+        }
+        auto cmd = CommandParser::parse(client_, argv);
+        output = cmd->render(cmd->run());
+    }
+    catch (const std::invalid_argument&) {
+        exit_code = kExitInvalidArgs;
+    }
+    catch (...) {
+        exit_code = kExitServerError;
+    }
+
+    json_t* response = json_object();
+    json_object_set_new(response, "exit", json_integer(exit_code));
+    json_object_set_new(response, "output", json_string(output.c_str()));
+    return dumpLine(response);
+}
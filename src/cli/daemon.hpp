@@ -0,0 +1,83 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace weather {
+    class WeatherClient;
+}
+
+/**
+ * Cache daemon: keeps one WeatherClient, and with it a warm cache and
+ * connection pool, resident behind a Unix-domain socket, so that
+ * short-lived CLI invocations forward their command to it instead of
+ * starting cold.
+ *
+ * Protocol: one JSON object per line each way. A request is
+ * {"argv": ["current", "59.33", "18.07"]}; its response is
+ * {"exit": 0, "output": "..."} with the text and exit code the command
+ * would have produced locally. Any number of requests may share a
+ * connection.
+ */
+class Daemon {
+public:
+    /**
+     * Socket the daemon listens on and commands forward to:
+     * $JUST_WEATHER_SOCKET, else just-weather-client.sock under
+     * $XDG_RUNTIME_DIR, else /tmp/just-weather-client-<uid>.sock. Empty if
+     * JUST_WEATHER_SOCKET is set to the empty string, which turns
+     * forwarding off.
+     */
+    static std::string socketPath();
+
+    /**
+     * Runs argv on the daemon listening at path, if any, printing its
+     * output and setting exit_code. Waits at most timeout_ms for the
+     * answer. Only a daemon running as the same user is trusted. Once one
+     * has accepted the command, it may have run it, so a timeout or a bad
+     * answer is reported as a server error rather than left to a local run.
+     * @return false if no trusted daemon was reached, so the command should
+     * run locally
+     */
+    static bool forward(const std::string& path, const std::vector<std::string>& argv,
+                        int timeout_ms, int& exit_code);
+
+    /**
+     * Listens on path, replacing a stale socket file left there
+     * @throws std::runtime_error if it cannot, or a daemon already listens
+     */
+    Daemon(weather::WeatherClient& client, const std::string& path);
+
+    /**
+     * Closes the socket and removes its file
+     */
+    ~Daemon();
+
+    Daemon(const Daemon&) = delete;
+    Daemon& operator=(const Daemon&) = delete;
+
+    /**
+     * Serves connections, one thread each, until SIGINT or SIGTERM, then
+     * waits for the open ones to finish
+     */
+    void run();
+
+private:
+    void serve(int fd);
+
+    /**
+     * Runs one request line and returns its response line
+     */
+    std::string handle(const std::string& request);
+
+    weather::WeatherClient& client_;
+    std::string path_;
+    int listen_fd_ = -1;
+
+    std::mutex connections_mutex_;
+    std::condition_variable connection_closed_;
+    std::set<int> connections_; // fds being served
+};
@@ -0,0 +1,63 @@
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+    : counts_((kMaxBits - kSubBucketBits + 1) * kSubBuckets, 0) {}
+
+size_t LatencyHistogram::indexOf(uint64_t ns) {
+    // Below kSubBuckets every value has its own bucket; above, each power
+    // of two [2^m, 2^(m+1)) splits into kSubBuckets of width 2^(m - bits)
+    if (ns < kSubBuckets) {
+        return static_cast<size_t>(ns);
+    }
+    ns = std::min<uint64_t>(ns, (1ull << kMaxBits) - 1);
+    int msb = 63 - __builtin_clzll(ns);
+    int shift = msb - kSubBucketBits;
+    return static_cast<size_t>((shift + 1) * kSubBuckets + ((ns >> shift) - kSubBuckets));
+}
+
+uint64_t LatencyHistogram::highestEquivalent(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    int shift = static_cast<int>(index / kSubBuckets) - 1;
+    uint64_t sub = index % kSubBuckets + kSubBuckets;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    counts_[indexOf(ns)]++;
+    count_++;
+    sum_ += ns;
+    min_ = std::min(min_, ns);
+    max_ = std::max(max_, ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < counts_.size(); i++) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::percentile(double percent) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percent / 100.0 * count_));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); i++) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            return std::min(highestEquivalent(i), max_);
+        }
+    }
+    return max_;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * HDR-style latency histogram: log-linear buckets that record any value
+ * from 1 ns to about 18 minutes in constant time and memory, to within
+ * 1/128 (0.8%) of the value. Not thread-safe; record per thread and
+ * merge().
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t ns);
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+    /**
+     * Smallest recorded value that percent of all values do not exceed,
+     * rounded up to the end of its bucket; 0 when empty
+     */
+    uint64_t percentile(double percent) const;
+
+private:
+    // 2^kSubBucketBits linear buckets per power of two
+    static constexpr int kSubBucketBits = 7;
+    static constexpr uint64_t kSubBuckets = 1ull << kSubBucketBits;
+    // Values from 2^kMaxBits ns (about 18 minutes) on share the last bucket
+    static constexpr int kMaxBits = 40;
+
+    static size_t indexOf(uint64_t ns);
+    static uint64_t highestEquivalent(size_t index);
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
@@ -1,7 +1,10 @@
 #include "api/weather_client.hpp"
 #include "cli/cli.hpp"
+#include "cli/daemon.hpp"
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 enum class ExitCode {
     Ok = 0,
@@ -18,10 +21,24 @@ int main(int argc, char* argv[]) {
 
     try {
         weather::ClientConfig config{"localhost", 10680};
+        std::string cmd = argv[1];
+
+        // One-shot commands run on a daemon's warm client if one is up
+        if (cmd != "interactive" && cmd != "-i" && cmd != "batch" && cmd != "bench" &&
+            cmd != "daemon") {
+            std::vector<std::string> args(argv + 1, argv + argc);
+            int rc = 0;
+            if (Daemon::forward(Daemon::socketPath(), args, 2 * config.timeout_ms, rc)) {
+                if (rc == static_cast<int>(ExitCode::InvalidArgs)) {
+                    CLI::printUsageStatic(argv[0]);
+                }
+                return rc;
+            }
+        }
+
         weather::WeatherClient client{config};
         CLI cli{client};
 
-        std::string cmd = argv[1];
         if (cmd == "interactive" || cmd == "-i") {
             cli.runInteractive();
             return static_cast<int>(ExitCode::Ok);
@@ -1,12 +1,16 @@
 #include "client_tcp.h"
 
+#include "utils.h"
+
 #include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/select.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -16,6 +20,10 @@ ClientTCP *client_tcp_create() {
     return NULL;
   }
   tcp->fd = -1;
+  tcp->host[0] = '\0';
+  tcp->port = 0;
+  tcp->connected_at_ms = 0;
+  tcp->last_used_ms = 0;
   return tcp;
 }
 
@@ -27,13 +35,36 @@ void client_tcp_destroy(ClientTCP *tcp) {
   free(tcp);
 }
 
-int client_tcp_connect(ClientTCP *tcp, const char *host, int port,
-                       int timeout_ms) {
-  if (!tcp || !host) {
+static int wait_for(int fd, short events, int timeout_ms) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = events;
+  pfd.revents = 0;
+
+  int result;
+  do {
+    result = poll(&pfd, 1, timeout_ms);
+  } while (result < 0 && errno == EINTR);
+
+  if (result == 0) {
+    errno = ETIMEDOUT;
     return -1;
   }
 
-  if (tcp->fd >= 0) {
+  return result < 0 ? -1 : 0;
+}
+
+static void mark_connected(ClientTCP *tcp) {
+  int nodelay = 1;
+  setsockopt(tcp->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+  tcp->connected_at_ms = get_monotonic_time_ms();
+  tcp->last_used_ms = tcp->connected_at_ms;
+}
+
+int client_tcp_resolve(const char *host, int port,
+                       struct addrinfo **addresses) {
+  if (!host || !addresses) {
     return -1;
   }
 
@@ -41,88 +72,144 @@ int client_tcp_connect(ClientTCP *tcp, const char *host, int port,
   snprintf(port_str, sizeof(port_str), "%d", port);
 
   struct addrinfo hints = {0};
-  struct addrinfo *res = NULL;
-
   hints.ai_family = AF_UNSPEC;
   hints.ai_socktype = SOCK_STREAM;
   hints.ai_protocol = IPPROTO_TCP;
 
-  int gai_result = getaddrinfo(host, port_str, &hints, &res);
+  int gai_result = getaddrinfo(host, port_str, &hints, addresses);
   if (gai_result != 0) {
     fprintf(stderr, "getaddrinfo failed: %s\n", gai_strerror(gai_result));
+    *addresses = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+int client_tcp_connect_start(ClientTCP *tcp, const char *host, int port,
+                             const struct addrinfo *addresses, int *attempt) {
+  if (!tcp || !host || !attempt || tcp->fd >= 0 || *attempt < 0) {
     return -1;
   }
 
-  int fd = -1;
-  for (struct addrinfo *rp = res; rp; rp = rp->ai_next) {
-    fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+  snprintf(tcp->host, sizeof(tcp->host), "%s", host);
+  tcp->port = port;
+
+  const struct addrinfo *rp = addresses;
+  for (int i = 0; rp && i < *attempt; i++) {
+    rp = rp->ai_next;
+  }
+
+  for (; rp; rp = rp->ai_next) {
+    (*attempt)++;
+
+    int fd = socket(rp->ai_family, rp->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    rp->ai_protocol);
     if (fd < 0) {
       continue;
     }
 
-    int flags = fcntl(fd, F_GETFL, 0);
-    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
-
-    int connect_result = connect(fd, rp->ai_addr, rp->ai_addrlen);
-
-    if (connect_result == 0) {
-      break;
+    if (connect(fd, rp->ai_addr, rp->ai_addrlen) == 0) {
+      tcp->fd = fd;
+      mark_connected(tcp);
+      return 0;
     }
 
     if (errno == EINPROGRESS) {
-      fd_set write_fds;
-      FD_ZERO(&write_fds);
-      FD_SET(fd, &write_fds);
-
-      struct timeval tv;
-      tv.tv_sec = timeout_ms / 1000;
-      tv.tv_usec = (timeout_ms % 1000) * 1000;
-
-      int select_result = select(fd + 1, NULL, &write_fds, NULL, &tv);
-
-      if (select_result > 0) {
-        int error = 0;
-        socklen_t error_len = sizeof(error);
-        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_len) == 0 &&
-            error == 0) {
-          break;
-        }
-      }
+      tcp->fd = fd;
+      return 1;
     }
 
+    /* Refused outright (e.g. nothing listening on ::1), try the next one */
     close(fd);
-    fd = -1;
   }
 
-  freeaddrinfo(res);
+  return -1;
+}
 
-  if (fd < 0) {
+int client_tcp_connect_finish(ClientTCP *tcp) {
+  if (!tcp || tcp->fd < 0) {
     return -1;
   }
 
-  int flags = fcntl(fd, F_GETFL, 0);
-  fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+  int error = 0;
+  socklen_t error_len = sizeof(error);
+  if (getsockopt(tcp->fd, SOL_SOCKET, SO_ERROR, &error, &error_len) != 0 ||
+      error != 0) {
+    return -1;
+  }
 
-  tcp->fd = fd;
+  mark_connected(tcp);
   return 0;
 }
 
-int client_tcp_send(ClientTCP *tcp, const void *data, size_t len) {
-  if (!tcp || tcp->fd < 0 || !data) {
+int client_tcp_connect_to(ClientTCP *tcp, const char *host, int port,
+                          const struct addrinfo *addresses, int timeout_ms) {
+  if (!tcp || !host || tcp->fd >= 0) {
     return -1;
   }
 
+  int attempt = 0;
+  while (1) {
+    int started =
+        client_tcp_connect_start(tcp, host, port, addresses, &attempt);
+    if (started < 0) {
+      return -1;
+    }
+
+    if (started == 0) {
+      return 0;
+    }
+
+    if (wait_for(tcp->fd, POLLOUT, timeout_ms) == 0 &&
+        client_tcp_connect_finish(tcp) == 0) {
+      return 0;
+    }
+
+    client_tcp_close(tcp);
+  }
+}
+
+int client_tcp_connect(ClientTCP *tcp, const char *host, int port,
+                       int timeout_ms) {
+  if (!tcp || !host || tcp->fd >= 0) {
+    return -1;
+  }
+
+  struct addrinfo *addresses = NULL;
+  if (client_tcp_resolve(host, port, &addresses) != 0) {
+    return -1;
+  }
+
+  int result = client_tcp_connect_to(tcp, host, port, addresses, timeout_ms);
+  freeaddrinfo(addresses);
+  return result;
+}
+
+int client_tcp_send(ClientTCP *tcp, const void *data, size_t len,
+                    int timeout_ms) {
+  if (!tcp || tcp->fd < 0 || !data || timeout_ms < 0) {
+    return -1;
+  }
+
+  /* One deadline for the whole send, not a fresh timeout per wait */
+  uint64_t deadline = get_monotonic_time_ms() + (uint64_t)timeout_ms;
   size_t total_sent = 0;
   while (total_sent < len) {
-    ssize_t sent =
-        send(tcp->fd, (const char *)data + total_sent, len - total_sent, 0);
-    if (sent < 0) {
-      if (errno == EINTR) {
-        continue;
+    long sent = client_tcp_try_send(tcp, (const char *)data + total_sent,
+                                    len - total_sent);
+    if (sent == CLIENT_TCP_WOULD_BLOCK) {
+      uint64_t now = get_monotonic_time_ms();
+      int remaining = now < deadline ? (int)(deadline - now) : 0;
+      if (remaining == 0 || wait_for(tcp->fd, POLLOUT, remaining) != 0) {
+        errno = ETIMEDOUT;
+        return -1;
       }
+      continue;
+    }
+    if (sent < 0) {
       return -1;
     }
-    total_sent += sent;
+    total_sent += (size_t)sent;
   }
 
   return 0;
@@ -133,31 +220,57 @@ int client_tcp_recv(ClientTCP *tcp, void *buffer, size_t len, int timeout_ms) {
     return -1;
   }
 
-  fd_set read_fds;
-  FD_ZERO(&read_fds);
-  FD_SET(tcp->fd, &read_fds);
+  /* Only wait when nothing is buffered yet, which saves the poll() syscall
+   * for every read that the kernel can already satisfy */
+  long received = client_tcp_try_recv(tcp, buffer, len);
+  if (received == CLIENT_TCP_WOULD_BLOCK) {
+    if (wait_for(tcp->fd, POLLIN, timeout_ms) != 0) {
+      return -1;
+    }
+    received = client_tcp_try_recv(tcp, buffer, len);
+  }
 
-  struct timeval tv;
-  tv.tv_sec = timeout_ms / 1000;
-  tv.tv_usec = (timeout_ms % 1000) * 1000;
+  if (received < 0) {
+    return -1;
+  }
 
-  int select_result = select(tcp->fd + 1, &read_fds, NULL, NULL, &tv);
+  return (int)received;
+}
 
-  if (select_result < 0) {
+long client_tcp_try_send(ClientTCP *tcp, const void *data, size_t len) {
+  if (!tcp || tcp->fd < 0 || !data) {
     return -1;
   }
 
-  if (select_result == 0) {
-    errno = ETIMEDOUT;
+  ssize_t sent;
+  do {
+    sent = send(tcp->fd, data, len, MSG_NOSIGNAL);
+  } while (sent < 0 && errno == EINTR);
+
+  if (sent < 0) {
+    return errno == EAGAIN || errno == EWOULDBLOCK ? CLIENT_TCP_WOULD_BLOCK
+                                                   : -1;
+  }
+
+  return (long)sent;
+}
+
+long client_tcp_try_recv(ClientTCP *tcp, void *buffer, size_t len) {
+  if (!tcp || tcp->fd < 0 || !buffer) {
     return -1;
   }
 
-  ssize_t received = recv(tcp->fd, buffer, len, 0);
+  ssize_t received;
+  do {
+    received = recv(tcp->fd, buffer, len, MSG_DONTWAIT);
+  } while (received < 0 && errno == EINTR);
+
   if (received < 0) {
-    return -1;
+    return errno == EAGAIN || errno == EWOULDBLOCK ? CLIENT_TCP_WOULD_BLOCK
+                                                   : -1;
   }
 
-  return (int)received;
+  return (long)received;
 }
 
 void client_tcp_close(ClientTCP *tcp) {
@@ -167,3 +280,19 @@ void client_tcp_close(ClientTCP *tcp) {
   close(tcp->fd);
   tcp->fd = -1;
 }
+
+int client_tcp_is_alive(ClientTCP *tcp) {
+  if (!tcp || tcp->fd < 0) {
+    return 0;
+  }
+
+  char probe;
+  ssize_t peeked = recv(tcp->fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (peeked < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return 1;
+  }
+
+  /* 0 means orderly shutdown, > 0 means stray bytes we can't attribute to a
+   * request, anything else is a socket error */
+  return 0;
+}
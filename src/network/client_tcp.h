@@ -2,17 +2,64 @@
 #define CLIENT_TCP_H
 
 #include <stddef.h>
+#include <stdint.h>
 
+struct addrinfo;
+
+/* Returned by the non-blocking try functions when the call would block */
+#define CLIENT_TCP_WOULD_BLOCK -2
+
+/* Sockets are always non-blocking; the plain connect/send/recv functions wait
+ * with poll(), so they work for any fd number (no FD_SETSIZE limit). */
 typedef struct {
   int fd;
+  char host[256];
+  int port;
+  uint64_t connected_at_ms;
+  uint64_t last_used_ms;
 } ClientTCP;
 
 ClientTCP *client_tcp_create();
 void client_tcp_destroy(ClientTCP *tcp);
 int client_tcp_connect(ClientTCP *tcp, const char *host, int port,
                        int timeout_ms);
-int client_tcp_send(ClientTCP *tcp, const void *data, size_t len);
+/* Like client_tcp_connect, to addresses already resolved for host:port */
+int client_tcp_connect_to(ClientTCP *tcp, const char *host, int port,
+                          const struct addrinfo *addresses, int timeout_ms);
+/* Fails with ETIMEDOUT if data is not all sent within timeout_ms */
+int client_tcp_send(ClientTCP *tcp, const void *data, size_t len,
+                    int timeout_ms);
 int client_tcp_recv(ClientTCP *tcp, void *buffer, size_t len, int timeout_ms);
 void client_tcp_close(ClientTCP *tcp);
 
+/*
+  Resolves host:port into a list for client_tcp_connect_start, to free with
+  freeaddrinfo(). Blocks on DNS, so never call it on an event-loop thread.
+  Returns 0, or -1 if the host does not resolve.
+*/
+int client_tcp_resolve(const char *host, int port,
+                       struct addrinfo **addresses);
+
+/*
+  Non-blocking connect for event-driven callers. Starts connecting to
+  addresses, resolved for host:port beforehand, from index *attempt onwards
+  (start with 0) and advances *attempt past the one in use, so after a failed
+  client_tcp_connect_finish the next call tries the following address. Never
+  resolves anything itself. Returns 0 if already connected, 1 if in progress
+  (wait for writability, then call client_tcp_connect_finish), -1 if no
+  address is left to try.
+*/
+int client_tcp_connect_start(ClientTCP *tcp, const char *host, int port,
+                             const struct addrinfo *addresses, int *attempt);
+int client_tcp_connect_finish(ClientTCP *tcp);
+
+/* Single non-blocking send/recv. Return bytes transferred (0 from recv means
+ * EOF), CLIENT_TCP_WOULD_BLOCK, or -1 on error. */
+long client_tcp_try_send(ClientTCP *tcp, const void *data, size_t len);
+long client_tcp_try_recv(ClientTCP *tcp, void *buffer, size_t len);
+
+/* Returns 1 if an idle connection is still open and has no unread data,
+ * 0 if the peer closed it or it is otherwise unusable for a new request */
+int client_tcp_is_alive(ClientTCP *tcp);
+
 #endif
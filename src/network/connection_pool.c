@@ -0,0 +1,328 @@
+#include "connection_pool.h"
+
+#include "client_list.h"
+#include "utils.h"
+
+#include <netdb.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct ConnectionPool {
+  pthread_mutex_t lock; /* the pool is shared by blocking and event-loop I/O */
+  LinkedList *idle;     /* ClientTCP*, most recently released at the tail */
+  LinkedList *resolved; /* PoolAddresses*, one per host:port */
+  size_t max_idle;
+  uint64_t idle_timeout_ms;
+  uint64_t max_age_ms;
+};
+
+static int matches(const ClientTCP *tcp, const char *host, int port) {
+  return tcp->port == port && strcmp(tcp->host, host) == 0;
+}
+
+static int is_expired(const ConnectionPool *pool, const ClientTCP *tcp,
+                      uint64_t now) {
+  return now - tcp->last_used_ms > pool->idle_timeout_ms ||
+         now - tcp->connected_at_ms > pool->max_age_ms;
+}
+
+static void addresses_free(PoolAddresses *addresses) {
+  freeaddrinfo(addresses->list);
+  free(addresses);
+}
+
+/* Call with the lock held */
+static void addresses_unref(PoolAddresses *addresses) {
+  if (--addresses->refs == 0) {
+    addresses_free(addresses);
+  }
+}
+
+/* Call with the lock held. Returns the node of host:port, fresh or stale. */
+static Node *find_addresses(ConnectionPool *pool, const char *host, int port) {
+  LinkedList_foreach(pool->resolved, node) {
+    PoolAddresses *addresses = (PoolAddresses *)node->item;
+    if (addresses->port == port && strcmp(addresses->host, host) == 0) {
+      return node;
+    }
+  }
+  return NULL;
+}
+
+static void prune_expired(ConnectionPool *pool, uint64_t now) {
+  Node *node = pool->idle->head;
+  while (node) {
+    Node *next = node->front;
+    if (is_expired(pool, (ClientTCP *)node->item, now)) {
+      linked_list_remove(pool->idle, node,
+                         (void (*)(void *))client_tcp_destroy);
+    }
+    node = next;
+  }
+}
+
+ConnectionPool *connection_pool_create(size_t max_idle, uint64_t idle_timeout_ms,
+                                       uint64_t max_age_ms) {
+  ConnectionPool *pool = malloc(sizeof(ConnectionPool));
+  if (!pool) {
+    return NULL;
+  }
+
+  pool->idle = linked_list_create();
+  pool->resolved = linked_list_create();
+  if (!pool->idle || !pool->resolved) {
+    linked_list_dispose(&pool->idle, NULL);
+    linked_list_dispose(&pool->resolved, NULL);
+    free(pool);
+    return NULL;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pool->max_idle = max_idle > 0 ? max_idle : CONNECTION_POOL_MAX_IDLE;
+  pool->idle_timeout_ms =
+      idle_timeout_ms > 0 ? idle_timeout_ms : CONNECTION_POOL_IDLE_TIMEOUT_MS;
+  pool->max_age_ms = max_age_ms > 0 ? max_age_ms : CONNECTION_POOL_MAX_AGE_MS;
+
+  return pool;
+}
+
+void connection_pool_destroy(ConnectionPool *pool) {
+  if (!pool) {
+    return;
+  }
+
+  linked_list_dispose(&pool->idle, (void (*)(void *))client_tcp_destroy);
+  /* Every request has given its references back by now */
+  linked_list_dispose(&pool->resolved, (void (*)(void *))addresses_unref);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool);
+}
+
+PoolAddresses *connection_pool_resolve(ConnectionPool *pool, const char *host,
+                                       int port) {
+  if (!pool || !host) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  Node *node = find_addresses(pool, host, port);
+  if (node) {
+    PoolAddresses *cached = (PoolAddresses *)node->item;
+    if (get_monotonic_time_ms() - cached->resolved_at_ms <=
+        CONNECTION_POOL_DNS_TTL_MS) {
+      cached->refs++;
+      pthread_mutex_unlock(&pool->lock);
+      return cached;
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  /* Resolve without the lock so a slow lookup does not hold up other hosts */
+  PoolAddresses *addresses = calloc(1, sizeof(PoolAddresses));
+  if (!addresses) {
+    return NULL;
+  }
+
+  if (client_tcp_resolve(host, port, &addresses->list) != 0) {
+    free(addresses);
+    return NULL;
+  }
+
+  snprintf(addresses->host, sizeof(addresses->host), "%s", host);
+  addresses->port = port;
+  addresses->resolved_at_ms = get_monotonic_time_ms();
+  addresses->refs = 2; /* the pool's and the caller's */
+
+  pthread_mutex_lock(&pool->lock);
+  node = find_addresses(pool, host, port);
+  if (node) {
+    /* Whoever still holds the old list keeps it until they let go */
+    addresses_unref((PoolAddresses *)node->item);
+    node->item = addresses;
+  } else if (linked_list_append(pool->resolved, addresses) != 0) {
+    addresses->refs--;
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return addresses;
+}
+
+void connection_pool_release_addresses(ConnectionPool *pool,
+                                       PoolAddresses *addresses) {
+  if (!pool || !addresses) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  addresses_unref(addresses);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+ClientTCP *connection_pool_take_idle(ConnectionPool *pool, const char *host,
+                                     int port) {
+  if (!pool || !host) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+
+  uint64_t now = get_monotonic_time_ms();
+  prune_expired(pool, now);
+
+  ClientTCP *found = NULL;
+
+  /* Walk from the tail so the warmest connection is tried first */
+  Node *node = pool->idle->tail;
+  while (node) {
+    Node *back = node->back;
+    ClientTCP *tcp = (ClientTCP *)node->item;
+
+    if (matches(tcp, host, port)) {
+      linked_list_remove(pool->idle, node, NULL);
+
+      if (client_tcp_is_alive(tcp)) {
+        found = tcp;
+        break;
+      }
+
+      client_tcp_destroy(tcp);
+    }
+
+    node = back;
+  }
+
+  pthread_mutex_unlock(&pool->lock);
+  return found;
+}
+
+ClientTCP *connection_pool_acquire(ConnectionPool *pool, const char *host,
+                                   int port, int timeout_ms, int *reused) {
+  if (reused) {
+    *reused = 0;
+  }
+
+  if (!pool || !host) {
+    return NULL;
+  }
+
+  ClientTCP *tcp = connection_pool_take_idle(pool, host, port);
+  if (tcp) {
+    if (reused) {
+      *reused = 1;
+    }
+    return tcp;
+  }
+
+  return connection_pool_connect(pool, host, port, timeout_ms);
+}
+
+ClientTCP *connection_pool_connect(ConnectionPool *pool, const char *host,
+                                   int port, int timeout_ms) {
+  if (!pool || !host) {
+    return NULL;
+  }
+
+  PoolAddresses *addresses = connection_pool_resolve(pool, host, port);
+  if (!addresses) {
+    return NULL;
+  }
+
+  ClientTCP *tcp = client_tcp_create();
+  if (tcp && client_tcp_connect_to(tcp, host, port, addresses->list,
+                                   timeout_ms) != 0) {
+    client_tcp_destroy(tcp);
+    tcp = NULL;
+  }
+
+  connection_pool_release_addresses(pool, addresses);
+  return tcp;
+}
+
+void connection_pool_release(ConnectionPool *pool, ClientTCP *tcp,
+                             int reusable) {
+  if (!tcp) {
+    return;
+  }
+
+  if (!pool || !reusable || tcp->fd < 0) {
+    client_tcp_destroy(tcp);
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+
+  uint64_t now = get_monotonic_time_ms();
+  tcp->last_used_ms = now;
+
+  if (now - tcp->connected_at_ms > pool->max_age_ms) {
+    pthread_mutex_unlock(&pool->lock);
+    client_tcp_destroy(tcp);
+    return;
+  }
+
+  /* Enforce the per-host limit by dropping the coldest matching socket */
+  size_t same_host = 0;
+  Node *coldest = NULL;
+  LinkedList_foreach(pool->idle, node) {
+    if (matches((ClientTCP *)node->item, tcp->host, tcp->port)) {
+      if (!coldest) {
+        coldest = node;
+      }
+      same_host++;
+    }
+  }
+
+  if (same_host >= pool->max_idle && coldest) {
+    linked_list_remove(pool->idle, coldest,
+                       (void (*)(void *))client_tcp_destroy);
+  }
+
+  int appended = linked_list_append(pool->idle, tcp) == 0;
+  pthread_mutex_unlock(&pool->lock);
+
+  if (!appended) {
+    client_tcp_destroy(tcp);
+  }
+}
+
+void connection_pool_clear(ConnectionPool *pool) {
+  if (!pool) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  linked_list_clear(pool->idle, (void (*)(void *))client_tcp_destroy);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void connection_pool_clear_host(ConnectionPool *pool, const char *host,
+                                int port) {
+  if (!pool || !host) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  Node *node = pool->idle->head;
+  while (node) {
+    Node *next = node->front;
+    if (matches((ClientTCP *)node->item, host, port)) {
+      linked_list_remove(pool->idle, node,
+                         (void (*)(void *))client_tcp_destroy);
+    }
+    node = next;
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+size_t connection_pool_idle_count(ConnectionPool *pool) {
+  if (!pool) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  size_t count = pool->idle->size;
+  pthread_mutex_unlock(&pool->lock);
+  return count;
+}
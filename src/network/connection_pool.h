@@ -0,0 +1,77 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include "client_tcp.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONNECTION_POOL_MAX_IDLE 4
+#define CONNECTION_POOL_IDLE_TIMEOUT_MS 30000
+#define CONNECTION_POOL_MAX_AGE_MS 300000
+#define CONNECTION_POOL_DNS_TTL_MS 60000
+
+typedef struct ConnectionPool ConnectionPool;
+
+/* The resolved addresses of a host:port, shared by everyone connecting to it.
+ * Entries are reference counted so a request keeps walking its list for
+ * retries even after the pool has resolved the host again. */
+typedef struct {
+  char host[256];
+  int port;
+  struct addrinfo *list;
+  uint64_t resolved_at_ms;
+  size_t refs; /* guarded by the pool's lock */
+} PoolAddresses;
+
+/* Creates a pool of idle keep-alive connections. max_idle is the number of
+ * idle sockets kept per (host, port); connections idle longer than
+ * idle_timeout_ms or open longer than max_age_ms are never handed out again.
+ * Zero for any limit selects the default above. */
+ConnectionPool *connection_pool_create(size_t max_idle, uint64_t idle_timeout_ms,
+                                       uint64_t max_age_ms);
+void connection_pool_destroy(ConnectionPool *pool);
+
+/* Returns a connected socket for host:port, reusing a warm idle one when a
+ * live one is available and connecting a fresh one otherwise. *reused is set
+ * to 1 when the socket came from the pool. Returns NULL on connect failure. */
+ClientTCP *connection_pool_acquire(ConnectionPool *pool, const char *host,
+                                   int port, int timeout_ms, int *reused);
+
+/* Returns a reference to the addresses of host:port, resolving them if the
+ * pool has none younger than CONNECTION_POOL_DNS_TTL_MS. Resolving blocks on
+ * DNS, so event-loop code must get its addresses on another thread. Returns
+ * NULL if the host does not resolve. */
+PoolAddresses *connection_pool_resolve(ConnectionPool *pool, const char *host,
+                                       int port);
+
+/* Drops a reference returned by connection_pool_resolve */
+void connection_pool_release_addresses(ConnectionPool *pool,
+                                       PoolAddresses *addresses);
+
+/* Like connection_pool_acquire but never connects: returns a live idle socket
+ * for host:port or NULL */
+ClientTCP *connection_pool_take_idle(ConnectionPool *pool, const char *host,
+                                     int port);
+
+/* Like connection_pool_acquire but never reuses: always connects a fresh
+ * socket, for replaying a request a pooled one failed to carry */
+ClientTCP *connection_pool_connect(ConnectionPool *pool, const char *host,
+                                   int port, int timeout_ms);
+
+/* Hands a socket back after a request. If reusable is 0 (the server asked to
+ * close, the response was not fully framed, an error occurred...) or the pool
+ * for that host is full, the socket is closed and destroyed. */
+void connection_pool_release(ConnectionPool *pool, ClientTCP *tcp,
+                             int reusable);
+
+/* Closes every idle connection */
+void connection_pool_clear(ConnectionPool *pool);
+
+/* Closes the idle connections to host:port, leaving other hosts' alone */
+void connection_pool_clear_host(ConnectionPool *pool, const char *host,
+                                int port);
+
+size_t connection_pool_idle_count(ConnectionPool *pool);
+
+#endif
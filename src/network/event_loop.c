@@ -0,0 +1,352 @@
+#include "event_loop.h"
+
+#include "utils.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define EVENT_LOOP_MAX_EVENTS 256
+
+struct EventLoop {
+  int epoll_fd;
+  int running;
+
+  /* Events returned by the current epoll_wait(), so a handler removed while
+   * they are dispatched can be dropped from the rest of the batch */
+  struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+  int batch_size;
+  int batch_index;
+  size_t handler_count;
+
+  EventTimer wheel[EVENT_LOOP_WHEEL_SLOTS]; /* list heads */
+  uint64_t current_tick;
+  size_t timer_count;
+
+  EventHandler wake_handler;
+  void (*wake_callback)(EventLoop *, void *);
+  void *wake_userdata;
+};
+
+static uint64_t tick_of(uint64_t time_ms) {
+  return time_ms / EVENT_LOOP_TICK_MS;
+}
+
+static void on_wake(EventLoop *loop, EventHandler *handler, uint32_t events) {
+  (void)events;
+
+  uint64_t value;
+  while (read(handler->fd, &value, sizeof(value)) > 0) {
+  }
+
+  if (loop->wake_callback) {
+    loop->wake_callback(loop, loop->wake_userdata);
+  }
+}
+
+EventLoop *event_loop_create() {
+  EventLoop *loop = calloc(1, sizeof(EventLoop));
+  if (!loop) {
+    return NULL;
+  }
+
+  loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (loop->epoll_fd < 0) {
+    free(loop);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < EVENT_LOOP_WHEEL_SLOTS; i++) {
+    loop->wheel[i].prev = &loop->wheel[i];
+    loop->wheel[i].next = &loop->wheel[i];
+  }
+  loop->current_tick = tick_of(get_monotonic_time_ms());
+
+  loop->wake_handler.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  loop->wake_handler.callback = on_wake;
+  if (loop->wake_handler.fd < 0 ||
+      event_loop_add(loop, &loop->wake_handler) != 0) {
+    if (loop->wake_handler.fd >= 0) {
+      close(loop->wake_handler.fd);
+    }
+    close(loop->epoll_fd);
+    free(loop);
+    return NULL;
+  }
+  /* The wake-up fd is internal and not counted as a handler */
+  loop->handler_count = 0;
+
+  return loop;
+}
+
+void event_loop_destroy(EventLoop *loop) {
+  if (!loop) {
+    return;
+  }
+
+  close(loop->wake_handler.fd);
+  close(loop->epoll_fd);
+  free(loop);
+}
+
+int event_loop_add(EventLoop *loop, EventHandler *handler) {
+  if (!loop || !handler || handler->fd < 0) {
+    return -1;
+  }
+
+  struct epoll_event ev = {0};
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = handler;
+
+  if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, handler->fd, &ev) != 0) {
+    return -1;
+  }
+
+  loop->handler_count++;
+  return 0;
+}
+
+int event_loop_remove(EventLoop *loop, EventHandler *handler) {
+  if (!loop || !handler || handler->fd < 0) {
+    return -1;
+  }
+
+  for (int i = loop->batch_index; i < loop->batch_size; i++) {
+    if (loop->events[i].data.ptr == handler) {
+      loop->events[i].data.ptr = NULL;
+    }
+  }
+
+  if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, handler->fd, NULL) != 0) {
+    return -1;
+  }
+
+  loop->handler_count--;
+  return 0;
+}
+
+static void unlink_timer(EventTimer *timer) {
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->prev = NULL;
+  timer->next = NULL;
+}
+
+void event_loop_timer_start(EventLoop *loop, EventTimer *timer,
+                            uint64_t timeout_ms) {
+  if (!loop || !timer) {
+    return;
+  }
+
+  event_loop_timer_cancel(loop, timer);
+
+  timer->expires_at_ms = get_monotonic_time_ms() + timeout_ms;
+
+  /* Never schedule into a slot the wheel has already passed */
+  uint64_t tick = tick_of(timer->expires_at_ms);
+  if (tick <= loop->current_tick) {
+    tick = loop->current_tick + 1;
+  }
+
+  EventTimer *head = &loop->wheel[tick % EVENT_LOOP_WHEEL_SLOTS];
+  timer->next = head;
+  timer->prev = head->prev;
+  head->prev->next = timer;
+  head->prev = timer;
+  timer->active = 1;
+  loop->timer_count++;
+}
+
+void event_loop_timer_cancel(EventLoop *loop, EventTimer *timer) {
+  if (!loop || !timer || !timer->active) {
+    return;
+  }
+
+  unlink_timer(timer);
+  timer->active = 0;
+  loop->timer_count--;
+}
+
+/* Advances the wheel through every tick that has fully elapsed, firing the
+ * timers due in it. current_tick is the last tick processed, so a timer fires
+ * at most one tick late and never early. Timers due in a later rotation stay
+ * where they are. */
+static int expire_timers(EventLoop *loop) {
+  uint64_t target = tick_of(get_monotonic_time_ms());
+  int fired = 0;
+
+  /* After a long stall one full rotation visits every slot */
+  if (target - loop->current_tick > EVENT_LOOP_WHEEL_SLOTS + 1) {
+    loop->current_tick = target - EVENT_LOOP_WHEEL_SLOTS - 1;
+  }
+
+  while (loop->current_tick + 1 < target && loop->timer_count > 0) {
+    loop->current_tick++;
+    EventTimer *head = &loop->wheel[loop->current_tick % EVENT_LOOP_WHEEL_SLOTS];
+
+    /* Detach due timers first: callbacks may re-arm or cancel any timer */
+    EventTimer due = {0};
+    due.prev = &due;
+    due.next = &due;
+
+    EventTimer *timer = head->next;
+    while (timer != head) {
+      EventTimer *next = timer->next;
+      if (tick_of(timer->expires_at_ms) <= loop->current_tick) {
+        unlink_timer(timer);
+        timer->next = &due;
+        timer->prev = due.prev;
+        due.prev->next = timer;
+        due.prev = timer;
+      }
+      timer = next;
+    }
+
+    while (due.next != &due) {
+      timer = due.next;
+      unlink_timer(timer);
+      timer->active = 0;
+      loop->timer_count--;
+      timer->callback(loop, timer);
+      fired++;
+    }
+  }
+
+  if (loop->current_tick + 1 < target) {
+    loop->current_tick = target - 1;
+  }
+  return fired;
+}
+
+int event_loop_fire_timers(EventLoop *loop) {
+  if (!loop) {
+    return 0;
+  }
+
+  /* Detach them all first, so timers armed by the callbacks wait their turn */
+  EventTimer due = {0};
+  due.prev = &due;
+  due.next = &due;
+
+  for (size_t i = 0; i < EVENT_LOOP_WHEEL_SLOTS; i++) {
+    EventTimer *head = &loop->wheel[i];
+    while (head->next != head) {
+      EventTimer *timer = head->next;
+      unlink_timer(timer);
+      timer->next = &due;
+      timer->prev = due.prev;
+      due.prev->next = timer;
+      due.prev = timer;
+    }
+  }
+
+  int fired = 0;
+  while (due.next != &due) {
+    EventTimer *timer = due.next;
+    unlink_timer(timer);
+    timer->active = 0;
+    loop->timer_count--;
+    timer->callback(loop, timer);
+    fired++;
+  }
+  return fired;
+}
+
+int event_loop_run_once(EventLoop *loop, int max_wait_ms) {
+  if (!loop) {
+    return -1;
+  }
+
+  int wait_ms = max_wait_ms;
+  if (loop->timer_count > 0 &&
+      (wait_ms < 0 || wait_ms > EVENT_LOOP_TICK_MS)) {
+    wait_ms = EVENT_LOOP_TICK_MS;
+  }
+
+  int count =
+      epoll_wait(loop->epoll_fd, loop->events, EVENT_LOOP_MAX_EVENTS, wait_ms);
+  if (count < 0) {
+    if (errno != EINTR) {
+      return -1;
+    }
+    count = 0;
+  }
+
+  int dispatched = 0;
+  loop->batch_size = count;
+  for (loop->batch_index = 0; loop->batch_index < count;) {
+    struct epoll_event *ev = &loop->events[loop->batch_index++];
+    EventHandler *handler = (EventHandler *)ev->data.ptr;
+    if (!handler) {
+      continue;
+    }
+
+    uint32_t events = 0;
+    if (ev->events & EPOLLIN) {
+      events |= EVENT_READ;
+    }
+    if (ev->events & EPOLLOUT) {
+      events |= EVENT_WRITE;
+    }
+    if (ev->events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+      events |= EVENT_HANGUP;
+    }
+
+    handler->callback(loop, handler, events);
+    dispatched++;
+  }
+  loop->batch_size = 0;
+  loop->batch_index = 0;
+
+  return dispatched + expire_timers(loop);
+}
+
+void event_loop_run(EventLoop *loop) {
+  if (!loop) {
+    return;
+  }
+
+  loop->running = 1;
+  while (loop->running) {
+    if (event_loop_run_once(loop, -1) < 0) {
+      break;
+    }
+  }
+}
+
+void event_loop_stop(EventLoop *loop) {
+  if (loop) {
+    loop->running = 0;
+  }
+}
+
+void event_loop_set_wake_callback(EventLoop *loop,
+                                  void (*callback)(EventLoop *, void *),
+                                  void *userdata) {
+  if (!loop) {
+    return;
+  }
+  loop->wake_callback = callback;
+  loop->wake_userdata = userdata;
+}
+
+int event_loop_wakeup(EventLoop *loop) {
+  if (!loop) {
+    return -1;
+  }
+
+  uint64_t one = 1;
+  return write(loop->wake_handler.fd, &one, sizeof(one)) == sizeof(one) ? 0
+                                                                         : -1;
+}
+
+size_t event_loop_handler_count(const EventLoop *loop) {
+  return loop ? loop->handler_count : 0;
+}
+
+size_t event_loop_timer_count(const EventLoop *loop) {
+  return loop ? loop->timer_count : 0;
+}
@@ -0,0 +1,91 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EVENT_READ 0x1
+#define EVENT_WRITE 0x2
+#define EVENT_HANGUP 0x4
+
+/* Resolution of the timer wheel and number of slots it has. Deadlines further
+ * out than one rotation simply stay in their slot for extra rotations. */
+#define EVENT_LOOP_TICK_MS 10
+#define EVENT_LOOP_WHEEL_SLOTS 512
+
+typedef struct EventLoop EventLoop;
+typedef struct EventHandler EventHandler;
+typedef struct EventTimer EventTimer;
+
+typedef void (*EventCallback)(EventLoop *loop, EventHandler *handler,
+                              uint32_t events);
+typedef void (*TimerCallback)(EventLoop *loop, EventTimer *timer);
+
+/*
+  Readiness registration for one file descriptor, embedded in the owner's
+  struct. Registrations are edge-triggered: the callback must read or write
+  until the call would block, or it will not be woken again for that fd.
+*/
+struct EventHandler {
+  int fd;
+  EventCallback callback;
+  void *userdata;
+};
+
+/* Deadline on the timer wheel, embedded in the owner's struct */
+struct EventTimer {
+  EventTimer *prev;
+  EventTimer *next;
+  uint64_t expires_at_ms;
+  int active;
+  TimerCallback callback;
+  void *userdata;
+};
+
+EventLoop *event_loop_create();
+void event_loop_destroy(EventLoop *loop);
+
+/* Registers handler->fd for read and write readiness. The handler must stay
+ * valid until event_loop_remove() is called for it. */
+int event_loop_add(EventLoop *loop, EventHandler *handler);
+
+/* Unregisters a handler. Safe to call from inside any callback, including
+ * for handlers that still have events pending in the current batch. */
+int event_loop_remove(EventLoop *loop, EventHandler *handler);
+
+/* Arms (or re-arms) timer to fire timeout_ms from now */
+void event_loop_timer_start(EventLoop *loop, EventTimer *timer,
+                            uint64_t timeout_ms);
+void event_loop_timer_cancel(EventLoop *loop, EventTimer *timer);
+
+/* Fires every armed timer now, as if its deadline had passed, so that work
+ * bounded by a deadline ends when the loop itself cannot go on. Returns the
+ * number fired. */
+int event_loop_fire_timers(EventLoop *loop);
+
+/*
+  Waits up to max_wait_ms (-1 for no limit) for readiness or timer
+  expiry and dispatches whatever is due. Returns the number of callbacks run,
+  or -1 on error.
+*/
+int event_loop_run_once(EventLoop *loop, int max_wait_ms);
+
+/* Runs until event_loop_stop() is called */
+void event_loop_run(EventLoop *loop);
+void event_loop_stop(EventLoop *loop);
+
+/*
+  Cross-thread wake-up: the only two functions that may be called from a
+  thread other than the one running the loop. The wake callback runs on the
+  loop thread after one or more event_loop_wakeup() calls.
+*/
+void event_loop_set_wake_callback(EventLoop *loop,
+                                  void (*callback)(EventLoop *, void *),
+                                  void *userdata);
+int event_loop_wakeup(EventLoop *loop);
+
+/* Number of registered handlers and armed timers */
+size_t event_loop_handler_count(const EventLoop *loop);
+size_t event_loop_timer_count(const EventLoop *loop);
+
+#endif
@@ -0,0 +1,312 @@
+#include "http_async.h"
+
+#include "client_tcp.h"
+#include "http_client.h"
+#include "http_parser.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  EventLoop *loop;
+  ConnectionPool *pool;
+
+  ClientTCP *tcp;
+  EventHandler handler;
+  EventTimer deadline;
+  int registered;
+  int connecting;
+  int connect_attempt;
+  int reused;
+
+  char host[256];
+  int port;
+  PoolAddresses *addresses; /* resolved by the caller, walked on retries */
+
+  char request[HTTP_REQUEST_MAX];
+  size_t request_len;
+  size_t request_sent;
+
+  HttpParser parser;
+  size_t received;
+
+  HttpAsyncCallback callback;
+  void *userdata;
+} HttpAsyncRequest;
+
+static void on_socket_event(EventLoop *loop, EventHandler *handler,
+                            uint32_t events);
+
+static void detach_socket(HttpAsyncRequest *req, int reusable) {
+  if (!req->tcp) {
+    return;
+  }
+
+  if (req->registered) {
+    event_loop_remove(req->loop, &req->handler);
+    req->registered = 0;
+  }
+
+  connection_pool_release(req->pool, req->tcp, reusable);
+  req->tcp = NULL;
+}
+
+static void finish(HttpAsyncRequest *req, const char *error) {
+  event_loop_timer_cancel(req->loop, &req->deadline);
+
+  HttpAsyncResult result = {0};
+  result.error = error;
+  result.etag = req->parser.etag;
+  result.last_modified = req->parser.last_modified;
+  result.freshness = http_parser_freshness(&req->parser, time(NULL));
+  result.no_store = req->parser.no_store;
+
+  if (!error) {
+    int keep_alive = req->parser.keep_alive;
+    result.status_code = req->parser.status_code;
+    result.body = http_parser_take_body(&req->parser, &result.body_size);
+    detach_socket(req, keep_alive);
+  } else {
+    detach_socket(req, 0);
+  }
+
+  connection_pool_release_addresses(req->pool, req->addresses);
+  req->callback(&result, req->userdata);
+
+  free(result.body);
+  http_parser_reset(&req->parser);
+  free(req);
+}
+
+static int attach_socket(HttpAsyncRequest *req) {
+  req->handler.fd = req->tcp->fd;
+  req->handler.callback = on_socket_event;
+  req->handler.userdata = req;
+
+  if (event_loop_add(req->loop, &req->handler) != 0) {
+    return -1;
+  }
+
+  req->registered = 1;
+  return 0;
+}
+
+/* Starts connecting to the next address. Returns -1 once none is left. */
+static int start_connect(HttpAsyncRequest *req) {
+  if (!req->addresses) {
+    return -1;
+  }
+
+  if (!req->tcp) {
+    req->tcp = client_tcp_create();
+    if (!req->tcp) {
+      return -1;
+    }
+  }
+
+  int started = client_tcp_connect_start(req->tcp, req->host, req->port,
+                                         req->addresses->list,
+                                         &req->connect_attempt);
+  if (started < 0) {
+    return -1;
+  }
+
+  req->connecting = started == 1;
+  return attach_socket(req);
+}
+
+/* Replays the request on a fresh connection after a pooled one turned out to
+ * have been closed by the server while idle */
+static int restart_on_new_connection(HttpAsyncRequest *req) {
+  detach_socket(req, 0);
+  http_parser_reset(&req->parser);
+  req->reused = 0;
+  req->request_sent = 0;
+  req->received = 0;
+  req->connect_attempt = 0;
+  return start_connect(req);
+}
+
+static void fail_or_retry(HttpAsyncRequest *req, const char *error) {
+  if (req->reused && req->received == 0 &&
+      restart_on_new_connection(req) == 0) {
+    return;
+  }
+  finish(req, error);
+}
+
+/* Returns 1 once the request is fully written, 0 if the socket is full,
+ * -1 on error */
+static int pump_send(HttpAsyncRequest *req) {
+  while (req->request_sent < req->request_len) {
+    long sent = client_tcp_try_send(req->tcp, req->request + req->request_sent,
+                                    req->request_len - req->request_sent);
+    if (sent == CLIENT_TCP_WOULD_BLOCK) {
+      return 0;
+    }
+    if (sent < 0) {
+      return -1;
+    }
+    req->request_sent += (size_t)sent;
+  }
+  return 1;
+}
+
+/* Drains the socket (edge-triggered readiness requires reading until it
+ * would block). Returns 1 when the response is complete, 0 if more data is
+ * needed, -1 on error. */
+static int pump_recv(HttpAsyncRequest *req) {
+  char buffer[16384];
+
+  while (!http_parser_is_done(&req->parser)) {
+    size_t window_len = 0;
+    char *window = http_parser_body_window(&req->parser, &window_len);
+    char *target = window ? window : buffer;
+    size_t target_len = window ? window_len : sizeof(buffer);
+
+    long received = client_tcp_try_recv(req->tcp, target, target_len);
+    if (received == CLIENT_TCP_WOULD_BLOCK) {
+      return 0;
+    }
+    if (received < 0) {
+      return -1;
+    }
+    if (received == 0) {
+      if (http_parser_finish(&req->parser) != 0) {
+        return -1;
+      }
+      req->parser.keep_alive = 0;
+      return 1;
+    }
+
+    req->received += (size_t)received;
+
+    if (window) {
+      if (http_parser_body_commit(&req->parser, (size_t)received) != 0) {
+        return -1;
+      }
+      continue;
+    }
+
+    long consumed = http_parser_feed(&req->parser, buffer, (size_t)received);
+    if (consumed < 0) {
+      return -1;
+    }
+    if (consumed < received) {
+      req->parser.keep_alive = 0;
+    }
+  }
+
+  return 1;
+}
+
+static void on_socket_event(EventLoop *loop, EventHandler *handler,
+                            uint32_t events) {
+  HttpAsyncRequest *req = (HttpAsyncRequest *)handler->userdata;
+
+  if (req->connecting) {
+    if (!(events & (EVENT_WRITE | EVENT_HANGUP))) {
+      return;
+    }
+
+    if (client_tcp_connect_finish(req->tcp) != 0) {
+      /* Try the host's next address before giving up */
+      event_loop_remove(loop, &req->handler);
+      req->registered = 0;
+      client_tcp_close(req->tcp);
+      if (start_connect(req) != 0) {
+        finish(req, "Connection failed");
+      }
+      return;
+    }
+
+    req->connecting = 0;
+  }
+
+  int sent = pump_send(req);
+  if (sent < 0) {
+    fail_or_retry(req, "Failed to send request");
+    return;
+  }
+  if (sent == 0) {
+    return;
+  }
+
+  int done = pump_recv(req);
+  if (done < 0) {
+    fail_or_retry(req, "Failed to receive response");
+  } else if (done > 0) {
+    finish(req, NULL);
+  }
+}
+
+static void on_deadline(EventLoop *loop, EventTimer *timer) {
+  (void)loop;
+  /* The wheel never fires early: early means event_loop_fire_timers() */
+  int aborted = get_monotonic_time_ms() < timer->expires_at_ms;
+  finish((HttpAsyncRequest *)timer->userdata,
+         aborted ? "Request aborted" : "Request timed out");
+}
+
+int http_async_get(EventLoop *loop, ConnectionPool *pool, const char *url,
+                   PoolAddresses *addresses, const char *etag,
+                   const char *last_modified, int timeout_ms,
+                   HttpAsyncCallback callback, void *userdata) {
+  if (!loop || !pool || !url || !callback) {
+    connection_pool_release_addresses(pool, addresses);
+    return -1;
+  }
+
+  HttpAsyncRequest *req = calloc(1, sizeof(HttpAsyncRequest));
+  if (!req) {
+    connection_pool_release_addresses(pool, addresses);
+    return -1;
+  }
+
+  char path[512];
+  int len = -1;
+  if (http_parse_url(url, req->host, &req->port, path) == 0) {
+    len = http_format_request(req->request, sizeof(req->request), req->host,
+                              path, etag, last_modified);
+  }
+  if (len < 0) {
+    connection_pool_release_addresses(pool, addresses);
+    free(req);
+    return -1;
+  }
+
+  req->loop = loop;
+  req->pool = pool;
+  req->addresses = addresses;
+  req->request_len = (size_t)len;
+  req->callback = callback;
+  req->userdata = userdata;
+  req->deadline.callback = on_deadline;
+  req->deadline.userdata = req;
+  http_parser_init(&req->parser);
+
+  req->tcp = connection_pool_take_idle(pool, req->host, req->port);
+  if (req->tcp) {
+    req->reused = 1;
+    if (attach_socket(req) != 0) {
+      connection_pool_release(pool, req->tcp, 0);
+      req->tcp = NULL;
+      req->reused = 0;
+    }
+  }
+
+  if (!req->tcp && start_connect(req) != 0) {
+    if (req->tcp) {
+      client_tcp_destroy(req->tcp);
+    }
+    connection_pool_release_addresses(pool, addresses);
+    free(req);
+    return -1;
+  }
+
+  event_loop_timer_start(loop, &req->deadline,
+                         timeout_ms > 0 ? (uint64_t)timeout_ms : 5000);
+  return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef HTTP_ASYNC_H
+#define HTTP_ASYNC_H
+
+#include "connection_pool.h"
+#include "event_loop.h"
+
+#include <stddef.h>
+
+typedef struct {
+  int status_code;
+  char *body; /* NUL-terminated; set to NULL in the callback to keep it */
+  size_t body_size;
+  /* Response validators, empty when absent; valid only during the callback */
+  const char *etag;
+  const char *last_modified;
+  /* Caching directives, as http_client_get_freshness() / _no_store() */
+  long freshness;
+  int no_store;
+  const char *error; /* NULL on success, valid only during the callback */
+} HttpAsyncResult;
+
+typedef void (*HttpAsyncCallback)(HttpAsyncResult *result, void *userdata);
+
+/*
+  Starts a non-blocking GET driven by loop. Connections come from and go back
+  to pool, and each request has its own deadline of timeout_ms on the loop's
+  timer wheel. Returns 0 if the request was started, in which case callback
+  runs exactly once on the loop thread; returns -1 (and never calls callback)
+  if it could not be started at all. event_loop_fire_timers() ends every
+  request on the loop, with error "Request aborted".
+
+  addresses, from connection_pool_resolve on a thread other than loop's, are
+  what a new connection is made to, so the loop thread never blocks on DNS;
+  the request takes over that reference either way. With NULL addresses the
+  request can only run on an idle pooled connection.
+
+  As with http_client_get, any response with a status in 200-599 is
+  delivered with error == NULL; callers decide what a status means. Non-empty
+  etag / last_modified make the request conditional, as with
+  http_client_get_conditional; either may be NULL.
+*/
+int http_async_get(EventLoop *loop, ConnectionPool *pool, const char *url,
+                   PoolAddresses *addresses, const char *etag,
+                   const char *last_modified, int timeout_ms,
+                   HttpAsyncCallback callback, void *userdata);
+
+#endif
@@ -0,0 +1,139 @@
+#include "http_chunked.h"
+
+#include <stdint.h>
+#include <string.h>
+
+void http_chunked_init(HttpChunkedDecoder *decoder) {
+  decoder->state = HTTP_CHUNK_SIZE;
+  decoder->remaining = 0;
+  decoder->size_digits = 0;
+  decoder->trailer_line_len = 0;
+}
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+long http_chunked_decode(HttpChunkedDecoder *decoder, char *buf, size_t len,
+                         size_t *consumed) {
+  size_t in = 0;
+  size_t out = 0;
+
+  while (in < len && decoder->state != HTTP_CHUNK_DONE) {
+    char c = buf[in];
+
+    switch (decoder->state) {
+    case HTTP_CHUNK_SIZE: {
+      int digit = hex_value(c);
+      if (digit >= 0) {
+        if (decoder->remaining > (SIZE_MAX >> 4)) {
+          return -1;
+        }
+        decoder->remaining = (decoder->remaining << 4) | (size_t)digit;
+        decoder->size_digits++;
+      } else if (decoder->size_digits == 0) {
+        /* An empty size line is not the last chunk, "0" is */
+        return -1;
+      } else if (c == ';' || c == ' ' || c == '\t') {
+        decoder->state = HTTP_CHUNK_EXTENSION;
+      } else if (c == '\r') {
+        decoder->state = HTTP_CHUNK_SIZE_LF;
+      } else {
+        return -1;
+      }
+      in++;
+      break;
+    }
+    case HTTP_CHUNK_EXTENSION:
+      if (c == '\r') {
+        decoder->state = HTTP_CHUNK_SIZE_LF;
+      }
+      in++;
+      break;
+    case HTTP_CHUNK_SIZE_LF:
+      if (c != '\n') {
+        return -1;
+      }
+      in++;
+      decoder->size_digits = 0;
+      if (decoder->remaining == 0) {
+        decoder->state = HTTP_CHUNK_TRAILER;
+        decoder->trailer_line_len = 0;
+      } else {
+        decoder->state = HTTP_CHUNK_DATA;
+      }
+      break;
+    case HTTP_CHUNK_DATA: {
+      size_t take = len - in;
+      if (take > decoder->remaining) {
+        take = decoder->remaining;
+      }
+      /* out never overtakes in, so the payload only ever moves backwards */
+      if (out != in) {
+        memmove(buf + out, buf + in, take);
+      }
+      out += take;
+      in += take;
+      decoder->remaining -= take;
+      if (decoder->remaining == 0) {
+        decoder->state = HTTP_CHUNK_DATA_CR;
+      }
+      break;
+    }
+    case HTTP_CHUNK_DATA_CR:
+      if (c != '\r') {
+        return -1;
+      }
+      decoder->state = HTTP_CHUNK_DATA_LF;
+      in++;
+      break;
+    case HTTP_CHUNK_DATA_LF:
+      if (c != '\n') {
+        return -1;
+      }
+      decoder->state = HTTP_CHUNK_SIZE;
+      in++;
+      break;
+    case HTTP_CHUNK_TRAILER:
+      if (c == '\r') {
+        decoder->state = HTTP_CHUNK_TRAILER_LF;
+      } else {
+        decoder->trailer_line_len++;
+      }
+      in++;
+      break;
+    case HTTP_CHUNK_TRAILER_LF:
+      if (c != '\n') {
+        return -1;
+      }
+      in++;
+      if (decoder->trailer_line_len == 0) {
+        decoder->state = HTTP_CHUNK_DONE;
+      } else {
+        decoder->state = HTTP_CHUNK_TRAILER;
+        decoder->trailer_line_len = 0;
+      }
+      break;
+    case HTTP_CHUNK_DONE:
+      break;
+    }
+  }
+
+  if (consumed) {
+    *consumed = in;
+  }
+  return (long)out;
+}
+
+int http_chunked_is_done(const HttpChunkedDecoder *decoder) {
+  return decoder && decoder->state == HTTP_CHUNK_DONE;
+}
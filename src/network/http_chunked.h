@@ -0,0 +1,46 @@
+#ifndef HTTP_CHUNKED_H
+#define HTTP_CHUNKED_H
+
+#include <stddef.h>
+
+typedef enum {
+  HTTP_CHUNK_SIZE,
+  HTTP_CHUNK_EXTENSION,
+  HTTP_CHUNK_SIZE_LF,
+  HTTP_CHUNK_DATA,
+  HTTP_CHUNK_DATA_CR,
+  HTTP_CHUNK_DATA_LF,
+  HTTP_CHUNK_TRAILER,
+  HTTP_CHUNK_TRAILER_LF,
+  HTTP_CHUNK_DONE
+} HttpChunkState;
+
+/*
+  Streaming, in-place decoder for Transfer-Encoding: chunked
+    Chunk sizes are parsed digit by digit as they arrive and payload bytes are
+  compacted towards the front of the buffer they were received into, so
+  decoding never allocates no matter how many chunks the body has. State
+  carries over between calls, so a chunk header or CRLF may be split across
+  reads.
+*/
+typedef struct {
+  HttpChunkState state;
+  size_t remaining;
+  size_t size_digits; /* hex digits read of the current chunk size */
+  size_t trailer_line_len;
+} HttpChunkedDecoder;
+
+void http_chunked_init(HttpChunkedDecoder *decoder);
+
+/*
+  Decodes buf[0, len) in place. Payload is written to buf starting at offset
+  0 and its length is returned; *consumed receives the number of raw bytes
+  used, which is less than len only if the message ended inside buf.
+  Returns -1 on malformed framing.
+*/
+long http_chunked_decode(HttpChunkedDecoder *decoder, char *buf, size_t len,
+                         size_t *consumed);
+
+int http_chunked_is_done(const HttpChunkedDecoder *decoder);
+
+#endif
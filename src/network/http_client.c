@@ -1,36 +1,59 @@
 #include "http_client.h"
 
-#include <ctype.h>
-#include <stdint.h>
+#include "http_parser.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+/* receive_response() result when the peer closed before sending a byte */
+#define HTTP_RECV_NOTHING -2
+/* perform_request() result asking the caller to retry on a new connection */
+#define HTTP_RETRY_STALE 1
 
-static int parse_url(const char *url, char *hostname, int *port, char *path);
-static int send_request(HttpClient *client, const char *host, const char *path);
-static int receive_response(HttpClient *client);
-static int parse_headers(const char *data, size_t len, int *status_code,
-                         size_t *content_length, int *chunked);
-static int decode_chunked(const uint8_t *in, size_t in_len, char **out,
-                          size_t *out_len);
+static int send_request(HttpClient *client, const char *host, const char *path,
+                        const char *etag, const char *last_modified);
+static int receive_response(HttpClient *client, int *keep_alive);
 
 HttpClient *http_client_create(int timeout_ms) {
+  ConnectionPool *pool = connection_pool_create(0, 0, 0);
+  if (!pool) {
+    return NULL;
+  }
+
+  HttpClient *client = http_client_create_with_pool(timeout_ms, pool);
+  if (!client) {
+    connection_pool_destroy(pool);
+    return NULL;
+  }
+
+  client->owns_pool = 1;
+  return client;
+}
+
+HttpClient *http_client_create_with_pool(int timeout_ms, ConnectionPool *pool) {
+  if (!pool) {
+    return NULL;
+  }
+
   HttpClient *client = malloc(sizeof(HttpClient));
   if (!client) {
     return NULL;
   }
 
-  client->tcp = client_tcp_create();
+  client->tcp = NULL;
+  client->pool = pool;
+  client->owns_pool = 0;
   client->status_code = 0;
   client->response_body = NULL;
   client->response_size = 0;
+  client->etag[0] = '\0';
+  client->last_modified[0] = '\0';
+  client->freshness = -1;
+  client->no_store = 0;
   client->timeout_ms = timeout_ms > 0 ? timeout_ms : 5000;
 
-  if (!client->tcp) {
-    free(client);
-    return NULL;
-  }
-
   return client;
 }
 
@@ -47,53 +70,116 @@ void http_client_destroy(HttpClient *client) {
     client_tcp_destroy(client->tcp);
   }
 
+  if (client->owns_pool) {
+    connection_pool_destroy(client->pool);
+  }
+
   free(client);
 }
 
-int http_client_get(HttpClient *client, const char *url, char **error) {
-  if (!client || !url) {
+/* Runs one request/response exchange on a pooled connection, or on a fresh
+ * one when fresh is set. Returns 0 on success, -1 on failure, and
+ * HTTP_RETRY_STALE when a reused connection turned out to be dead before the
+ * server sent anything, in which case the request can safely be replayed on a
+ * fresh socket. */
+static int perform_request(HttpClient *client, const char *hostname, int port,
+                           const char *path, const char *etag,
+                           const char *last_modified, int fresh,
+                           char **error) {
+  int reused = 0;
+  if (fresh) {
+    client->tcp = connection_pool_connect(client->pool, hostname, port,
+                                          client->timeout_ms);
+  } else {
+    client->tcp = connection_pool_acquire(client->pool, hostname, port,
+                                          client->timeout_ms, &reused);
+  }
+  if (!client->tcp) {
     if (error) {
-      *error = strdup("Invalid parameters");
+      *error = strdup("Connection failed");
     }
     return -1;
   }
 
-  char hostname[256];
-  int port;
-  char path[512];
-
-  if (parse_url(url, hostname, &port, path) != 0) {
+  if (send_request(client, hostname, path, etag, last_modified) != 0) {
+    connection_pool_release(client->pool, client->tcp, 0);
+    client->tcp = NULL;
+    if (reused) {
+      return HTTP_RETRY_STALE;
+    }
     if (error) {
-      *error = strdup("Failed to parse URL");
+      *error = strdup("Failed to send request");
     }
     return -1;
   }
 
-  if (client_tcp_connect(client->tcp, hostname, port, client->timeout_ms) !=
-      0) {
+  int keep_alive = 0;
+  int result = receive_response(client, &keep_alive);
+  if (result != 0) {
+    connection_pool_release(client->pool, client->tcp, 0);
+    client->tcp = NULL;
+    if (reused && result == HTTP_RECV_NOTHING) {
+      return HTTP_RETRY_STALE;
+    }
     if (error) {
-      *error = strdup("Connection failed");
+      *error = strdup("Failed to receive response");
     }
     return -1;
   }
 
-  if (send_request(client, hostname, path) != 0) {
+  connection_pool_release(client->pool, client->tcp, keep_alive);
+  client->tcp = NULL;
+  return 0;
+}
+
+int http_client_get(HttpClient *client, const char *url, char **error) {
+  return http_client_get_conditional(client, url, NULL, NULL, error);
+}
+
+int http_client_get_conditional(HttpClient *client, const char *url,
+                                const char *etag, const char *last_modified,
+                                char **error) {
+  if (!client || !url) {
     if (error) {
-      *error = strdup("Failed to send request");
+      *error = strdup("Invalid parameters");
     }
-    client_tcp_close(client->tcp);
     return -1;
   }
 
-  if (receive_response(client) != 0) {
+  char hostname[256];
+  int port;
+  char path[512];
+
+  if (http_parse_url(url, hostname, &port, path) != 0) {
     if (error) {
-      *error = strdup("Failed to receive response");
+      *error = strdup("Failed to parse URL");
     }
-    client_tcp_close(client->tcp);
     return -1;
   }
 
-  client_tcp_close(client->tcp);
+  free(client->response_body);
+  client->response_body = NULL;
+  client->response_size = 0;
+  client->status_code = 0;
+  client->etag[0] = '\0';
+  client->last_modified[0] = '\0';
+  client->freshness = -1;
+  client->no_store = 0;
+
+  int result = perform_request(client, hostname, port, path, etag,
+                               last_modified, 0, error);
+  if (result == HTTP_RETRY_STALE) {
+    /* The server probably closed its other idle sockets too (a restart, an
+     * idle timeout), so drop this host's; other hosts and the replay, which
+     * never reuses, are unaffected by sockets released meanwhile */
+    connection_pool_clear_host(client->pool, hostname, port);
+    result = perform_request(client, hostname, port, path, etag,
+                             last_modified, 1, error);
+  }
+
+  if (result != 0) {
+    return -1;
+  }
 
   if (client->status_code < 200 || client->status_code >= 600) {
     if (error) {
@@ -119,7 +205,23 @@ size_t http_client_get_body_size(HttpClient *client) {
   return client ? client->response_size : 0;
 }
 
-static int parse_url(const char *url, char *hostname, int *port, char *path) {
+const char *http_client_get_etag(HttpClient *client) {
+  return client ? client->etag : "";
+}
+
+const char *http_client_get_last_modified(HttpClient *client) {
+  return client ? client->last_modified : "";
+}
+
+long http_client_get_freshness(HttpClient *client) {
+  return client ? client->freshness : -1;
+}
+
+int http_client_get_no_store(HttpClient *client) {
+  return client ? client->no_store : 0;
+}
+
+int http_parse_url(const char *url, char *hostname, int *port, char *path) {
   if (url == NULL || hostname == NULL || port == NULL || path == NULL) {
     return -1;
   }
@@ -173,245 +275,123 @@ static int parse_url(const char *url, char *hostname, int *port, char *path) {
   return 0;
 }
 
-static int send_request(HttpClient *client, const char *host,
-                        const char *path) {
-  char request[2048];
-  int len = snprintf(request, sizeof(request),
-                     "GET %s HTTP/1.1\r\n"
-                     "Host: %s\r\n"
-                     "User-Agent: just-weather-client/1.0\r\n"
-                     "Accept: application/json\r\n"
-                     "Connection: close\r\n"
-                     "\r\n",
-                     path, host);
-
-  if (len < 0 || len >= (int)sizeof(request)) {
-    return -1;
-  }
-
-  return client_tcp_send(client->tcp, request, len);
+/* Validators come back from servers and the cache file: never let one
+ * smuggle a line break into the request */
+static int is_usable_validator(const char *value) {
+  return value && value[0] && !strpbrk(value, "\r\n");
 }
 
-static int receive_response(HttpClient *client) {
-  char buffer[8192];
-  size_t total_received = 0;
-  char *full_response = NULL;
-
-  while (1) {
-    int received = client_tcp_recv(client->tcp, buffer, sizeof(buffer) - 1,
-                                   client->timeout_ms);
-
-    if (received < 0) {
-      free(full_response);
-      return -1;
-    }
-
-    if (received == 0) {
-      break;
-    }
-
-    char *new_response = realloc(full_response, total_received + received + 1);
-    if (!new_response) {
-      free(full_response);
-      return -1;
-    }
-
-    full_response = new_response;
-    memcpy(full_response + total_received, buffer, received);
-    total_received += received;
-    full_response[total_received] = '\0';
+int http_format_request(char *buffer, size_t size, const char *host,
+                        const char *path, const char *etag,
+                        const char *last_modified) {
+  char conditions[2 * HTTP_VALIDATOR_MAX + 64] = "";
+  int conditions_len = 0;
+  if (is_usable_validator(etag)) {
+    conditions_len = snprintf(conditions, sizeof(conditions),
+                              "If-None-Match: %s\r\n", etag);
   }
-
-  if (!full_response || total_received == 0) {
-    free(full_response);
-    return -1;
+  if (is_usable_validator(last_modified) && conditions_len >= 0 &&
+      (size_t)conditions_len < sizeof(conditions)) {
+    snprintf(conditions + conditions_len,
+             sizeof(conditions) - (size_t)conditions_len,
+             "If-Modified-Since: %s\r\n", last_modified);
   }
 
-  size_t content_length = 0;
-  int is_chunked = 0;
-
-  if (parse_headers(full_response, total_received, &client->status_code,
-                    &content_length, &is_chunked) != 0) {
-    free(full_response);
-    return -1;
-  }
+  int len = snprintf(buffer, size,
+                     "GET %s HTTP/1.1\r\n"
+                     "Host: %s\r\n"
+                     "User-Agent: just-weather-client/1.0\r\n"
+                     "Accept: application/json\r\n"
+                     "Connection: keep-alive\r\n"
+                     "%s"
+                     "\r\n",
+                     path, host, conditions);
 
-  const char *body_start = strstr(full_response, "\r\n\r\n");
-  if (!body_start) {
-    free(full_response);
+  if (len < 0 || len >= (int)size) {
     return -1;
   }
-  body_start += 4;
-
-  size_t header_len = body_start - full_response;
-  size_t body_len = total_received - header_len;
-
-  if (is_chunked) {
-    char *decoded_body = NULL;
-    size_t decoded_len = 0;
-
-    if (decode_chunked((uint8_t *)body_start, body_len, &decoded_body,
-                       &decoded_len) == 0) {
-      free(full_response);
-      client->response_body = decoded_body;
-      client->response_size = decoded_len;
-      return 0;
-    } else {
-      free(full_response);
-      return -1;
-    }
-  } else {
-    client->response_body = malloc(body_len + 1);
-    if (!client->response_body) {
-      free(full_response);
-      return -1;
-    }
 
-    memcpy(client->response_body, body_start, body_len);
-    client->response_body[body_len] = '\0';
-    client->response_size = body_len;
-    free(full_response);
-    return 0;
-  }
+  return len;
 }
 
-static int parse_headers(const char *data, size_t len, int *status_code,
-                         size_t *content_length, int *chunked) {
-  *status_code = 0;
-  *content_length = 0;
-  *chunked = 0;
-
-  const char *line_end = strstr(data, "\r\n");
-  if (!line_end) {
+static int send_request(HttpClient *client, const char *host, const char *path,
+                        const char *etag, const char *last_modified) {
+  char request[HTTP_REQUEST_MAX];
+  int len = http_format_request(request, sizeof(request), host, path, etag,
+                                last_modified);
+  if (len < 0) {
     return -1;
   }
 
-  if (sscanf(data, "HTTP/%*d.%*d %d", status_code) != 1) {
-    return -1;
-  }
-
-  const char *current = line_end + 2;
-  while (current < data + len) {
-    line_end = strstr(current, "\r\n");
-    if (!line_end) {
-      break;
-    }
-
-    if (line_end == current) {
-      break;
-    }
-
-    if (strncasecmp(current, "Content-Length:", 15) == 0) {
-      sscanf(current + 15, "%zu", content_length);
-    } else if (strncasecmp(current, "Transfer-Encoding:", 18) == 0) {
-      if (strstr(current, "chunked")) {
-        *chunked = 1;
-      }
-    }
-
-    current = line_end + 2;
-  }
-
-  return 0;
+  return client_tcp_send(client->tcp, request, len, client->timeout_ms);
 }
 
-static int decode_chunked(const uint8_t *in, size_t in_len, char **out,
-                          size_t *out_len) {
-  if (!in || !out || !out_len) {
-    return -1;
-  }
+static int receive_response(HttpClient *client, int *keep_alive) {
+  char buffer[16384];
+  size_t total_received = 0;
+  HttpParser parser;
 
-  size_t pos = 0;
-  size_t alloc = 1024;
-  char *buf = malloc(alloc);
-  if (!buf) {
-    return -2;
-  }
-  size_t buf_len = 0;
+  *keep_alive = 0;
+  http_parser_init(&parser);
 
-  while (pos < in_len) {
-    size_t line_start = pos;
-    while (pos < in_len &&
-           !(in[pos] == '\r' && pos + 1 < in_len && in[pos + 1] == '\n')) {
-      pos++;
-    }
+  while (!http_parser_is_done(&parser)) {
+    /* Once the headers are in, bodies are received straight into their
+     * final buffer */
+    size_t window_len = 0;
+    char *window = http_parser_body_window(&parser, &window_len);
+    char *target = window ? window : buffer;
+    size_t target_len = window ? window_len : sizeof(buffer);
 
-    if (pos >= in_len) {
-      free(buf);
-      return -3;
-    }
+    int received =
+        client_tcp_recv(client->tcp, target, target_len, client->timeout_ms);
 
-    size_t line_len = pos - line_start;
-    if (line_len == 0) {
-      free(buf);
-      return -4;
-    }
-
-    char *hex = malloc(line_len + 1);
-    if (!hex) {
-      free(buf);
-      return -5;
-    }
-    memcpy(hex, in + line_start, line_len);
-    hex[line_len] = '\0';
-
-    char *endptr = NULL;
-    unsigned long chunk_size = strtoul(hex, &endptr, 16);
-    if (endptr == hex) {
-      free(hex);
-      free(buf);
-      return -6;
+    if (received < 0) {
+      http_parser_reset(&parser);
+      return total_received == 0 ? HTTP_RECV_NOTHING : -1;
     }
-    free(hex);
-
-    pos += 2;
 
-    if (chunk_size == 0) {
-      if (pos + 1 < in_len && in[pos] == '\r' && in[pos + 1] == '\n') {
-        pos += 2;
+    if (received == 0) {
+      if (http_parser_finish(&parser) != 0) {
+        http_parser_reset(&parser);
+        return total_received == 0 ? HTTP_RECV_NOTHING : -1;
       }
+      /* A message delimited by EOF leaves nothing to reuse */
+      parser.keep_alive = 0;
       break;
     }
 
-    if (pos + chunk_size > in_len) {
-      free(buf);
-      return -7;
-    }
+    total_received += received;
 
-    if (buf_len + chunk_size + 1 > alloc) {
-      while (buf_len + chunk_size + 1 > alloc) {
-        alloc *= 2;
-      }
-      char *nbuf = realloc(buf, alloc);
-      if (!nbuf) {
-        free(buf);
-        return -8;
+    if (window) {
+      if (http_parser_body_commit(&parser, (size_t)received) != 0) {
+        http_parser_reset(&parser);
+        return -1;
       }
-      buf = nbuf;
+      continue;
     }
 
-    memcpy(buf + buf_len, in + pos, chunk_size);
-    buf_len += chunk_size;
-    pos += chunk_size;
-
-    if (pos + 1 >= in_len || in[pos] != '\r' || in[pos + 1] != '\n') {
-      free(buf);
-      return -9;
+    long consumed = http_parser_feed(&parser, buffer, (size_t)received);
+    if (consumed < 0) {
+      http_parser_reset(&parser);
+      return -1;
     }
-    pos += 2;
-  }
 
-  if (buf_len + 1 > alloc) {
-    char *nbuf = realloc(buf, buf_len + 1);
-    if (!nbuf) {
-      free(buf);
-      return -10;
+    /* Bytes past the end of the message mean the stream is out of sync */
+    if ((size_t)consumed < (size_t)received) {
+      parser.keep_alive = 0;
     }
-    buf = nbuf;
   }
-  buf[buf_len] = '\0';
 
-  *out = buf;
-  *out_len = buf_len;
-  return 0;
+  client->status_code = parser.status_code;
+  memcpy(client->etag, parser.etag, sizeof(client->etag));
+  memcpy(client->last_modified, parser.last_modified,
+         sizeof(client->last_modified));
+  client->freshness = http_parser_freshness(&parser, time(NULL));
+  client->no_store = parser.no_store;
+  *keep_alive = parser.keep_alive;
+  client->response_body =
+      http_parser_take_body(&parser, &client->response_size);
+  http_parser_reset(&parser);
+
+  return client->response_body ? 0 : -1;
 }
@@ -2,23 +2,60 @@
 #define HTTP_CLIENT_H
 
 #include "client_tcp.h"
+#include "connection_pool.h"
+#include "http_parser.h"
 
 #include <stddef.h>
 
+#define HTTP_REQUEST_MAX 2048
+
 typedef struct {
-  ClientTCP *tcp;
+  ClientTCP *tcp; /* connection leased from the pool for the current request */
+  ConnectionPool *pool;
+  int owns_pool;
   char url[1024];
   int status_code;
   char *response_body;
   size_t response_size;
+  char etag[HTTP_VALIDATOR_MAX]; /* validators of the last response */
+  char last_modified[HTTP_VALIDATOR_MAX];
+  long freshness; /* see http_parser_freshness() */
+  int no_store;
   int timeout_ms;
 } HttpClient;
 
 HttpClient *http_client_create(int timeout_ms);
+/* Uses a caller-owned pool, which must outlive the client */
+HttpClient *http_client_create_with_pool(int timeout_ms, ConnectionPool *pool);
 void http_client_destroy(HttpClient *client);
+/* Any response with a status in 200-599 succeeds; callers decide what a
+ * status means */
 int http_client_get(HttpClient *client, const char *url, char **error);
+/* Revalidating GET: sends If-None-Match and If-Modified-Since for whichever
+ * of etag and last_modified is non-empty (NULL for none). A 304 status then
+ * means the cached copy is current, and comes with an empty body. */
+int http_client_get_conditional(HttpClient *client, const char *url,
+                                const char *etag, const char *last_modified,
+                                char **error);
 int http_client_get_status_code(HttpClient *client);
 const char *http_client_get_body(HttpClient *client);
 size_t http_client_get_body_size(HttpClient *client);
+/* Validators of the last response, empty strings when it had none */
+const char *http_client_get_etag(HttpClient *client);
+const char *http_client_get_last_modified(HttpClient *client);
+/* Caching directives of the last response: seconds it may be cached as fresh
+ * (-1 when it did not say), and whether it forbade storing it at all */
+long http_client_get_freshness(HttpClient *client);
+int http_client_get_no_store(HttpClient *client);
+
+/* Shared with the event-driven client (http_async.h). hostname must hold 256
+ * bytes and path 512. */
+int http_parse_url(const char *url, char *hostname, int *port, char *path);
+/* Writes a GET request into buffer, conditional on etag and last_modified
+ * when either is non-empty (see http_client_get_conditional). Returns its
+ * length or -1 if it does not fit. */
+int http_format_request(char *buffer, size_t size, const char *host,
+                        const char *path, const char *etag,
+                        const char *last_modified);
 
 #endif
@@ -0,0 +1,520 @@
+#include "http_parser.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define HTTP_PARSER_INITIAL_BODY 4096
+/* Smallest receive window offered for bodies of unknown length */
+#define HTTP_PARSER_MIN_WINDOW 4096
+
+void http_parser_init(HttpParser *parser) {
+  memset(parser, 0, sizeof(HttpParser));
+  parser->state = HTTP_PARSER_STATUS_LINE;
+  parser->max_age = -1;
+  parser->max_body = HTTP_PARSER_MAX_BODY;
+}
+
+void http_parser_reset(HttpParser *parser) {
+  size_t max_body = parser->max_body;
+  free(parser->body);
+  http_parser_init(parser);
+  parser->max_body = max_body;
+}
+
+static int reserve_body(HttpParser *parser, size_t extra) {
+  if (extra > parser->max_body - parser->body_len) {
+    return -1;
+  }
+
+  size_t needed = parser->body_len + extra + 1;
+  if (needed <= parser->body_cap) {
+    return 0;
+  }
+
+  size_t cap = parser->body_cap ? parser->body_cap : HTTP_PARSER_INITIAL_BODY;
+  while (cap < needed) {
+    cap *= 2;
+  }
+  if (cap > parser->max_body + 1) {
+    cap = parser->max_body + 1;
+  }
+
+  char *body = realloc(parser->body, cap);
+  if (!body) {
+    return -1;
+  }
+
+  parser->body = body;
+  parser->body_cap = cap;
+  return 0;
+}
+
+static void append_body(HttpParser *parser, const char *data, size_t len) {
+  memcpy(parser->body + parser->body_len, data, len);
+  parser->body_len += len;
+  parser->body[parser->body_len] = '\0';
+}
+
+static const char *header_value(const char *line, size_t name_len) {
+  const char *value = line + name_len;
+  while (*value == ' ' || *value == '\t') {
+    value++;
+  }
+  return value;
+}
+
+/* Case-insensitive search for token in a header value */
+static int value_has_token(const char *value, const char *token) {
+  size_t token_len = strlen(token);
+  for (; *value; value++) {
+    if (strncasecmp(value, token, token_len) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Keeps a validator only if it fits and is safe to echo back in a request */
+static void copy_validator(char *dest, const char *value) {
+  size_t len = strlen(value);
+  while (len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t')) {
+    len--;
+  }
+
+  dest[0] = '\0';
+  if (len == 0 || len >= HTTP_VALIDATOR_MAX) {
+    return;
+  }
+  for (size_t i = 0; i < len; i++) {
+    if ((unsigned char)value[i] < 0x20) {
+      return;
+    }
+  }
+
+  memcpy(dest, value, len);
+  dest[len] = '\0';
+}
+
+/* Parses an IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT"), the only form
+ * servers may send; returns 0 if value is not one */
+static time_t parse_http_date(const char *value) {
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  char month[4];
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  if (sscanf(value, "%*3s, %2d %3s %4d %2d:%2d:%2d GMT", &tm.tm_mday, month,
+             &tm.tm_year, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+    return 0;
+  }
+
+  const char *found = strstr(months, month);
+  if (!found || strlen(month) != 3 || (found - months) % 3 != 0) {
+    return 0;
+  }
+  tm.tm_mon = (int)(found - months) / 3;
+  tm.tm_year -= 1900;
+
+  time_t parsed = timegm(&tm);
+  return parsed > 0 ? parsed : 0;
+}
+
+/* Picks max-age and no-store out of a Cache-Control value; other
+ * directives, s-maxage included, do not apply to a private cache */
+static void parse_cache_control(HttpParser *parser, const char *value) {
+  while (*value) {
+    while (*value == ' ' || *value == '\t' || *value == ',') {
+      value++;
+    }
+    size_t len = strcspn(value, ",");
+
+    if (len >= 8 && strncasecmp(value, "no-store", 8) == 0 &&
+        strspn(value + 8, " \t") == len - 8) {
+      parser->no_store = 1;
+    } else if (len > 8 && strncasecmp(value, "max-age=", 8) == 0) {
+      const char *number = value + 8;
+      if (*number == '"') {
+        number++;
+      }
+      char *end;
+      long max_age = strtol(number, &end, 10);
+      if (end != number && max_age >= 0) {
+        parser->max_age = max_age;
+      }
+    }
+
+    value += len;
+  }
+}
+
+/* Content-Length is 1*DIGIT; anything else, or a length over max_body, is
+ * refused rather than trusted to size the body buffer */
+static int parse_content_length(HttpParser *parser, const char *value) {
+  size_t length = 0;
+  const char *p = value;
+  for (; *p >= '0' && *p <= '9'; p++) {
+    size_t digit = (size_t)(*p - '0');
+    if (length > (SIZE_MAX - digit) / 10) {
+      return -1;
+    }
+    length = length * 10 + digit;
+    if (length > parser->max_body) {
+      return -1;
+    }
+  }
+
+  if (p == value || p[strspn(p, " \t")] != '\0') {
+    return -1;
+  }
+
+  /* Repeated headers must agree, or the message boundary is ambiguous */
+  if (parser->has_content_length && parser->content_length != length) {
+    return -1;
+  }
+
+  parser->content_length = length;
+  parser->has_content_length = 1;
+  return 0;
+}
+
+static int parse_status_line(HttpParser *parser) {
+  int major = 0;
+  if (sscanf(parser->line, "HTTP/%d.%d %d", &major, &parser->http_minor,
+             &parser->status_code) != 3) {
+    return -1;
+  }
+
+  /* HTTP/1.1 defaults to persistent connections, HTTP/1.0 does not */
+  parser->keep_alive = major > 1 || (major == 1 && parser->http_minor >= 1);
+  return 0;
+}
+
+static int parse_header_line(HttpParser *parser) {
+  const char *line = parser->line;
+
+  if (strncasecmp(line, "Content-Length:", 15) == 0) {
+    return parse_content_length(parser, header_value(line, 15));
+  } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+    if (value_has_token(line + 18, "chunked")) {
+      parser->chunked = 1;
+    }
+  } else if (strncasecmp(line, "ETag:", 5) == 0) {
+    copy_validator(parser->etag, header_value(line, 5));
+  } else if (strncasecmp(line, "Last-Modified:", 14) == 0) {
+    copy_validator(parser->last_modified, header_value(line, 14));
+  } else if (strncasecmp(line, "Cache-Control:", 14) == 0) {
+    parse_cache_control(parser, header_value(line, 14));
+  } else if (strncasecmp(line, "Expires:", 8) == 0) {
+    time_t expires = parse_http_date(header_value(line, 8));
+    parser->expires = expires > 0 ? expires : 1;
+  } else if (strncasecmp(line, "Date:", 5) == 0) {
+    parser->date = parse_http_date(header_value(line, 5));
+  } else if (strncasecmp(line, "Connection:", 11) == 0) {
+    const char *value = header_value(line, 11);
+    if (strncasecmp(value, "close", 5) == 0) {
+      parser->keep_alive = 0;
+    } else if (strncasecmp(value, "keep-alive", 10) == 0) {
+      parser->keep_alive = 1;
+    }
+  }
+  return 0;
+}
+
+static int allocate_body(HttpParser *parser, size_t capacity) {
+  if (capacity > parser->max_body || capacity == SIZE_MAX) {
+    return -1;
+  }
+
+  parser->body = malloc(capacity + 1);
+  if (!parser->body) {
+    return -1;
+  }
+  parser->body_cap = capacity + 1;
+  parser->body_len = 0;
+  parser->body[0] = '\0';
+  return 0;
+}
+
+static size_t initial_body(const HttpParser *parser) {
+  return parser->max_body < HTTP_PARSER_INITIAL_BODY ? parser->max_body
+                                                     : HTTP_PARSER_INITIAL_BODY;
+}
+
+/* Called on the blank line that ends the header block */
+static int begin_body(HttpParser *parser) {
+  int status = parser->status_code;
+
+  /* 100 Continue, 103 Early Hints... precede the real response: forget
+   * their headers and read the next status line. 101 is final, the
+   * connection stops speaking HTTP after it. */
+  if (status >= 100 && status < 200 && status != 101) {
+    size_t max_body = parser->max_body;
+    http_parser_init(parser);
+    parser->max_body = max_body;
+    return 0;
+  }
+
+  if (status == 101 || status == 204 || status == 304) {
+    parser->state = HTTP_PARSER_DONE;
+    return allocate_body(parser, 0);
+  }
+
+  if (parser->chunked) {
+    parser->state = HTTP_PARSER_BODY_CHUNKED;
+    http_chunked_init(&parser->chunked_decoder);
+    return allocate_body(parser, initial_body(parser));
+  }
+
+  if (parser->has_content_length) {
+    /* Sized exactly once, the body is never reallocated after this */
+    parser->state = parser->content_length > 0 ? HTTP_PARSER_BODY_LENGTH
+                                               : HTTP_PARSER_DONE;
+    return allocate_body(parser, parser->content_length);
+  }
+
+  parser->keep_alive = 0;
+  parser->state = HTTP_PARSER_BODY_EOF;
+  return allocate_body(parser, initial_body(parser));
+}
+
+/* Accumulates a CRLF-terminated line. Returns 1 when a full line is ready,
+ * 0 if more bytes are needed. Overlong lines are truncated, which only loses
+ * the tail of headers the parser does not care about. */
+static int read_line(HttpParser *parser, const char *data, size_t len,
+                     size_t *pos) {
+  while (*pos < len) {
+    char c = data[(*pos)++];
+    if (c == '\n') {
+      if (parser->line_len > 0 && parser->line[parser->line_len - 1] == '\r') {
+        parser->line_len--;
+      }
+      parser->line[parser->line_len] = '\0';
+      return 1;
+    }
+    if (parser->line_len + 1 < HTTP_PARSER_MAX_LINE) {
+      parser->line[parser->line_len++] = c;
+    }
+  }
+  return 0;
+}
+
+/* Decodes raw chunked bytes that already sit at the tail of the body buffer.
+ * Returns the number of raw bytes consumed or -1 on malformed framing. */
+static long decode_body_tail(HttpParser *parser, size_t raw_len) {
+  size_t consumed = 0;
+  long decoded = http_chunked_decode(&parser->chunked_decoder,
+                                     parser->body + parser->body_len, raw_len,
+                                     &consumed);
+  if (decoded < 0) {
+    return -1;
+  }
+
+  parser->body_len += (size_t)decoded;
+  parser->body[parser->body_len] = '\0';
+
+  if (http_chunked_is_done(&parser->chunked_decoder)) {
+    parser->state = HTTP_PARSER_DONE;
+  }
+
+  return (long)consumed;
+}
+
+long http_parser_feed(HttpParser *parser, const char *data, size_t len) {
+  if (!parser || (!data && len > 0)) {
+    return -1;
+  }
+
+  size_t pos = 0;
+
+  while (pos < len) {
+    switch (parser->state) {
+    case HTTP_PARSER_STATUS_LINE:
+      if (read_line(parser, data, len, &pos)) {
+        if (parse_status_line(parser) != 0) {
+          parser->state = HTTP_PARSER_ERROR;
+          return -1;
+        }
+        parser->line_len = 0;
+        parser->state = HTTP_PARSER_HEADERS;
+      }
+      break;
+
+    case HTTP_PARSER_HEADERS:
+      if (read_line(parser, data, len, &pos)) {
+        if (parser->line_len == 0) {
+          if (begin_body(parser) != 0) {
+            parser->state = HTTP_PARSER_ERROR;
+            return -1;
+          }
+        } else if (parse_header_line(parser) != 0) {
+          parser->state = HTTP_PARSER_ERROR;
+          return -1;
+        }
+        parser->line_len = 0;
+      }
+      break;
+
+    case HTTP_PARSER_BODY_LENGTH: {
+      size_t want = parser->content_length - parser->body_len;
+      size_t take = len - pos < want ? len - pos : want;
+      append_body(parser, data + pos, take);
+      pos += take;
+      if (parser->body_len == parser->content_length) {
+        parser->state = HTTP_PARSER_DONE;
+      }
+      break;
+    }
+
+    case HTTP_PARSER_BODY_CHUNKED: {
+      if (reserve_body(parser, len - pos) != 0) {
+        parser->state = HTTP_PARSER_ERROR;
+        return -1;
+      }
+      memcpy(parser->body + parser->body_len, data + pos, len - pos);
+      long used = decode_body_tail(parser, len - pos);
+      if (used < 0) {
+        parser->state = HTTP_PARSER_ERROR;
+        return -1;
+      }
+      pos += (size_t)used;
+      break;
+    }
+
+    case HTTP_PARSER_BODY_EOF:
+      if (reserve_body(parser, len - pos) != 0) {
+        parser->state = HTTP_PARSER_ERROR;
+        return -1;
+      }
+      append_body(parser, data + pos, len - pos);
+      pos = len;
+      break;
+
+    case HTTP_PARSER_DONE:
+      return (long)pos;
+
+    case HTTP_PARSER_ERROR:
+      return -1;
+    }
+  }
+
+  return (long)pos;
+}
+
+char *http_parser_body_window(HttpParser *parser, size_t *available) {
+  if (!parser) {
+    return NULL;
+  }
+
+  switch (parser->state) {
+  case HTTP_PARSER_BODY_LENGTH:
+    *available = parser->content_length - parser->body_len;
+    return parser->body + parser->body_len;
+
+  case HTTP_PARSER_BODY_CHUNKED:
+  case HTTP_PARSER_BODY_EOF: {
+    /* Never offer room past max_body; once it is reached the caller feeds
+     * the parser instead, which fails on any further byte */
+    size_t window = parser->max_body - parser->body_len;
+    if (window > HTTP_PARSER_MIN_WINDOW) {
+      window = HTTP_PARSER_MIN_WINDOW;
+    }
+    if (window == 0 || reserve_body(parser, window) != 0) {
+      return NULL;
+    }
+    *available = parser->body_cap - parser->body_len - 1;
+    return parser->body + parser->body_len;
+  }
+
+  default:
+    return NULL;
+  }
+}
+
+int http_parser_body_commit(HttpParser *parser, size_t len) {
+  if (!parser) {
+    return -1;
+  }
+
+  switch (parser->state) {
+  case HTTP_PARSER_BODY_LENGTH:
+    if (len > parser->content_length - parser->body_len) {
+      return -1;
+    }
+    parser->body_len += len;
+    parser->body[parser->body_len] = '\0';
+    if (parser->body_len == parser->content_length) {
+      parser->state = HTTP_PARSER_DONE;
+    }
+    return 0;
+
+  case HTTP_PARSER_BODY_CHUNKED: {
+    long used = decode_body_tail(parser, len);
+    if (used < 0) {
+      parser->state = HTTP_PARSER_ERROR;
+      return -1;
+    }
+    /* Bytes past the terminator belong to no request we sent */
+    if ((size_t)used < len) {
+      parser->keep_alive = 0;
+    }
+    return 0;
+  }
+
+  case HTTP_PARSER_BODY_EOF:
+    if (len >= parser->body_cap - parser->body_len) {
+      return -1;
+    }
+    parser->body_len += len;
+    parser->body[parser->body_len] = '\0';
+    return 0;
+
+  default:
+    return -1;
+  }
+}
+
+int http_parser_finish(HttpParser *parser) {
+  if (!parser) {
+    return -1;
+  }
+
+  if (parser->state == HTTP_PARSER_BODY_EOF) {
+    parser->state = HTTP_PARSER_DONE;
+  }
+
+  return parser->state == HTTP_PARSER_DONE ? 0 : -1;
+}
+
+int http_parser_is_done(const HttpParser *parser) {
+  return parser && parser->state == HTTP_PARSER_DONE;
+}
+
+long http_parser_freshness(const HttpParser *parser, time_t now) {
+  if (parser->max_age >= 0) {
+    return parser->max_age;
+  }
+  if (parser->expires > 0) {
+    /* Measured against the server's clock, so client skew does not count */
+    time_t base = parser->date > 0 ? parser->date : now;
+    return parser->expires > base ? (long)(parser->expires - base) : 0;
+  }
+  return -1;
+}
+
+char *http_parser_take_body(HttpParser *parser, size_t *len) {
+  if (!parser) {
+    return NULL;
+  }
+
+  char *body = parser->body;
+  if (len) {
+    *len = parser->body_len;
+  }
+
+  parser->body = NULL;
+  parser->body_len = 0;
+  parser->body_cap = 0;
+  return body;
+}
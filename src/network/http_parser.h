@@ -0,0 +1,102 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include "http_chunked.h"
+
+#include <stddef.h>
+#include <time.h>
+
+#define HTTP_PARSER_MAX_LINE 1024
+/* Room for an ETag or Last-Modified value; longer ones are not kept */
+#define HTTP_VALIDATOR_MAX 128
+/* Default for HttpParser.max_body */
+#define HTTP_PARSER_MAX_BODY (64 * 1024 * 1024)
+
+typedef enum {
+  HTTP_PARSER_STATUS_LINE,
+  HTTP_PARSER_HEADERS,
+  HTTP_PARSER_BODY_LENGTH,  /* body delimited by Content-Length */
+  HTTP_PARSER_BODY_CHUNKED, /* body delimited by the zero-size chunk */
+  HTTP_PARSER_BODY_EOF,     /* body delimited by connection close */
+  HTTP_PARSER_DONE,
+  HTTP_PARSER_ERROR
+} HttpParserState;
+
+/*
+  Incremental HTTP/1.x response parser
+    Bytes are fed as they arrive from the socket; the parser knows from the
+  headers exactly where the message ends, so callers can stop reading at
+  Content-Length or at the terminating chunk instead of waiting for EOF. With
+  Content-Length the body buffer is allocated once at its final size.
+    A response whose body would exceed max_body fails to parse, whatever its
+  framing, so a hostile Content-Length cannot size the buffer.
+*/
+typedef struct {
+  HttpParserState state;
+
+  int status_code;
+  int http_minor;
+  int keep_alive;
+  int chunked;
+  int has_content_length;
+  size_t content_length;
+  size_t max_body; /* HTTP_PARSER_MAX_BODY unless set after init */
+
+  /* Cache validators, empty when the response carried none */
+  char etag[HTTP_VALIDATOR_MAX];
+  char last_modified[HTTP_VALIDATOR_MAX];
+
+  /* Caching directives: max_age is -1 without Cache-Control: max-age, and
+   * expires / date are 0 without their headers. An Expires that is not a
+   * valid date counts as already past. */
+  int no_store;
+  long max_age;
+  time_t expires;
+  time_t date;
+
+  char line[HTTP_PARSER_MAX_LINE];
+  size_t line_len;
+
+  char *body;
+  size_t body_len;
+  size_t body_cap;
+
+  HttpChunkedDecoder chunked_decoder;
+} HttpParser;
+
+void http_parser_init(HttpParser *parser);
+
+/* Releases the body buffer (unless taken) and resets the parser for reuse,
+ * keeping max_body */
+void http_parser_reset(HttpParser *parser);
+
+/*
+  Consumes up to len bytes. Returns the number of bytes consumed, which is
+  less than len only when the message completed before the end of data, or -1
+  on a malformed response.
+*/
+long http_parser_feed(HttpParser *parser, const char *data, size_t len);
+
+/*
+  Direct-to-body receive: once the headers are parsed, returns a pointer into
+  the body buffer with room for *available bytes, or NULL while the parser is
+  still reading headers. After receiving n bytes into it, call
+  http_parser_body_commit(parser, n). Chunked framing is decoded in place
+  there, so the receive buffer and the body buffer are the same memory.
+*/
+char *http_parser_body_window(HttpParser *parser, size_t *available);
+int http_parser_body_commit(HttpParser *parser, size_t len);
+
+/* Signals EOF from the peer. Returns 0 if that completes the message */
+int http_parser_finish(HttpParser *parser);
+
+int http_parser_is_done(const HttpParser *parser);
+
+/* Seconds the response may be cached as fresh, from max-age or else from
+ * Expires relative to Date (now if absent); -1 when it says neither */
+long http_parser_freshness(const HttpParser *parser, time_t now);
+
+/* Transfers ownership of the NUL-terminated body to the caller */
+char *http_parser_take_body(HttpParser *parser, size_t *len);
+
+#endif
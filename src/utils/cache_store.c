@@ -0,0 +1,762 @@
+#include "cache_store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STORE_MAGIC 0x5357434aU /* "JCWS" */
+#define STORE_VERSION 3
+#define RECORD_MAGIC 0x4352574aU /* "JWRC" */
+#define STORE_HEADER_SIZE 4096
+/* Least amount a store file grows by when it runs out of room */
+#define STORE_GROW_MIN (1024 * 1024)
+
+/* Every field is an aligned 64-bit word (after the two tags), so each one is
+ * updated atomically even when other processes read it concurrently */
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t index_slots; /* power of two */
+  uint64_t data_start;
+  uint64_t data_end; /* end of the last published record */
+  uint64_t live_bytes;
+  uint64_t dead_bytes;
+  uint64_t entry_count;
+  uint64_t replaced; /* a compacted successor was renamed over this file */
+} StoreHeader;
+
+typedef struct {
+  uint64_t hash;
+  uint64_t offset; /* 0 for an empty slot */
+} StoreSlot;
+
+/* Followed by the key (not NUL-terminated), the meta bytes and the data,
+ * padded to 8 bytes */
+typedef struct {
+  uint32_t magic;
+  uint32_t crc; /* over everything from key_len on */
+
+  /* Not checksummed: cache_store_touch() rewrites them in place, each with
+   * a single aligned store */
+  int64_t fresh_until;
+  int64_t expires_at;
+
+  uint32_t key_len;
+  uint32_t meta_len;
+  uint32_t data_len;
+  uint32_t reserved;
+  uint64_t hash;
+} StoreRecord;
+
+struct CacheStore {
+  char path[512];
+  int fd;
+  char *map;
+  size_t map_size;
+
+  /* Held shared while the mapping is used, exclusively to replace it. The
+   * mapping is only ever replaced by a holder of write_mutex. */
+  pthread_rwlock_t map_lock;
+  /* One writer per process; flock() on fd orders processes */
+  pthread_mutex_t write_mutex;
+
+  pthread_t compactor;
+  int compactor_running;
+  int compactor_joinable;
+};
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) {
+      c = (c & 1) ? 0xedb88320U ^ (c >> 1) : c >> 1;
+    }
+    crc_table[i] = c;
+  }
+}
+
+/* CRC-32 (IEEE) */
+static uint32_t crc32_of(const void *data, size_t len) {
+  const unsigned char *p = data;
+  uint32_t crc = 0xffffffffU;
+  while (len--) {
+    crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static size_t record_size(uint64_t key_len, uint64_t meta_len,
+                          uint64_t data_len) {
+  return (sizeof(StoreRecord) + key_len + meta_len + data_len + 7) &
+         ~(size_t)7;
+}
+
+static size_t stored_size(const StoreRecord *record) {
+  return record_size(record->key_len, record->meta_len, record->data_len);
+}
+
+static uint32_t record_crc(const StoreRecord *record) {
+  size_t covered = sizeof(StoreRecord) - offsetof(StoreRecord, key_len) +
+                   record->key_len + record->meta_len + record->data_len;
+  return crc32_of(&record->key_len, covered);
+}
+
+static uint64_t data_start_for(uint64_t slots) {
+  return STORE_HEADER_SIZE + slots * sizeof(StoreSlot);
+}
+
+static StoreHeader *header_of(const CacheStore *store) {
+  return (StoreHeader *)store->map;
+}
+
+static StoreSlot *slots_of(const CacheStore *store) {
+  return (StoreSlot *)(store->map + STORE_HEADER_SIZE);
+}
+
+static int header_is_valid(const char *map, size_t size) {
+  const StoreHeader *header = (const StoreHeader *)map;
+  return header->magic == STORE_MAGIC && header->version == STORE_VERSION &&
+         header->index_slots > 0 &&
+         (header->index_slots & (header->index_slots - 1)) == 0 &&
+         header->index_slots <= size / sizeof(StoreSlot) &&
+         header->data_start == data_start_for(header->index_slots) &&
+         header->data_start <= header->data_end && header->data_end <= size;
+}
+
+/* Truncates fd to an empty store with the given index and data capacity */
+static int init_file(int fd, uint64_t slots, size_t data_capacity) {
+  StoreHeader header = {0};
+  header.magic = STORE_MAGIC;
+  header.version = STORE_VERSION;
+  header.index_slots = slots;
+  header.data_start = data_start_for(slots);
+  header.data_end = header.data_start;
+
+  /* Truncating to zero first leaves the whole index zeroed */
+  if (ftruncate(fd, 0) != 0 ||
+      ftruncate(fd, (off_t)(header.data_start + data_capacity)) != 0) {
+    return -1;
+  }
+
+  return pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)
+             ? 0
+             : -1;
+}
+
+/* Makes fd the store's file, replacing (and closing) the current one. Caller
+ * holds map_lock exclusively or is the only user of the store. */
+static int map_file(CacheStore *store, int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < STORE_HEADER_SIZE) {
+    return -1;
+  }
+
+  size_t size = (size_t)st.st_size;
+  char *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    return -1;
+  }
+
+  if (!header_is_valid(map, size)) {
+    munmap(map, size);
+    return -1;
+  }
+
+  if (store->map) {
+    munmap(store->map, store->map_size);
+  }
+  if (store->fd >= 0 && store->fd != fd) {
+    close(store->fd);
+  }
+
+  store->fd = fd;
+  store->map = map;
+  store->map_size = size;
+  return 0;
+}
+
+/* Follows renames by compaction in other processes and picks up growth of
+ * the file. Caller holds write_mutex and map_lock exclusively. */
+static int refresh_mapping(CacheStore *store) {
+  while (__atomic_load_n(&header_of(store)->replaced, __ATOMIC_ACQUIRE)) {
+    int fd = open(store->path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+      return -1;
+    }
+    if (map_file(store, fd) != 0) {
+      close(fd);
+      return -1;
+    }
+  }
+
+  struct stat st;
+  if (fstat(store->fd, &st) != 0) {
+    return -1;
+  }
+  if ((size_t)st.st_size != store->map_size) {
+    return map_file(store, store->fd);
+  }
+  return 0;
+}
+
+/* Caller holds map_lock */
+static int mapping_is_stale(const CacheStore *store) {
+  const StoreHeader *header = header_of(store);
+  return __atomic_load_n(&header->replaced, __ATOMIC_ACQUIRE) ||
+         __atomic_load_n(&header->data_end, __ATOMIC_ACQUIRE) >
+             store->map_size;
+}
+
+/* Caller holds write_mutex */
+static int refresh(CacheStore *store) {
+  pthread_rwlock_wrlock(&store->map_lock);
+  int result = refresh_mapping(store);
+  pthread_rwlock_unlock(&store->map_lock);
+  return result;
+}
+
+/* Takes the cross-process write lock on the current file, following any
+ * rename that happened first. Caller holds write_mutex. */
+static int lock_file(CacheStore *store) {
+  for (;;) {
+    if (flock(store->fd, LOCK_EX) != 0) {
+      return -1;
+    }
+    if (!__atomic_load_n(&header_of(store)->replaced, __ATOMIC_ACQUIRE)) {
+      return 0;
+    }
+    flock(store->fd, LOCK_UN);
+    if (refresh(store) != 0) {
+      return -1;
+    }
+  }
+}
+
+static void unlock_file(CacheStore *store) {
+  flock(store->fd, LOCK_UN);
+}
+
+/* Returns the checksummed record at offset, or NULL if there is none.
+ * Caller holds map_lock. */
+static const StoreRecord *record_at(const CacheStore *store, uint64_t offset,
+                                    uint64_t data_end) {
+  const StoreHeader *header = header_of(store);
+  if (offset < header->data_start || offset % 8 != 0 ||
+      offset + sizeof(StoreRecord) > data_end) {
+    return NULL;
+  }
+
+  const StoreRecord *record = (const StoreRecord *)(store->map + offset);
+  if (record->magic != RECORD_MAGIC ||
+      offset + sizeof(StoreRecord) + (uint64_t)record->key_len +
+              record->meta_len + record->data_len >
+          data_end ||
+      record_crc(record) != record->crc) {
+    return NULL;
+  }
+
+  return record;
+}
+
+/*
+  Probes the index for key. Returns its record, or NULL with *slot_out set to
+  the empty slot where it belongs (NULL if the index is full). On a hit
+  *slot_out is the key's slot. Caller holds map_lock.
+*/
+static const StoreRecord *find_record(const CacheStore *store,
+                                      const char *key, size_t key_len,
+                                      uint64_t hash, StoreSlot **slot_out) {
+  const StoreHeader *header = header_of(store);
+  StoreSlot *slots = slots_of(store);
+  uint64_t mask = header->index_slots - 1;
+
+  uint64_t data_end = __atomic_load_n(&header->data_end, __ATOMIC_ACQUIRE);
+  if (data_end > store->map_size) {
+    data_end = store->map_size;
+  }
+
+  *slot_out = NULL;
+  uint64_t i = hash & mask;
+  for (uint64_t probes = 0; probes <= mask; probes++, i = (i + 1) & mask) {
+    /* The hash is written before the offset is published */
+    uint64_t offset = __atomic_load_n(&slots[i].offset, __ATOMIC_ACQUIRE);
+    if (offset == 0) {
+      *slot_out = &slots[i];
+      return NULL;
+    }
+    if (slots[i].hash != hash) {
+      continue;
+    }
+
+    const StoreRecord *record = record_at(store, offset, data_end);
+    if (record && record->key_len == key_len &&
+        memcmp(record + 1, key, key_len) == 0) {
+      *slot_out = &slots[i];
+      return record;
+    }
+  }
+
+  return NULL;
+}
+
+static int needs_compaction(const StoreHeader *header) {
+  return header->dead_bytes >= CACHE_STORE_COMPACT_MIN_DEAD &&
+         header->dead_bytes > header->live_bytes;
+}
+
+/*
+  Writes the records worth keeping into a new file and renames it over the
+  store, then flags the old file as replaced for processes still mapping it.
+  Caller holds write_mutex and the file lock, which it holds on the new file
+  afterwards.
+*/
+static int compact_locked(CacheStore *store, int keep_records) {
+  time_t now = time(NULL);
+
+  pthread_rwlock_rdlock(&store->map_lock);
+
+  const StoreHeader *old_header = header_of(store);
+  const StoreSlot *old_slots = slots_of(store);
+  uint64_t old_end = old_header->data_end;
+
+  uint64_t live = 0;
+  uint64_t live_bytes = 0;
+  for (uint64_t i = 0; keep_records && i < old_header->index_slots; i++) {
+    const StoreRecord *record = record_at(store, old_slots[i].offset, old_end);
+    if (record && record->expires_at >= now) {
+      live++;
+      live_bytes += stored_size(record);
+    }
+  }
+
+  /* Leave the new index at most a quarter full */
+  uint64_t slots = CACHE_STORE_INITIAL_SLOTS;
+  while (slots < (live + 1) * 4) {
+    slots *= 2;
+  }
+
+  char tmp_path[sizeof(store->path) + 8];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", store->path);
+
+  int fd = mkstemp(tmp_path);
+  size_t size = data_start_for(slots) + live_bytes + STORE_GROW_MIN;
+  char *map = MAP_FAILED;
+  if (fd >= 0 && fchmod(fd, 0644) == 0 &&
+      init_file(fd, slots, live_bytes + STORE_GROW_MIN) == 0) {
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (map == MAP_FAILED) {
+    pthread_rwlock_unlock(&store->map_lock);
+    if (fd >= 0) {
+      close(fd);
+      unlink(tmp_path);
+    }
+    return -1;
+  }
+
+  StoreHeader *header = (StoreHeader *)map;
+  StoreSlot *new_slots = (StoreSlot *)(map + STORE_HEADER_SIZE);
+  uint64_t end = header->data_start;
+
+  for (uint64_t i = 0; keep_records && i < old_header->index_slots; i++) {
+    const StoreRecord *record = record_at(store, old_slots[i].offset, old_end);
+    if (!record || record->expires_at < now) {
+      continue;
+    }
+
+    size_t length = stored_size(record);
+    memcpy(map + end, record, length);
+
+    uint64_t j = record->hash & (slots - 1);
+    while (new_slots[j].offset != 0) {
+      j = (j + 1) & (slots - 1);
+    }
+    new_slots[j].hash = record->hash;
+    new_slots[j].offset = end;
+    end += length;
+  }
+
+  pthread_rwlock_unlock(&store->map_lock);
+
+  header->data_end = end;
+  header->live_bytes = live_bytes;
+  header->entry_count = live;
+  munmap(map, size);
+
+  /* The successor must be complete on disk before it becomes the store */
+  if (fdatasync(fd) != 0 || rename(tmp_path, store->path) != 0) {
+    close(fd);
+    unlink(tmp_path);
+    return -1;
+  }
+
+  pthread_rwlock_wrlock(&store->map_lock);
+  __atomic_store_n(&header_of(store)->replaced, 1, __ATOMIC_RELEASE);
+  int result = map_file(store, fd); /* closes the old file and its lock */
+  pthread_rwlock_unlock(&store->map_lock);
+
+  if (result != 0) {
+    close(fd);
+    return -1;
+  }
+
+  return flock(store->fd, LOCK_EX);
+}
+
+static void *compactor_main(void *arg) {
+  CacheStore *store = arg;
+
+  pthread_mutex_lock(&store->write_mutex);
+  if (lock_file(store) == 0) {
+    /* Another process may have compacted in the meantime */
+    if (needs_compaction(header_of(store))) {
+      compact_locked(store, 1);
+    }
+    unlock_file(store);
+  }
+  store->compactor_running = 0;
+  pthread_mutex_unlock(&store->write_mutex);
+
+  return NULL;
+}
+
+/* Caller holds write_mutex */
+static void start_compactor(CacheStore *store) {
+  if (store->compactor_running) {
+    return;
+  }
+
+  /* A finished compactor has released write_mutex and is just returning */
+  if (store->compactor_joinable) {
+    pthread_join(store->compactor, NULL);
+    store->compactor_joinable = 0;
+  }
+
+  if (pthread_create(&store->compactor, NULL, compactor_main, store) == 0) {
+    store->compactor_running = 1;
+    store->compactor_joinable = 1;
+  }
+}
+
+/* Makes room to append size bytes. Caller holds write_mutex and the file
+ * lock. */
+static int reserve(CacheStore *store, size_t size) {
+  pthread_rwlock_rdlock(&store->map_lock);
+  int grow = mapping_is_stale(store) ||
+             header_of(store)->data_end + size > store->map_size;
+  pthread_rwlock_unlock(&store->map_lock);
+
+  if (!grow) {
+    return 0;
+  }
+
+  pthread_rwlock_wrlock(&store->map_lock);
+  int result = refresh_mapping(store);
+  uint64_t needed = header_of(store)->data_end + size;
+  if (result == 0 && needed > store->map_size) {
+    size_t new_size = store->map_size * 2;
+    if (new_size < needed + STORE_GROW_MIN) {
+      new_size = needed + STORE_GROW_MIN;
+    }
+    result = ftruncate(store->fd, (off_t)new_size) == 0
+                 ? map_file(store, store->fd)
+                 : -1;
+  }
+  pthread_rwlock_unlock(&store->map_lock);
+
+  return result;
+}
+
+CacheStore *cache_store_open(const char *path) {
+  if (!path || strlen(path) >= sizeof(((CacheStore *)0)->path)) {
+    return NULL;
+  }
+
+  pthread_once(&crc_once, crc_init);
+
+  CacheStore *store = calloc(1, sizeof(CacheStore));
+  if (!store) {
+    return NULL;
+  }
+  store->fd = -1;
+  snprintf(store->path, sizeof(store->path), "%s", path);
+
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    free(store);
+    return NULL;
+  }
+
+  flock(fd, LOCK_EX);
+  if (map_file(store, fd) != 0) {
+    /* New, truncated or foreign file: start over */
+    if (init_file(fd, CACHE_STORE_INITIAL_SLOTS, STORE_GROW_MIN) != 0 ||
+        map_file(store, fd) != 0) {
+      flock(fd, LOCK_UN);
+      close(fd);
+      free(store);
+      return NULL;
+    }
+  }
+  flock(fd, LOCK_UN);
+
+  pthread_rwlock_init(&store->map_lock, NULL);
+  pthread_mutex_init(&store->write_mutex, NULL);
+  return store;
+}
+
+void cache_store_close(CacheStore *store) {
+  if (!store) {
+    return;
+  }
+
+  pthread_mutex_lock(&store->write_mutex);
+  int joinable = store->compactor_joinable;
+  pthread_mutex_unlock(&store->write_mutex);
+
+  if (joinable) {
+    pthread_join(store->compactor, NULL);
+  }
+
+  munmap(store->map, store->map_size);
+  close(store->fd);
+  pthread_rwlock_destroy(&store->map_lock);
+  pthread_mutex_destroy(&store->write_mutex);
+  free(store);
+}
+
+/* Appends one record and points the index at it. Caller holds write_mutex
+ * and the file lock. Sets *compact when dead space calls for compaction. */
+static int append_locked(CacheStore *store, const CacheStoreItem *item,
+                         int *compact) {
+  size_t key_len = strlen(item->key);
+  if (key_len > UINT32_MAX || item->meta_len > UINT32_MAX ||
+      item->len > UINT32_MAX) {
+    return -1;
+  }
+  size_t size = record_size(key_len, item->meta_len, item->len);
+
+  /* Keep the index at most three quarters full */
+  const StoreHeader *current = header_of(store);
+  if ((current->entry_count + 1) * 4 > current->index_slots * 3) {
+    compact_locked(store, 1);
+  }
+
+  if (reserve(store, size) != 0) {
+    return -1;
+  }
+
+  int result = -1;
+  pthread_rwlock_rdlock(&store->map_lock);
+
+  StoreHeader *header = header_of(store);
+  StoreSlot *slot = NULL;
+  const StoreRecord *old =
+      find_record(store, item->key, key_len, item->hash, &slot);
+
+  if (slot) {
+    uint64_t offset = header->data_end;
+    StoreRecord *record = (StoreRecord *)(store->map + offset);
+    char *body = (char *)(record + 1);
+    record->magic = RECORD_MAGIC;
+    record->fresh_until = (int64_t)item->fresh_until;
+    record->expires_at = (int64_t)item->expires_at;
+    record->key_len = (uint32_t)key_len;
+    record->meta_len = (uint32_t)item->meta_len;
+    record->data_len = (uint32_t)item->len;
+    record->reserved = 0;
+    record->hash = item->hash;
+    memcpy(body, item->key, key_len);
+    if (item->meta_len > 0) {
+      memcpy(body + key_len, item->meta, item->meta_len);
+    }
+    memcpy(body + key_len + item->meta_len, item->data, item->len);
+    record->crc = record_crc(record);
+
+    /* Publish the record, then point the index at it */
+    __atomic_store_n(&header->data_end, offset + size, __ATOMIC_RELEASE);
+    if (old) {
+      size_t old_size = stored_size(old);
+      header->dead_bytes += old_size;
+      header->live_bytes -= old_size;
+    } else {
+      slot->hash = item->hash;
+      header->entry_count++;
+    }
+    header->live_bytes += size;
+    __atomic_store_n(&slot->offset, offset, __ATOMIC_RELEASE);
+
+    *compact = *compact || needs_compaction(header);
+    result = 0;
+  }
+
+  pthread_rwlock_unlock(&store->map_lock);
+  return result;
+}
+
+int cache_store_put(CacheStore *store, const CacheStoreItem *item) {
+  return cache_store_put_many(store, item, 1) == 1 ? 0 : -1;
+}
+
+size_t cache_store_put_many(CacheStore *store, const CacheStoreItem *items,
+                            size_t count) {
+  if (!store || !items || count == 0) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&store->write_mutex);
+  if (lock_file(store) != 0) {
+    pthread_mutex_unlock(&store->write_mutex);
+    return 0;
+  }
+
+  size_t written = 0;
+  int compact = 0;
+  for (size_t i = 0; i < count; i++) {
+    const CacheStoreItem *item = &items[i];
+    if (item->key && (item->data || item->len == 0) &&
+        (item->meta || item->meta_len == 0) &&
+        append_locked(store, item, &compact) == 0) {
+      written++;
+    }
+  }
+
+  unlock_file(store);
+  if (compact) {
+    start_compactor(store);
+  }
+  pthread_mutex_unlock(&store->write_mutex);
+
+  return written;
+}
+
+int cache_store_get(CacheStore *store, const char *key, uint64_t hash,
+                    CacheStoreReader reader, void *userdata) {
+  if (!store || !key || !reader) {
+    return -1;
+  }
+
+  pthread_rwlock_rdlock(&store->map_lock);
+
+  if (mapping_is_stale(store)) {
+    pthread_rwlock_unlock(&store->map_lock);
+    pthread_mutex_lock(&store->write_mutex);
+    int refreshed = refresh(store);
+    pthread_mutex_unlock(&store->write_mutex);
+    if (refreshed != 0) {
+      return -1;
+    }
+    pthread_rwlock_rdlock(&store->map_lock);
+  }
+
+  StoreSlot *slot;
+  const StoreRecord *record = find_record(store, key, strlen(key), hash, &slot);
+
+  int result = -1;
+  time_t expires_at =
+      record ? (time_t)__atomic_load_n(&record->expires_at, __ATOMIC_RELAXED)
+             : 0;
+  if (record && expires_at >= time(NULL)) {
+    const char *body = (const char *)(record + 1);
+    CacheStoreItem item = {0};
+    item.key = key;
+    item.hash = hash;
+    item.meta = body + record->key_len;
+    item.meta_len = record->meta_len;
+    item.data = body + record->key_len + record->meta_len;
+    item.len = record->data_len;
+    item.fresh_until =
+        (time_t)__atomic_load_n(&record->fresh_until, __ATOMIC_RELAXED);
+    item.expires_at = expires_at;
+    reader(&item, userdata);
+    result = 0;
+  }
+
+  pthread_rwlock_unlock(&store->map_lock);
+  return result;
+}
+
+int cache_store_touch(CacheStore *store, const char *key, uint64_t hash,
+                      time_t fresh_until, time_t expires_at) {
+  if (!store || !key) {
+    return -1;
+  }
+
+  /* The write locks keep compaction from copying the record mid-update */
+  pthread_mutex_lock(&store->write_mutex);
+  if (lock_file(store) != 0) {
+    pthread_mutex_unlock(&store->write_mutex);
+    return -1;
+  }
+
+  pthread_rwlock_rdlock(&store->map_lock);
+  StoreSlot *slot;
+  StoreRecord *record = (StoreRecord *)find_record(store, key, strlen(key),
+                                                   hash, &slot);
+  if (record) {
+    __atomic_store_n(&record->fresh_until, (int64_t)fresh_until,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&record->expires_at, (int64_t)expires_at,
+                     __ATOMIC_RELAXED);
+  }
+  pthread_rwlock_unlock(&store->map_lock);
+
+  unlock_file(store);
+  pthread_mutex_unlock(&store->write_mutex);
+
+  return record ? 0 : -1;
+}
+
+int cache_store_clear(CacheStore *store) {
+  if (!store) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&store->write_mutex);
+  int result = lock_file(store);
+  if (result == 0) {
+    result = compact_locked(store, 0);
+    unlock_file(store);
+  }
+  pthread_mutex_unlock(&store->write_mutex);
+
+  return result;
+}
+
+int cache_store_compact(CacheStore *store) {
+  if (!store) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&store->write_mutex);
+  int result = lock_file(store);
+  if (result == 0) {
+    result = compact_locked(store, 1);
+    unlock_file(store);
+  }
+  pthread_mutex_unlock(&store->write_mutex);
+
+  return result;
+}
+
+size_t cache_store_count(CacheStore *store) {
+  if (!store) {
+    return 0;
+  }
+
+  pthread_rwlock_rdlock(&store->map_lock);
+  size_t count = (size_t)header_of(store)->entry_count;
+  pthread_rwlock_unlock(&store->map_lock);
+
+  return count;
+}
@@ -0,0 +1,85 @@
+#ifndef CACHE_STORE_H
+#define CACHE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Index slots of a new store; compaction sizes the index to its contents */
+#define CACHE_STORE_INITIAL_SLOTS 1024
+/* Background compaction starts once dead records take at least this many
+ * bytes and outweigh the live ones */
+#define CACHE_STORE_COMPACT_MIN_DEAD (1024 * 1024)
+
+/*
+  Persistent cache store: one append-only segment file, memory-mapped by
+  every process using it.
+    The file starts with a header and an open-addressing hash index of
+  {key hash, record offset} slots, followed by the records, each checksummed.
+  A lookup is a probe of the mapped index and a read of the mapped record,
+  with no syscall. A put appends a record and repoints the key's slot, so
+  replaced records become dead space that compaction reclaims by writing a
+  fresh file and renaming it over the old one; processes still mapping the
+  old file see it flagged as replaced and reopen.
+    Appends are serialized by a mutex within a process and by flock() across
+  processes. Records are written before they are published through the header
+  and then the index, and are checked against their CRC on every read, so a
+  crash mid-append loses at most that record.
+*/
+typedef struct CacheStore CacheStore;
+
+/*
+  A record as passed to cache_store_put() and handed to readers. hash is the
+  caller's hash of key and must be the same for every call with that key;
+  meta is opaque caller data kept beside the record's data. The store drops
+  the record after expires_at, and only keeps fresh_until for the caller.
+*/
+typedef struct {
+  const char *key;
+  uint64_t hash;
+  const char *meta;
+  size_t meta_len;
+  const char *data;
+  size_t len;
+  time_t fresh_until;
+  time_t expires_at;
+} CacheStoreItem;
+
+/* Receives a record, whose bytes are only valid during the call */
+typedef void (*CacheStoreReader)(const CacheStoreItem *item, void *userdata);
+
+/* Opens or creates the store at path; a file that fails validation is
+ * reinitialized empty */
+CacheStore *cache_store_open(const char *path);
+
+/* Waits for a running background compaction, then unmaps the store */
+void cache_store_close(CacheStore *store);
+
+/* Stores item, replacing any previous record for its key */
+int cache_store_put(CacheStore *store, const CacheStoreItem *item);
+
+/* Stores a batch of records under a single acquisition of the write locks,
+ * in order, so a later write to a key wins. Returns the number written. */
+size_t cache_store_put_many(CacheStore *store, const CacheStoreItem *items,
+                            size_t count);
+
+/* Calls reader with the record for key and returns 0, or returns -1 if the
+ * key is absent or expired */
+int cache_store_get(CacheStore *store, const char *key, uint64_t hash,
+                    CacheStoreReader reader, void *userdata);
+
+/* Replaces the deadlines of key's record in place, expired or not, without
+ * rewriting it. Returns -1 if the store holds no record for key. */
+int cache_store_touch(CacheStore *store, const char *key, uint64_t hash,
+                      time_t fresh_until, time_t expires_at);
+
+/* Replaces the store with an empty one, in every process using it */
+int cache_store_clear(CacheStore *store);
+
+/* Rewrites the store keeping only live, unexpired records */
+int cache_store_compact(CacheStore *store);
+
+/* Number of records reachable through the index, expired ones included */
+size_t cache_store_count(CacheStore *store);
+
+#endif
@@ -0,0 +1,388 @@
+#include "cache_writer.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct PendingWrite PendingWrite;
+struct PendingWrite {
+  CacheStoreItem item; /* points into buffer */
+  char *buffer;        /* key, meta and data */
+  size_t size;         /* bytes counted against max_pending_bytes */
+
+  /* Taken by the flusher: no longer coalesced into, but still readable
+   * through the index until it has been written */
+  int flushing;
+
+  PendingWrite *bucket_next; /* index chain */
+  PendingWrite *queue_next;  /* oldest first */
+};
+
+struct CacheWriter {
+  CacheStore *store;
+  size_t max_pending_bytes;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t work;    /* flusher waits for writes */
+  pthread_cond_t drained; /* producers wait for room or a batch */
+
+  PendingWrite *buckets[CACHE_WRITER_BUCKETS];
+  PendingWrite *queue_head;
+  PendingWrite *queue_tail;
+  size_t pending_bytes; /* queued and being written */
+
+  /* Batches taken and finished by the flusher; a flush waits on these */
+  uint64_t batches_started;
+  uint64_t batches_done;
+
+  int urgent; /* someone is waiting: flush without lingering */
+  int stopping;
+  pthread_t thread;
+};
+
+static void free_pending(PendingWrite *pending) {
+  if (pending) {
+    free(pending->buffer);
+    free(pending);
+  }
+}
+
+static void free_pending_list(PendingWrite *pending) {
+  while (pending) {
+    PendingWrite *next = pending->queue_next;
+    free_pending(pending);
+    pending = next;
+  }
+}
+
+static PendingWrite **bucket_of(CacheWriter *writer, uint64_t hash) {
+  return &writer->buckets[hash & (CACHE_WRITER_BUCKETS - 1)];
+}
+
+static PendingWrite *index_find(CacheWriter *writer, const char *key,
+                                uint64_t hash) {
+  for (PendingWrite *p = *bucket_of(writer, hash); p; p = p->bucket_next) {
+    if (p->item.hash == hash && strcmp(p->item.key, key) == 0) {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+/* Removes pending from the index if it is still there: a newer write to the
+ * same key may have taken its place */
+static void index_remove(CacheWriter *writer, PendingWrite *pending) {
+  for (PendingWrite **link = bucket_of(writer, pending->item.hash); *link;
+       link = &(*link)->bucket_next) {
+    if (*link == pending) {
+      *link = pending->bucket_next;
+      return;
+    }
+  }
+}
+
+static void index_insert(CacheWriter *writer, PendingWrite *pending) {
+  PendingWrite **bucket = bucket_of(writer, pending->item.hash);
+  pending->bucket_next = *bucket;
+  *bucket = pending;
+}
+
+static void write_batch(CacheWriter *writer, PendingWrite *batch,
+                        size_t count) {
+  CacheStoreItem *items = malloc(count * sizeof(CacheStoreItem));
+  if (!items) {
+    for (PendingWrite *p = batch; p; p = p->queue_next) {
+      cache_store_put(writer->store, &p->item);
+    }
+    return;
+  }
+
+  size_t i = 0;
+  for (PendingWrite *p = batch; p; p = p->queue_next) {
+    items[i++] = p->item;
+  }
+  cache_store_put_many(writer->store, items, count);
+  free(items);
+}
+
+/* Lets writes accumulate for up to CACHE_WRITER_FLUSH_INTERVAL_MS, unless a
+ * producer or a flush is waiting. Caller holds the mutex. */
+static void linger(CacheWriter *writer) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_nsec += (long)CACHE_WRITER_FLUSH_INTERVAL_MS * 1000000L;
+  deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+  deadline.tv_nsec %= 1000000000L;
+
+  while (!writer->urgent && !writer->stopping &&
+         pthread_cond_timedwait(&writer->work, &writer->mutex, &deadline) !=
+             ETIMEDOUT) {
+  }
+}
+
+static void *flusher_main(void *arg) {
+  CacheWriter *writer = arg;
+
+  pthread_mutex_lock(&writer->mutex);
+  for (;;) {
+    while (!writer->queue_head && !writer->stopping) {
+      pthread_cond_wait(&writer->work, &writer->mutex);
+    }
+    if (!writer->queue_head) {
+      break; /* stopping with nothing left */
+    }
+
+    linger(writer);
+    writer->urgent = 0;
+
+    /* Take the whole queue; its records stay indexed for readers */
+    PendingWrite *batch = writer->queue_head;
+    size_t count = 0;
+    for (PendingWrite *p = batch; p; p = p->queue_next) {
+      p->flushing = 1;
+      count++;
+    }
+    writer->queue_head = NULL;
+    writer->queue_tail = NULL;
+    writer->batches_started++;
+    pthread_mutex_unlock(&writer->mutex);
+
+    write_batch(writer, batch, count);
+
+    pthread_mutex_lock(&writer->mutex);
+    for (PendingWrite *p = batch; p; p = p->queue_next) {
+      index_remove(writer, p);
+      writer->pending_bytes -= p->size;
+    }
+    writer->batches_done++;
+    pthread_cond_broadcast(&writer->drained);
+    pthread_mutex_unlock(&writer->mutex);
+
+    free_pending_list(batch);
+    pthread_mutex_lock(&writer->mutex);
+  }
+  pthread_mutex_unlock(&writer->mutex);
+
+  return NULL;
+}
+
+CacheWriter *cache_writer_create(CacheStore *store, size_t max_pending_bytes) {
+  if (!store || max_pending_bytes == 0) {
+    return NULL;
+  }
+
+  CacheWriter *writer = calloc(1, sizeof(CacheWriter));
+  if (!writer) {
+    return NULL;
+  }
+  writer->store = store;
+  writer->max_pending_bytes = max_pending_bytes;
+
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&writer->work, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_cond_init(&writer->drained, NULL);
+  pthread_mutex_init(&writer->mutex, NULL);
+
+  if (pthread_create(&writer->thread, NULL, flusher_main, writer) != 0) {
+    pthread_mutex_destroy(&writer->mutex);
+    pthread_cond_destroy(&writer->drained);
+    pthread_cond_destroy(&writer->work);
+    free(writer);
+    return NULL;
+  }
+
+  return writer;
+}
+
+void cache_writer_destroy(CacheWriter *writer) {
+  if (!writer) {
+    return;
+  }
+
+  pthread_mutex_lock(&writer->mutex);
+  writer->stopping = 1;
+  pthread_cond_signal(&writer->work);
+  pthread_mutex_unlock(&writer->mutex);
+
+  /* The flusher only exits once the queue is empty */
+  pthread_join(writer->thread, NULL);
+
+  pthread_mutex_destroy(&writer->mutex);
+  pthread_cond_destroy(&writer->drained);
+  pthread_cond_destroy(&writer->work);
+  free(writer);
+}
+
+int cache_writer_put(CacheWriter *writer, const CacheStoreItem *item) {
+  if (!writer || !item || !item->key || (!item->data && item->len > 0) ||
+      (!item->meta && item->meta_len > 0)) {
+    return -1;
+  }
+
+  /* Copy outside the lock; a coalesced put hands its buffer over */
+  PendingWrite *pending = calloc(1, sizeof(PendingWrite));
+  if (!pending) {
+    return -1;
+  }
+  size_t key_len = strlen(item->key);
+  size_t buffer_len = key_len + 1 + item->meta_len + item->len;
+  pending->buffer = malloc(buffer_len);
+  if (!pending->buffer) {
+    free(pending);
+    return -1;
+  }
+
+  char *meta = pending->buffer + key_len + 1;
+  char *data = meta + item->meta_len;
+  memcpy(pending->buffer, item->key, key_len + 1);
+  if (item->meta_len > 0) {
+    memcpy(meta, item->meta, item->meta_len);
+  }
+  if (item->len > 0) {
+    memcpy(data, item->data, item->len);
+  }
+  pending->item = *item;
+  pending->item.key = pending->buffer;
+  pending->item.meta = meta;
+  pending->item.data = data;
+  pending->size = sizeof(PendingWrite) + buffer_len;
+
+  pthread_mutex_lock(&writer->mutex);
+
+  /* Backpressure: an oversized record still goes through an empty queue */
+  while (writer->pending_bytes > 0 &&
+         writer->pending_bytes + pending->size > writer->max_pending_bytes) {
+    writer->urgent = 1;
+    pthread_cond_signal(&writer->work);
+    pthread_cond_wait(&writer->drained, &writer->mutex);
+  }
+
+  PendingWrite *queued = index_find(writer, item->key, item->hash);
+  if (queued && !queued->flushing) {
+    /* Coalesce: the queued record takes the new bytes, keeping its place */
+    CacheStoreItem old_item = queued->item;
+    char *old_buffer = queued->buffer;
+    size_t old_size = queued->size;
+    queued->item = pending->item;
+    queued->buffer = pending->buffer;
+    queued->size = pending->size;
+    writer->pending_bytes += queued->size - old_size;
+    pending->item = old_item;
+    pending->buffer = old_buffer;
+  } else {
+    if (queued) {
+      /* Being written: readers must see the newer record from now on */
+      index_remove(writer, queued);
+    }
+    index_insert(writer, pending);
+    if (writer->queue_tail) {
+      writer->queue_tail->queue_next = pending;
+    } else {
+      writer->queue_head = pending;
+    }
+    writer->queue_tail = pending;
+    writer->pending_bytes += pending->size;
+    pending = NULL;
+
+    if (writer->pending_bytes * 2 >= writer->max_pending_bytes) {
+      writer->urgent = 1;
+    }
+    pthread_cond_signal(&writer->work);
+  }
+
+  pthread_mutex_unlock(&writer->mutex);
+
+  free_pending(pending);
+  return 0;
+}
+
+int cache_writer_get(CacheWriter *writer, const char *key, uint64_t hash,
+                     CacheStoreReader reader, void *userdata) {
+  if (!writer || !key || !reader) {
+    return -1;
+  }
+
+  int result = -1;
+  pthread_mutex_lock(&writer->mutex);
+
+  PendingWrite *queued = index_find(writer, key, hash);
+  if (queued && queued->item.expires_at >= time(NULL)) {
+    reader(&queued->item, userdata);
+    result = 0;
+  }
+
+  pthread_mutex_unlock(&writer->mutex);
+  return result;
+}
+
+int cache_writer_touch(CacheWriter *writer, const char *key, uint64_t hash,
+                       time_t fresh_until, time_t expires_at) {
+  if (!writer || !key) {
+    return -1;
+  }
+
+  int result = -1;
+  pthread_mutex_lock(&writer->mutex);
+
+  /* A record being written is read by the flusher without the lock */
+  PendingWrite *queued = index_find(writer, key, hash);
+  if (queued && !queued->flushing) {
+    queued->item.fresh_until = fresh_until;
+    queued->item.expires_at = expires_at;
+    result = 0;
+  }
+
+  pthread_mutex_unlock(&writer->mutex);
+  return result;
+}
+
+void cache_writer_flush(CacheWriter *writer) {
+  if (!writer) {
+    return;
+  }
+
+  pthread_mutex_lock(&writer->mutex);
+
+  /* Queued records go out with the next batch; otherwise only a batch
+   * already being written can hold earlier records */
+  uint64_t target = writer->batches_started;
+  if (writer->queue_head) {
+    target++;
+    writer->urgent = 1;
+    pthread_cond_signal(&writer->work);
+  }
+  while (writer->batches_done < target) {
+    pthread_cond_wait(&writer->drained, &writer->mutex);
+  }
+
+  pthread_mutex_unlock(&writer->mutex);
+}
+
+void cache_writer_discard(CacheWriter *writer) {
+  if (!writer) {
+    return;
+  }
+
+  pthread_mutex_lock(&writer->mutex);
+
+  PendingWrite *dropped = writer->queue_head;
+  for (PendingWrite *p = dropped; p; p = p->queue_next) {
+    index_remove(writer, p);
+    writer->pending_bytes -= p->size;
+  }
+  writer->queue_head = NULL;
+  writer->queue_tail = NULL;
+
+  while (writer->batches_done < writer->batches_started) {
+    pthread_cond_wait(&writer->drained, &writer->mutex);
+  }
+  pthread_cond_broadcast(&writer->drained);
+
+  pthread_mutex_unlock(&writer->mutex);
+
+  free_pending_list(dropped);
+}
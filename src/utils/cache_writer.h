@@ -0,0 +1,57 @@
+#ifndef CACHE_WRITER_H
+#define CACHE_WRITER_H
+
+#include "cache_store.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Buckets of the pending-write index; queues are bounded in bytes, so chains
+ * stay short */
+#define CACHE_WRITER_BUCKETS 1024
+/* How long the flusher lets writes accumulate before persisting them */
+#define CACHE_WRITER_FLUSH_INTERVAL_MS 50
+
+/*
+  Write-behind queue in front of a CacheStore. Puts copy the record into a
+  queue and return; a background thread persists the queue in batches with
+  cache_store_put_many(). A put for a key that is still queued replaces the
+  queued record, so a key written repeatedly between flushes reaches the
+  store once.
+    Queued records count against max_pending_bytes until they are written.
+  A put that would exceed the bound wakes the flusher and waits for room,
+  which keeps memory bounded when the disk cannot keep up.
+    Queued records are visible to cache_writer_get() in this process only;
+  other processes see them once flushed. All functions are thread-safe.
+*/
+typedef struct CacheWriter CacheWriter;
+
+/* Starts the flusher thread for store, which must outlive the writer */
+CacheWriter *cache_writer_create(CacheStore *store, size_t max_pending_bytes);
+
+/* Persists everything still queued, then stops the flusher */
+void cache_writer_destroy(CacheWriter *writer);
+
+/* Queues a copy of item, as cache_store_put() would store it */
+int cache_writer_put(CacheWriter *writer, const CacheStoreItem *item);
+
+/* Calls reader with the queued record for key and returns 0, or returns -1
+ * if none is queued (or it has expired). The reader runs with the queue
+ * locked and must not call back into the writer. */
+int cache_writer_get(CacheWriter *writer, const char *key, uint64_t hash,
+                     CacheStoreReader reader, void *userdata);
+
+/* Replaces the deadlines of key's queued record and returns 0, or returns
+ * -1 if no record for key is waiting (one being written does not count) */
+int cache_writer_touch(CacheWriter *writer, const char *key, uint64_t hash,
+                       time_t fresh_until, time_t expires_at);
+
+/* Returns once everything queued before the call is in the store */
+void cache_writer_flush(CacheWriter *writer);
+
+/* Drops every queued record and waits for a batch being written to finish,
+ * so nothing queued before the call reaches the store afterwards */
+void cache_writer_discard(CacheWriter *writer);
+
+#endif
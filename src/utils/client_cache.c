@@ -1,151 +1,389 @@
 #include "client_cache.h"
 
-#include "client_list.h"
-#include "hash_md5.h"
+#include "cache_store.h"
+#include "cache_writer.h"
 
-#include <dirent.h>
-#include <errno.h>
 #include <jansson.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #define CACHE_DIR "src/client/cache"
+/* Shared invalidation counter, see check_generation() */
+#define CACHE_GENERATION_FILE ".generation"
+/* Persistent tier, see cache_store.h */
+#define CACHE_STORE_FILE "cache.store"
 
-typedef struct {
+typedef struct CacheEntry CacheEntry;
+struct CacheEntry {
   char *key;
-  char *json_data;
-  time_t created_at;
-  time_t ttl;
-} CacheEntry;
+  uint64_t hash; /* computed once, compared before the key */
+  json_t *json; /* shared, never modified once cached */
+  time_t fresh_until; /* served stale after this... */
+  time_t expires_at;  /* ...and dropped after this, unless revalidatable */
+
+  /* Encoded validators, as kept in the store (NULL when there are none) */
+  char *meta;
+  size_t meta_len;
+
+  /* Intrusive recency list, most recently used at the head */
+  CacheEntry *lru_prev;
+  CacheEntry *lru_next;
+};
+
+/*
+  One lock stripe: keys hash to a fixed shard, so threads working on
+  different keys rarely contend for the same mutex. Each shard indexes its
+  entries in an open-addressing table (linear probing, backward-shift
+  deletion, so no tombstones) and orders them in an LRU list, making lookup,
+  insert and eviction O(1).
+*/
+typedef struct {
+  pthread_mutex_t mutex;
+  CacheEntry **slots;
+  size_t slot_count; /* power of two */
+  size_t count;
+  CacheEntry lru; /* list head */
+} CacheShard;
 
 struct ClientCache {
-  LinkedList *entries;
+  CacheShard shards[CACHE_SHARDS];
+  atomic_size_t size; /* entries across all shards */
   size_t max_entries;
   time_t default_ttl;
+  time_t hard_ttl; /* at least default_ttl */
+
+  /* Bumped by every client_cache_clear(), in any process sharing CACHE_DIR.
+   * Points into a shared mapping of the generation file, or at
+   * local_generation when the file cannot be mapped. */
+  uint64_t *generation;
+  uint64_t local_generation;
+  atomic_uint_least64_t seen_generation;
+
+  CacheStore *store; /* NULL when CACHE_DIR is unusable: memory only */
+  CacheWriter *writer; /* NULL when sets write the store synchronously */
 };
 
 static void free_cache_entry(CacheEntry *entry) {
   if (entry) {
     free(entry->key);
-    free(entry->json_data);
+    json_decref(entry->json);
+    free(entry->meta);
     free(entry);
   }
 }
 
-static void ensure_cache_dir() {
-  struct stat st;
-  if (stat(CACHE_DIR, &st) == -1) {
-    mkdir(CACHE_DIR, 0755);
+/* FNV-1a, finished with the murmur3 finalizer: plain FNV-1a leaves the high
+ * bits, which pick the shard, poorly mixed for short keys that differ only
+ * in their last characters */
+static uint64_t hash_key(const char *key) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+    hash ^= *p;
+    hash *= 1099511628211ULL;
   }
+
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
 }
 
-static char *get_cache_filepath(const char *key) {
-  char hash[HASH_MD5_STRING_LENGTH];
-  if (hash_md5_string(key, strlen(key), hash, sizeof(hash)) != 0) {
-    return NULL;
-  }
+static void lru_unlink(CacheEntry *entry) {
+  entry->lru_prev->lru_next = entry->lru_next;
+  entry->lru_next->lru_prev = entry->lru_prev;
+}
 
-  char *filepath = malloc(512);
-  if (!filepath) {
-    return NULL;
+static void lru_push_front(CacheShard *shard, CacheEntry *entry) {
+  entry->lru_prev = &shard->lru;
+  entry->lru_next = shard->lru.lru_next;
+  shard->lru.lru_next->lru_prev = entry;
+  shard->lru.lru_next = entry;
+}
+
+/* Slot holding key, or the empty slot where it would go */
+static size_t shard_probe(const CacheShard *shard, const char *key,
+                          uint64_t hash) {
+  size_t mask = shard->slot_count - 1;
+  size_t i = (size_t)hash & mask;
+  while (shard->slots[i]) {
+    CacheEntry *entry = shard->slots[i];
+    if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+      break;
+    }
+    i = (i + 1) & mask;
   }
+  return i;
+}
 
-  snprintf(filepath, 512, "%s/%s.json", CACHE_DIR, hash);
-  return filepath;
+static CacheEntry *shard_find(const CacheShard *shard, const char *key,
+                              uint64_t hash) {
+  return shard->slots[shard_probe(shard, key, hash)];
 }
 
-static int is_cache_file_valid(const char *filepath, time_t ttl) {
-  struct stat file_stat;
+static int shard_grow(CacheShard *shard) {
+  size_t slot_count = shard->slot_count * 2;
+  CacheEntry **slots = calloc(slot_count, sizeof(CacheEntry *));
+  if (!slots) {
+    return -1;
+  }
 
-  if (stat(filepath, &file_stat) != 0) {
-    return 0;
+  for (size_t i = 0; i < shard->slot_count; i++) {
+    CacheEntry *entry = shard->slots[i];
+    if (entry) {
+      size_t j = (size_t)entry->hash & (slot_count - 1);
+      while (slots[j]) {
+        j = (j + 1) & (slot_count - 1);
+      }
+      slots[j] = entry;
+    }
   }
 
-  time_t now = time(NULL);
-  double age = difftime(now, file_stat.st_mtime);
+  free(shard->slots);
+  shard->slots = slots;
+  shard->slot_count = slot_count;
+  return 0;
+}
 
-  if (age > (double)ttl) {
-    return 0;
+/* Index and list updates that keep the cache-wide entry count in step; the
+ * caller holds the shard lock and has checked the key is absent */
+static int shard_insert(ClientCache *cache, CacheShard *shard,
+                        CacheEntry *entry) {
+  /* Keep the load factor at or below 1/2 so probe runs stay short */
+  if ((shard->count + 1) * 2 > shard->slot_count && shard_grow(shard) != 0) {
+    return -1;
   }
 
-  return 1;
+  shard->slots[shard_probe(shard, entry->key, entry->hash)] = entry;
+  lru_push_front(shard, entry);
+  shard->count++;
+  atomic_fetch_add(&cache->size, 1);
+  return 0;
 }
 
-static int save_to_file(const char *key, const char *json_data) {
-  ensure_cache_dir();
+static void shard_remove(ClientCache *cache, CacheShard *shard,
+                         CacheEntry *entry) {
+  size_t mask = shard->slot_count - 1;
+  size_t hole = shard_probe(shard, entry->key, entry->hash);
+  shard->slots[hole] = NULL;
+
+  /* Backward-shift: pull later members of the probe run into the hole so
+   * every remaining entry stays reachable from its home slot */
+  for (size_t i = (hole + 1) & mask; shard->slots[i]; i = (i + 1) & mask) {
+    size_t home = (size_t)shard->slots[i]->hash & mask;
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      shard->slots[hole] = shard->slots[i];
+      shard->slots[i] = NULL;
+      hole = i;
+    }
+  }
 
-  char *filepath = get_cache_filepath(key);
-  if (!filepath) {
-    return -1;
+  lru_unlink(entry);
+  shard->count--;
+  atomic_fetch_sub(&cache->size, 1);
+  free_cache_entry(entry);
+}
+
+static CacheShard *shard_for(ClientCache *cache, uint64_t hash) {
+  /* High bits pick the shard, low bits the slot within it */
+  return &cache->shards[(hash >> 32) & (CACHE_SHARDS - 1)];
+}
+
+static void ensure_cache_dir() {
+  struct stat st;
+  if (stat(CACHE_DIR, &st) == -1) {
+    mkdir(CACHE_DIR, 0755);
   }
+}
 
-  json_error_t error;
-  json_t *json = json_loads(json_data, 0, &error);
-  if (!json) {
-    free(filepath);
-    return -1;
+/* Validators travel as the store's meta bytes: the ETag, a NUL, then the
+ * Last-Modified value. Returns the encoded length, 0 if both are empty. */
+static size_t encode_validators(const CacheValidators *validators,
+                                char *meta) {
+  if (!validators || (!validators->etag[0] && !validators->last_modified[0])) {
+    return 0;
   }
 
-  int result =
-      json_dump_file(json, filepath, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+  size_t etag_len = strnlen(validators->etag, CACHE_VALIDATOR_MAX - 1);
+  size_t modified_len =
+      strnlen(validators->last_modified, CACHE_VALIDATOR_MAX - 1);
+  memcpy(meta, validators->etag, etag_len);
+  meta[etag_len] = '\0';
+  memcpy(meta + etag_len + 1, validators->last_modified, modified_len);
+  return etag_len + 1 + modified_len;
+}
 
-  json_decref(json);
-  free(filepath);
+static void decode_validators(const char *meta, size_t meta_len,
+                              CacheValidators *validators) {
+  memset(validators, 0, sizeof(CacheValidators));
 
-  return result;
+  const char *separator = meta ? memchr(meta, '\0', meta_len) : NULL;
+  if (!separator) {
+    return;
+  }
+
+  size_t etag_len = (size_t)(separator - meta);
+  size_t modified_len = meta_len - etag_len - 1;
+  if (etag_len < CACHE_VALIDATOR_MAX && modified_len < CACHE_VALIDATOR_MAX) {
+    memcpy(validators->etag, meta, etag_len);
+    memcpy(validators->last_modified, separator + 1, modified_len);
+  }
 }
 
-static char *load_from_file(const char *key, time_t ttl) {
-  char *filepath = get_cache_filepath(key);
-  if (!filepath) {
-    return NULL;
+typedef struct {
+  json_t *json;
+  char *meta;
+  size_t meta_len;
+  time_t fresh_until;
+  time_t expires_at;
+} LoadedRecord;
+
+/* Hands a stored record straight from the mapping to the parser */
+static void parse_record(const CacheStoreItem *item, void *userdata) {
+  LoadedRecord *loaded = userdata;
+  json_error_t error;
+  loaded->json = json_loadb(item->data, item->len, 0, &error);
+  loaded->meta = NULL;
+  loaded->meta_len = 0;
+  if (loaded->json && item->meta_len > 0) {
+    loaded->meta = malloc(item->meta_len);
+    if (loaded->meta) {
+      memcpy(loaded->meta, item->meta, item->meta_len);
+      loaded->meta_len = item->meta_len;
+    }
   }
+  loaded->fresh_until = item->fresh_until;
+  loaded->expires_at = item->expires_at;
+}
 
-  if (!is_cache_file_valid(filepath, ttl)) {
-    unlink(filepath);
-    free(filepath);
-    return NULL;
+/* A record still queued for write-behind is newer than the stored one */
+static int load_from_store(ClientCache *cache, const char *key, uint64_t hash,
+                           LoadedRecord *loaded) {
+  loaded->json = NULL;
+  if (cache_writer_get(cache->writer, key, hash, parse_record, loaded) != 0 &&
+      cache_store_get(cache->store, key, hash, parse_record, loaded) != 0) {
+    return -1;
   }
+  return loaded->json ? 0 : -1;
+}
 
-  json_error_t error;
-  json_t *json = json_load_file(filepath, 0, &error);
-  free(filepath);
+static void map_generation(ClientCache *cache) {
+  cache->generation = &cache->local_generation;
 
-  if (!json) {
-    return NULL;
+  ensure_cache_dir();
+  int fd = open(CACHE_DIR "/" CACHE_GENERATION_FILE, O_RDWR | O_CREAT | O_CLOEXEC,
+                0644);
+  if (fd < 0) {
+    return;
   }
 
-  char *json_str = json_dumps(json, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
-  json_decref(json);
+  struct stat st;
+  if (fstat(fd, &st) == 0 &&
+      (st.st_size >= (off_t)sizeof(uint64_t) ||
+       ftruncate(fd, sizeof(uint64_t)) == 0)) {
+    void *map = mmap(NULL, sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    if (map != MAP_FAILED) {
+      cache->generation = map;
+    }
+  }
+  close(fd);
+}
 
-  return json_str;
+static void unmap_generation(ClientCache *cache) {
+  if (cache->generation && cache->generation != &cache->local_generation) {
+    munmap(cache->generation, sizeof(uint64_t));
+  }
 }
 
-static void delete_file(const char *key) {
-  char *filepath = get_cache_filepath(key);
-  if (filepath) {
-    unlink(filepath);
-    free(filepath);
+/* Drops every memory entry; takes each shard lock in turn */
+static void drop_memory(ClientCache *cache) {
+  for (size_t i = 0; i < CACHE_SHARDS; i++) {
+    CacheShard *shard = &cache->shards[i];
+    pthread_mutex_lock(&shard->mutex);
+
+    CacheEntry *entry = shard->lru.lru_next;
+    while (entry != &shard->lru) {
+      CacheEntry *next = entry->lru_next;
+      free_cache_entry(entry);
+      entry = next;
+    }
+
+    memset(shard->slots, 0, shard->slot_count * sizeof(CacheEntry *));
+    shard->lru.lru_prev = &shard->lru;
+    shard->lru.lru_next = &shard->lru;
+    atomic_fetch_sub(&cache->size, shard->count);
+    shard->count = 0;
+    pthread_mutex_unlock(&shard->mutex);
   }
 }
 
-ClientCache *client_cache_create(size_t max_entries, time_t default_ttl) {
-  ClientCache *cache = malloc(sizeof(ClientCache));
-  if (!cache) {
-    return NULL;
+/*
+  Memory entries are authoritative, so a hit never touches the disk. The one
+  thing that can invalidate them from outside is a clear, possibly by another
+  process: it bumps the shared generation, and the next lookup here sees a
+  number it has not seen and drops the memory tier. That check is a single
+  load from the mapping, with no syscall.
+*/
+static void check_generation(ClientCache *cache) {
+  uint64_t current = __atomic_load_n(cache->generation, __ATOMIC_ACQUIRE);
+  uint_least64_t seen = atomic_load(&cache->seen_generation);
+  if (current == seen) {
+    return;
   }
 
-  cache->entries = linked_list_create();
-  if (!cache->entries) {
-    free(cache);
+  /* Only the thread that advances seen_generation drops the entries */
+  if (atomic_compare_exchange_strong(&cache->seen_generation, &seen,
+                                     current)) {
+    drop_memory(cache);
+  }
+}
+
+ClientCache *client_cache_create(size_t max_entries, time_t default_ttl,
+                                 time_t hard_ttl, size_t write_behind_bytes) {
+  ClientCache *cache = calloc(1, sizeof(ClientCache));
+  if (!cache) {
     return NULL;
   }
 
   cache->max_entries = max_entries > 0 ? max_entries : CACHE_MAX_ENTRIES;
   cache->default_ttl = default_ttl > 0 ? default_ttl : CACHE_DEFAULT_TTL;
+  cache->hard_ttl = hard_ttl > 0 ? hard_ttl : CACHE_DEFAULT_HARD_TTL;
+  if (cache->hard_ttl < cache->default_ttl) {
+    cache->hard_ttl = cache->default_ttl;
+  }
+
+  for (size_t i = 0; i < CACHE_SHARDS; i++) {
+    CacheShard *shard = &cache->shards[i];
+    shard->slot_count = CACHE_SHARD_INITIAL_SLOTS;
+    shard->slots = calloc(shard->slot_count, sizeof(CacheEntry *));
+    if (!shard->slots) {
+      client_cache_destroy(cache);
+      return NULL;
+    }
+    shard->lru.lru_prev = &shard->lru;
+    shard->lru.lru_next = &shard->lru;
+    pthread_mutex_init(&shard->mutex, NULL);
+  }
+
+  map_generation(cache);
+  atomic_init(&cache->seen_generation,
+              __atomic_load_n(cache->generation, __ATOMIC_ACQUIRE));
+
+  cache->store = cache_store_open(CACHE_DIR "/" CACHE_STORE_FILE);
+  if (cache->store && write_behind_bytes > 0) {
+    /* Without a flusher thread, sets simply write through */
+    cache->writer = cache_writer_create(cache->store, write_behind_bytes);
+  }
 
   return cache;
 }
@@ -155,160 +393,308 @@ void client_cache_destroy(ClientCache *cache) {
     return;
   }
 
-  linked_list_clear(cache->entries, (void (*)(void *))free_cache_entry);
-  linked_list_dispose(&cache->entries, NULL);
+  for (size_t i = 0; i < CACHE_SHARDS; i++) {
+    CacheShard *shard = &cache->shards[i];
+    if (!shard->slots) {
+      break;
+    }
+    CacheEntry *entry = shard->lru.lru_next;
+    while (entry != &shard->lru) {
+      CacheEntry *next = entry->lru_next;
+      free_cache_entry(entry);
+      entry = next;
+    }
+    free(shard->slots);
+    pthread_mutex_destroy(&shard->mutex);
+  }
+  cache_writer_destroy(cache->writer);
+  cache_store_close(cache->store);
+  unmap_generation(cache);
   free(cache);
 }
 
-int client_cache_set(ClientCache *cache, const char *key,
-                     const char *json_data) {
-  if (!cache || !key || !json_data) {
-    return -1;
+/* Takes ownership of meta, even on failure */
+static CacheEntry *create_entry(const char *key, uint64_t hash, json_t *json,
+                                char *meta, size_t meta_len,
+                                time_t fresh_until, time_t expires_at) {
+  CacheEntry *entry = calloc(1, sizeof(CacheEntry));
+  if (!entry) {
+    free(meta);
+    return NULL;
   }
 
-  LinkedList_foreach(cache->entries, node) {
-    CacheEntry *entry = (CacheEntry *)node->item;
-    if (strcmp(entry->key, key) == 0) {
-      linked_list_remove(cache->entries, node,
-                         (void (*)(void *))free_cache_entry);
-      break;
-    }
+  entry->key = strdup(key);
+  if (!entry->key) {
+    free(meta);
+    free(entry);
+    return NULL;
   }
 
-  if (cache->entries->size >= cache->max_entries) {
-    if (cache->entries->head) {
-      CacheEntry *oldest = (CacheEntry *)cache->entries->head->item;
-      LinkedList_foreach(cache->entries, node) {
-        CacheEntry *entry = (CacheEntry *)node->item;
-        if (entry->created_at < oldest->created_at) {
-          oldest = entry;
-        }
-      }
+  entry->json = json_incref(json);
+  entry->meta = meta;
+  entry->meta_len = meta ? meta_len : 0;
 
-      LinkedList_foreach(cache->entries, node) {
-        if (node->item == oldest) {
-          delete_file(oldest->key);
-          linked_list_remove(cache->entries, node,
-                             (void (*)(void *))free_cache_entry);
-          break;
-        }
-      }
+  entry->hash = hash;
+  entry->fresh_until = fresh_until;
+  entry->expires_at = expires_at;
+  return entry;
+}
+
+/* Memory-tier insert of a record loaded from the store; caller holds the
+ * shard lock */
+static CacheEntry *insert_loaded(ClientCache *cache, CacheShard *shard,
+                                 const char *key, uint64_t hash,
+                                 LoadedRecord *loaded) {
+  CacheEntry *entry =
+      create_entry(key, hash, loaded->json, loaded->meta, loaded->meta_len,
+                   loaded->fresh_until, loaded->expires_at);
+  if (entry && shard_insert(cache, shard, entry) != 0) {
+    free_cache_entry(entry);
+    entry = NULL;
+  }
+  json_decref(loaded->json);
+  return entry;
+}
+
+/*
+  Store read for a key missing from memory. Called with the shard lock held,
+  it drops the lock while reading and parsing the record, so hits on the
+  shard never wait for the disk or the JSON parser, and holds it again on
+  return. A set of the key in the meantime is newer than the record, and a
+  clear makes it stale, so either way the record is discarded; the entry
+  returned may thus be one another thread inserted, or NULL.
+*/
+static CacheEntry *load_unlocked(ClientCache *cache, CacheShard *shard,
+                                 const char *key, uint64_t hash) {
+  uint64_t generation = __atomic_load_n(cache->generation, __ATOMIC_ACQUIRE);
+  pthread_mutex_unlock(&shard->mutex);
+
+  LoadedRecord loaded;
+  int found = load_from_store(cache, key, hash, &loaded) == 0;
+
+  pthread_mutex_lock(&shard->mutex);
+  CacheEntry *entry = shard_find(shard, key, hash);
+  if (!found) {
+    return entry;
+  }
+
+  if (entry ||
+      __atomic_load_n(cache->generation, __ATOMIC_ACQUIRE) != generation) {
+    json_decref(loaded.json);
+    free(loaded.meta);
+    return entry;
+  }
+  return insert_loaded(cache, shard, key, hash, &loaded);
+}
+
+static void put_to_store(ClientCache *cache, const CacheStoreItem *item) {
+  if (cache->writer) {
+    cache_writer_put(cache->writer, item);
+  } else if (cache->store) {
+    cache_store_put(cache->store, item);
+  }
+}
+
+/* An entry is fresh for ttl seconds (default_ttl when negative), then
+ * served stale for as long as the configured TTLs allow */
+static void entry_deadlines(const ClientCache *cache, time_t ttl,
+                            time_t *fresh_until, time_t *expires_at) {
+  if (ttl < 0) {
+    ttl = cache->default_ttl;
+  }
+  *fresh_until = time(NULL) + ttl;
+  *expires_at = *fresh_until + (cache->hard_ttl - cache->default_ttl);
+}
+
+int client_cache_set(ClientCache *cache, const char *key, json_t *json,
+                     const char *raw, size_t raw_len,
+                     const CacheValidators *validators, time_t ttl) {
+  if (!cache || !key || !json) {
+    return -1;
+  }
+
+  /* Callers without the original bytes get a compact serialization */
+  char *dumped = NULL;
+  if (!raw) {
+    dumped = json_dumps(json, JSON_COMPACT | JSON_PRESERVE_ORDER);
+    if (!dumped) {
+      return -1;
     }
+    raw = dumped;
+    raw_len = strlen(dumped);
   }
 
-  CacheEntry *entry = malloc(sizeof(CacheEntry));
+  char encoded[2 * CACHE_VALIDATOR_MAX];
+  size_t meta_len = encode_validators(validators, encoded);
+  char *meta = NULL;
+  if (meta_len > 0 && (meta = malloc(meta_len)) != NULL) {
+    memcpy(meta, encoded, meta_len);
+  }
+
+  time_t fresh_until, expires_at;
+  entry_deadlines(cache, ttl, &fresh_until, &expires_at);
+
+  uint64_t hash = hash_key(key);
+  CacheEntry *entry =
+      create_entry(key, hash, json, meta, meta_len, fresh_until, expires_at);
   if (!entry) {
+    free(dumped);
     return -1;
   }
 
-  entry->key = strdup(key);
-  entry->json_data = strdup(json_data);
+  CacheShard *shard = shard_for(cache, hash);
+  pthread_mutex_lock(&shard->mutex);
 
-  if (!entry->key || !entry->json_data) {
-    free_cache_entry(entry);
-    return -1;
+  CacheEntry *existing = shard_find(shard, key, hash);
+  if (existing) {
+    shard_remove(cache, shard, existing);
+  }
+
+  /* Evict from this shard so only one lock is ever held; the bound is
+   * cache-wide, the victim is the shard's least recently used entry */
+  if (atomic_load(&cache->size) >= cache->max_entries &&
+      shard->lru.lru_prev != &shard->lru) {
+    shard_remove(cache, shard, shard->lru.lru_prev);
   }
 
-  entry->created_at = time(NULL);
-  entry->ttl = cache->default_ttl;
+  int result = shard_insert(cache, shard, entry);
+  pthread_mutex_unlock(&shard->mutex);
 
-  if (linked_list_append(cache->entries, entry) != 0) {
+  /* Outside the shard lock, so hits on the shard never wait for the
+   * store; the store outlives memory eviction until the entry expires */
+  if (result != 0) {
     free_cache_entry(entry);
-    return -1;
+  } else {
+    CacheStoreItem item = {key, hash, encoded, meta_len, raw, raw_len,
+                           fresh_until, expires_at};
+    put_to_store(cache, &item);
   }
 
-  save_to_file(key, json_data);
-
-  return 0;
+  free(dumped);
+  return result;
 }
 
-char *client_cache_get(ClientCache *cache, const char *key) {
+json_t *client_cache_lookup(ClientCache *cache, const char *key,
+                            CacheState *state, CacheValidators *validators) {
+  CacheState found = CACHE_MISS;
+  if (state) {
+    *state = CACHE_MISS;
+  }
+  if (validators) {
+    memset(validators, 0, sizeof(CacheValidators));
+  }
   if (!cache || !key) {
     return NULL;
   }
 
-  LinkedList_foreach(cache->entries, node) {
-    CacheEntry *entry = (CacheEntry *)node->item;
-    if (strcmp(entry->key, key) == 0) {
-      time_t now = time(NULL);
-      double age = difftime(now, entry->created_at);
+  check_generation(cache);
 
-      if (age > (double)entry->ttl) {
-        linked_list_remove(cache->entries, node,
-                           (void (*)(void *))free_cache_entry);
-        delete_file(key);
-        return NULL;
-      }
-
-      char *filepath = get_cache_filepath(key);
-      if (filepath) {
-        struct stat file_stat;
-        if (stat(filepath, &file_stat) != 0) {
-          free(filepath);
-          linked_list_remove(cache->entries, node,
-                             (void (*)(void *))free_cache_entry);
-          return NULL;
-        }
-        free(filepath);
-      }
+  uint64_t hash = hash_key(key);
+  CacheShard *shard = shard_for(cache, hash);
+  time_t now = time(NULL);
+  pthread_mutex_lock(&shard->mutex);
+
+  CacheEntry *entry = shard_find(shard, key, hash);
+  if (entry && now > entry->expires_at && !entry->meta) {
+    /* Nothing to revalidate it with */
+    shard_remove(cache, shard, entry);
+    entry = NULL;
+  } else if (entry) {
+    lru_unlink(entry);
+    lru_push_front(shard, entry);
+  } else if (cache->store) {
+    entry = load_unlocked(cache, shard, key, hash);
+  }
 
-      return strdup(entry->json_data);
+  json_t *json = NULL;
+  if (entry) {
+    found = now <= entry->fresh_until  ? CACHE_FRESH
+            : now <= entry->expires_at ? CACHE_STALE
+                                       : CACHE_EXPIRED;
+    json = json_incref(entry->json);
+    if (validators) {
+      decode_validators(entry->meta, entry->meta_len, validators);
     }
   }
 
-  char *json_data = load_from_file(key, cache->default_ttl);
-  if (json_data) {
-    CacheEntry *entry = malloc(sizeof(CacheEntry));
-    if (entry) {
-      entry->key = strdup(key);
-      entry->json_data = strdup(json_data);
-      entry->created_at = time(NULL);
-      entry->ttl = cache->default_ttl;
-
-      if (entry->key && entry->json_data) {
-        linked_list_append(cache->entries, entry);
-      } else {
-        free_cache_entry(entry);
-      }
-    }
-    return json_data;
+  pthread_mutex_unlock(&shard->mutex);
+
+  if (state) {
+    *state = found;
   }
+  return json;
+}
 
-  return NULL;
+json_t *client_cache_get(ClientCache *cache, const char *key) {
+  CacheState state;
+  json_t *json = client_cache_lookup(cache, key, &state, NULL);
+  if (state != CACHE_FRESH) {
+    json_decref(json);
+    return NULL;
+  }
+  return json;
 }
 
-void client_cache_clear(ClientCache *cache) {
-  if (!cache) {
-    return;
+int client_cache_revalidate(ClientCache *cache, const char *key,
+                            json_t *json, time_t ttl) {
+  if (!cache || !key) {
+    return -1;
   }
 
-  LinkedList_foreach(cache->entries, node) {
-    CacheEntry *entry = (CacheEntry *)node->item;
-    delete_file(entry->key);
+  time_t fresh_until, expires_at;
+  entry_deadlines(cache, ttl, &fresh_until, &expires_at);
+  uint64_t hash = hash_key(key);
+
+  /* A record being written by the flusher is touched in the store, where
+   * that write may still land over it: the worst case is an early
+   * revalidation */
+  int stored =
+      cache_writer_touch(cache->writer, key, hash, fresh_until, expires_at) ==
+          0 ||
+      cache_store_touch(cache->store, key, hash, fresh_until, expires_at) == 0;
+
+  CacheShard *shard = shard_for(cache, hash);
+  pthread_mutex_lock(&shard->mutex);
+
+  CacheEntry *entry = shard_find(shard, key, hash);
+  if (!entry && stored) {
+    entry = load_unlocked(cache, shard, key, hash);
   }
 
-  linked_list_clear(cache->entries, (void (*)(void *))free_cache_entry);
+  if (entry) {
+    entry->fresh_until = fresh_until;
+    entry->expires_at = expires_at;
+    lru_unlink(entry);
+    lru_push_front(shard, entry);
+  }
 
-  DIR *dir = opendir(CACHE_DIR);
-  if (dir) {
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-      if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-        continue;
-      }
+  pthread_mutex_unlock(&shard->mutex);
 
-      if (strcmp(entry->d_name, "README.md") == 0) {
-        continue;
-      }
+  /* Evicted everywhere: keep the caller's copy, without validators */
+  if (!entry && json) {
+    return client_cache_set(cache, key, json, NULL, 0, NULL, ttl);
+  }
+  return entry ? 0 : -1;
+}
+
+void client_cache_clear(ClientCache *cache) {
+  if (!cache) {
+    return;
+  }
 
-      char filepath[512];
-      snprintf(filepath, sizeof(filepath), "%s/%s", CACHE_DIR, entry->d_name);
+  drop_memory(cache);
+  cache_writer_discard(cache->writer);
+  cache_store_clear(cache->store);
 
-      struct stat file_stat;
-      if (stat(filepath, &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
-        unlink(filepath);
-      }
-    }
-    closedir(dir);
+  /* The store is empty before other processes learn they must drop their
+   * memory tiers */
+  uint64_t generation =
+      __atomic_add_fetch(cache->generation, 1, __ATOMIC_ACQ_REL);
+  atomic_store(&cache->seen_generation, generation);
+}
+
+void client_cache_flush(ClientCache *cache) {
+  if (cache) {
+    cache_writer_flush(cache->writer);
   }
 }
@@ -1,19 +1,95 @@
 #ifndef CLIENT_CACHE_H
 #define CLIENT_CACHE_H
 
+#include <jansson.h>
 #include <stddef.h>
 #include <time.h>
 
 #define CACHE_MAX_ENTRIES 50
 #define CACHE_DEFAULT_TTL 300
+/* How long an entry is kept, and may be served stale, in all */
+#define CACHE_DEFAULT_HARD_TTL 3600
+/* Number of independently locked shards, a power of two */
+#define CACHE_SHARDS 16
+/* Index slots each shard starts with; doubled as it fills */
+#define CACHE_SHARD_INITIAL_SLOTS 16
+/* Default bound on store writes queued behind client_cache_set() */
+#define CACHE_WRITE_BEHIND_BYTES (1024 * 1024)
+/* Room for an ETag or Last-Modified value, NUL included */
+#define CACHE_VALIDATOR_MAX 128
 
+/*
+  Two-tier response cache: parsed documents in memory, raw responses in a
+  memory-mapped store file (cache_store.h) under the cache directory, shared
+  by every process using it.
+    All functions are thread-safe. Memory entries are spread over
+  CACHE_SHARDS lock stripes by key hash, each with a hash index and an LRU
+  list, so get and set cost O(1) whatever max_entries is. max_entries bounds
+  the memory tier as a whole, each insert evicting the least recently used
+  entry of its own shard, so it may be exceeded by at most CACHE_SHARDS.
+  Entries evicted from memory stay in the store until they expire.
+    Memory hits make no syscalls: the memory tier is authoritative for its
+  own entries, and client_cache_clear() in any process invalidates it through
+  a generation counter mapped from the directory's .generation file.
+    With write-behind, a set returns once the memory tier is updated and the
+  store write is queued for a background flusher (cache_writer.h); queued
+  writes reach other processes when flushed, at the latest on destroy.
+*/
 typedef struct ClientCache ClientCache;
 
-ClientCache *client_cache_create(size_t max_entries, time_t default_ttl);
+/* How client_cache_lookup() found a key */
+typedef enum {
+  CACHE_MISS,
+  CACHE_FRESH,
+  CACHE_STALE,  /* past the soft TTL: usable, due for a refresh */
+  CACHE_EXPIRED /* past the hard TTL: usable only once revalidated */
+} CacheState;
+
+/* HTTP validators of a cached response, empty strings when absent */
+typedef struct {
+  char etag[CACHE_VALIDATOR_MAX];
+  char last_modified[CACHE_VALIDATOR_MAX];
+} CacheValidators;
+
+/* Entries are fresh for default_ttl seconds and expire after hard_ttl
+ * (raised to default_ttl if lower); in between they are stale.
+ * write_behind_bytes bounds the store writes queued for the background
+ * flusher; 0 makes every set write the store before returning. */
+ClientCache *client_cache_create(size_t max_entries, time_t default_ttl,
+                                 time_t hard_ttl, size_t write_behind_bytes);
+/* Flushes queued store writes before releasing the cache */
 void client_cache_destroy(ClientCache *cache);
-int client_cache_set(ClientCache *cache, const char *key,
-                     const char *json_data);
-char *client_cache_get(ClientCache *cache, const char *key);
+/*
+  Entries are parsed documents shared by reference count: set takes its own
+  reference to json, and lookups return a new reference (or NULL on a miss)
+  that the caller must json_decref(). A cached document is shared with every
+  reader, so it must not be modified after it is set.
+    raw/raw_len are the response bytes json was parsed from; the store keeps
+  them verbatim. Pass raw as NULL to have json serialized instead.
+  validators (NULL for none) are kept with the entry, in the store too. They
+  keep it in memory past its hard TTL, as CACHE_EXPIRED, so that it can be
+  revalidated instead of refetched; the store still drops it at hard_ttl.
+    ttl is how long this entry stays fresh, typically from the response's
+  Cache-Control or Expires; negative uses default_ttl. Either way it may
+  then be served stale for hard_ttl - default_ttl seconds.
+*/
+int client_cache_set(ClientCache *cache, const char *key, json_t *json,
+                     const char *raw, size_t raw_len,
+                     const CacheValidators *validators, time_t ttl);
+/* Returns key's entry only while it is fresh */
+json_t *client_cache_get(ClientCache *cache, const char *key);
+/* Returns key's entry in whatever state it is, setting *state, and copies
+ * its validators into *validators; either pointer may be NULL */
+json_t *client_cache_lookup(ClientCache *cache, const char *key,
+                            CacheState *state, CacheValidators *validators);
+/* Restarts key's TTLs, ttl as for client_cache_set(), after the origin
+ * confirmed it unchanged (HTTP 304), in memory and in the store, without
+ * rewriting the document. json, the caller's copy, is cached again if the
+ * entry was evicted meanwhile. */
+int client_cache_revalidate(ClientCache *cache, const char *key,
+                            json_t *json, time_t ttl);
 void client_cache_clear(ClientCache *cache);
+/* Returns once every set made before the call has reached the store */
+void client_cache_flush(ClientCache *cache);
 
 #endif
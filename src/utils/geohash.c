@@ -0,0 +1,109 @@
+#include "geohash.h"
+
+#include <math.h>
+#include <string.h>
+
+static const char BASE32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+int geohash_encode(double lat, double lon, int precision, char *out) {
+  if (!out || precision < 1 || precision > GEOHASH_MAX_PRECISION ||
+      !(lat >= -90.0 && lat <= 90.0) || !(lon >= -180.0 && lon <= 180.0)) {
+    return -1;
+  }
+
+  double lat_range[2] = {-90.0, 90.0};
+  double lon_range[2] = {-180.0, 180.0};
+  int lon_bit = 1; /* bits alternate, longitude first */
+
+  for (int i = 0; i < precision; i++) {
+    int index = 0;
+    for (int bit = 0; bit < 5; bit++) {
+      double *range = lon_bit ? lon_range : lat_range;
+      double value = lon_bit ? lon : lat;
+      double mid = (range[0] + range[1]) / 2.0;
+      index <<= 1;
+      if (value >= mid) {
+        index |= 1;
+        range[0] = mid;
+      } else {
+        range[1] = mid;
+      }
+      lon_bit = !lon_bit;
+    }
+    out[i] = BASE32[index];
+  }
+  out[precision] = '\0';
+
+  return 0;
+}
+
+int geohash_decode(const char *hash, double *lat, double *lon, double *lat_err,
+                   double *lon_err) {
+  size_t len = hash ? strlen(hash) : 0;
+  if (len < 1 || len > GEOHASH_MAX_PRECISION) {
+    return -1;
+  }
+
+  double lat_range[2] = {-90.0, 90.0};
+  double lon_range[2] = {-180.0, 180.0};
+  int lon_bit = 1;
+
+  for (size_t i = 0; i < len; i++) {
+    const char *found = hash[i] ? strchr(BASE32, hash[i]) : NULL;
+    if (!found) {
+      return -1;
+    }
+    int index = (int)(found - BASE32);
+    for (int bit = 4; bit >= 0; bit--) {
+      double *range = lon_bit ? lon_range : lat_range;
+      double mid = (range[0] + range[1]) / 2.0;
+      if (index & (1 << bit)) {
+        range[0] = mid;
+      } else {
+        range[1] = mid;
+      }
+      lon_bit = !lon_bit;
+    }
+  }
+
+  if (lat) {
+    *lat = (lat_range[0] + lat_range[1]) / 2.0;
+  }
+  if (lon) {
+    *lon = (lon_range[0] + lon_range[1]) / 2.0;
+  }
+  if (lat_err) {
+    *lat_err = (lat_range[1] - lat_range[0]) / 2.0;
+  }
+  if (lon_err) {
+    *lon_err = (lon_range[1] - lon_range[0]) / 2.0;
+  }
+  return 0;
+}
+
+void geohash_cell_size(int precision, double lat, double *height_m,
+                       double *width_m) {
+  int bits = 5 * precision;
+  int lon_bits = (bits + 1) / 2;
+  int lat_bits = bits / 2;
+
+  if (height_m) {
+    *height_m = ldexp(180.0, -lat_bits) * GEO_METERS_PER_DEGREE;
+  }
+  if (width_m) {
+    *width_m = ldexp(360.0, -lon_bits) * GEO_METERS_PER_DEGREE *
+               cos(lat * M_PI / 180.0);
+  }
+}
+
+double geo_distance_m(double lat1, double lon1, double lat2, double lon2) {
+  double phi1 = lat1 * M_PI / 180.0;
+  double phi2 = lat2 * M_PI / 180.0;
+  double dphi = phi2 - phi1;
+  double dlambda = (lon2 - lon1) * M_PI / 180.0;
+
+  /* Haversine: well conditioned for the short distances this is used for */
+  double a = sin(dphi / 2.0) * sin(dphi / 2.0) +
+             cos(phi1) * cos(phi2) * sin(dlambda / 2.0) * sin(dlambda / 2.0);
+  return 2.0 * GEO_EARTH_RADIUS_M * asin(sqrt(a < 1.0 ? a : 1.0));
+}
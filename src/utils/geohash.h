@@ -0,0 +1,35 @@
+#ifndef GEOHASH_H
+#define GEOHASH_H
+
+/* Longest geohash handled: 12 characters is a cell of a few centimeters */
+#define GEOHASH_MAX_PRECISION 12
+/* Mean Earth radius, and the length of a degree of latitude on it */
+#define GEO_EARTH_RADIUS_M 6371008.8
+#define GEO_METERS_PER_DEGREE                                                  \
+  (GEO_EARTH_RADIUS_M * 3.14159265358979323846 / 180.0)
+
+/*
+  Geohash cells: a geohash of n base32 characters names one cell of a grid
+  that halves alternately in longitude and latitude with every bit, so each
+  extra character divides a cell into 32, and hashes sharing a prefix lie in
+  the cell named by that prefix.
+*/
+
+/* Writes the precision-character hash of the cell holding lat/lon into out,
+ * which must hold precision + 1 bytes. Returns -1 on invalid arguments. */
+int geohash_encode(double lat, double lon, int precision, char *out);
+
+/* Returns the center of hash's cell through lat/lon and its half-height and
+ * half-width in degrees through lat_err/lon_err (either may be NULL), or -1
+ * if hash is not a geohash */
+int geohash_decode(const char *hash, double *lat, double *lon, double *lat_err,
+                   double *lon_err);
+
+/* Height and width in meters of a precision-character cell at latitude lat */
+void geohash_cell_size(int precision, double lat, double *height_m,
+                       double *width_m);
+
+/* Great-circle distance in meters between two points */
+double geo_distance_m(double lat1, double lon1, double lat2, double lon2);
+
+#endif
@@ -0,0 +1,424 @@
+#include "spatial_index.h"
+
+#include "geohash.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Most cells a radius query visits; wider circles search a coarser level */
+#define SPATIAL_QUERY_CELLS 25
+
+static const char BASE32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+typedef struct SpatialPoint SpatialPoint;
+struct SpatialPoint {
+  char *key;
+  double lat;
+  double lon;
+  SpatialPoint *next;
+};
+
+typedef struct TrieNode TrieNode;
+struct TrieNode {
+  uint32_t child_mask; /* bit d set: a child for base32 digit d exists */
+  TrieNode **children; /* one per set bit, in digit order */
+  SpatialPoint *points; /* leaves only */
+};
+
+struct SpatialIndex {
+  pthread_rwlock_t lock;
+  TrieNode root;
+  size_t count;
+  size_t max_points;
+};
+
+static int digit_of(char c) {
+  const char *found = c ? strchr(BASE32, c) : NULL;
+  return found ? (int)(found - BASE32) : -1;
+}
+
+/* Position of digit's child in children */
+static int child_slot(const TrieNode *node, int digit) {
+  return __builtin_popcount(node->child_mask & ((1u << digit) - 1));
+}
+
+static TrieNode *child_of(const TrieNode *node, int digit) {
+  if (!(node->child_mask & (1u << digit))) {
+    return NULL;
+  }
+  return node->children[child_slot(node, digit)];
+}
+
+static TrieNode *add_child(TrieNode *node, int digit) {
+  int count = __builtin_popcount(node->child_mask);
+  TrieNode **children =
+      realloc(node->children, (size_t)(count + 1) * sizeof(TrieNode *));
+  if (!children) {
+    return NULL;
+  }
+  node->children = children;
+
+  TrieNode *child = calloc(1, sizeof(TrieNode));
+  if (!child) {
+    return NULL;
+  }
+
+  int slot = child_slot(node, digit);
+  memmove(&children[slot + 1], &children[slot],
+          (size_t)(count - slot) * sizeof(TrieNode *));
+  children[slot] = child;
+  node->child_mask |= 1u << digit;
+  return child;
+}
+
+/* Frees node's subtree; the node itself belongs to its parent */
+static void free_subtree(TrieNode *node) {
+  int count = __builtin_popcount(node->child_mask);
+  for (int i = 0; i < count; i++) {
+    free_subtree(node->children[i]);
+    free(node->children[i]);
+  }
+  free(node->children);
+
+  SpatialPoint *point = node->points;
+  while (point) {
+    SpatialPoint *next = point->next;
+    free(point->key);
+    free(point);
+    point = next;
+  }
+}
+
+static void remove_child(TrieNode *node, int digit) {
+  int count = __builtin_popcount(node->child_mask);
+  int slot = child_slot(node, digit);
+  free_subtree(node->children[slot]);
+  free(node->children[slot]);
+  memmove(&node->children[slot], &node->children[slot + 1],
+          (size_t)(count - slot - 1) * sizeof(TrieNode *));
+  node->child_mask &= ~(1u << digit);
+  if (node->child_mask == 0) {
+    free(node->children);
+    node->children = NULL;
+  }
+}
+
+static SpatialPoint **find_point(TrieNode *leaf, const char *key, double lat,
+                                 double lon) {
+  for (SpatialPoint **link = &leaf->points; *link; link = &(*link)->next) {
+    SpatialPoint *point = *link;
+    if (point->lat == lat && point->lon == lon &&
+        strcmp(point->key, key) == 0) {
+      return link;
+    }
+  }
+  return NULL;
+}
+
+static int is_empty(const TrieNode *node) {
+  return node->child_mask == 0 && !node->points;
+}
+
+SpatialIndex *spatial_index_create(size_t max_points) {
+  if (max_points == 0) {
+    return NULL;
+  }
+
+  SpatialIndex *index = calloc(1, sizeof(SpatialIndex));
+  if (!index) {
+    return NULL;
+  }
+  index->max_points = max_points;
+  pthread_rwlock_init(&index->lock, NULL);
+  return index;
+}
+
+void spatial_index_destroy(SpatialIndex *index) {
+  if (!index) {
+    return;
+  }
+  free_subtree(&index->root);
+  pthread_rwlock_destroy(&index->lock);
+  free(index);
+}
+
+int spatial_index_insert(SpatialIndex *index, const char *key, double lat,
+                         double lon) {
+  char hash[SPATIAL_INDEX_DEPTH + 1];
+  if (!index || !key || strlen(key) >= SPATIAL_KEY_MAX ||
+      geohash_encode(lat, lon, SPATIAL_INDEX_DEPTH, hash) != 0) {
+    return -1;
+  }
+
+  SpatialPoint *point = malloc(sizeof(SpatialPoint));
+  char *key_copy = strdup(key);
+  if (!point || !key_copy) {
+    free(point);
+    free(key_copy);
+    return -1;
+  }
+  point->key = key_copy;
+  point->lat = lat;
+  point->lon = lon;
+
+  int result = -1;
+  pthread_rwlock_wrlock(&index->lock);
+
+  /* Look before building, so a full index never grows empty branches */
+  TrieNode *node = &index->root;
+  for (int depth = 0; node && depth < SPATIAL_INDEX_DEPTH; depth++) {
+    node = child_of(node, digit_of(hash[depth]));
+  }
+  if (node && find_point(node, key, lat, lon)) {
+    result = 0;
+  } else if (index->count < index->max_points) {
+    node = &index->root;
+    for (int depth = 0; node && depth < SPATIAL_INDEX_DEPTH; depth++) {
+      int digit = digit_of(hash[depth]);
+      TrieNode *child = child_of(node, digit);
+      node = child ? child : add_child(node, digit);
+    }
+    if (node) {
+      point->next = node->points;
+      node->points = point;
+      index->count++;
+      point = NULL;
+      result = 0;
+    }
+  }
+
+  pthread_rwlock_unlock(&index->lock);
+
+  if (point) {
+    free(point->key);
+    free(point);
+  }
+  return result;
+}
+
+int spatial_index_remove(SpatialIndex *index, const char *key, double lat,
+                         double lon) {
+  char hash[SPATIAL_INDEX_DEPTH + 1];
+  if (!index || !key ||
+      geohash_encode(lat, lon, SPATIAL_INDEX_DEPTH, hash) != 0) {
+    return -1;
+  }
+
+  int result = -1;
+  pthread_rwlock_wrlock(&index->lock);
+
+  TrieNode *path[SPATIAL_INDEX_DEPTH + 1];
+  path[0] = &index->root;
+  int depth = 0;
+  while (depth < SPATIAL_INDEX_DEPTH && path[depth]) {
+    path[depth + 1] = child_of(path[depth], digit_of(hash[depth]));
+    depth++;
+  }
+
+  TrieNode *leaf = path[SPATIAL_INDEX_DEPTH];
+  if (depth == SPATIAL_INDEX_DEPTH && leaf) {
+    SpatialPoint **link = find_point(leaf, key, lat, lon);
+    if (link) {
+      SpatialPoint *point = *link;
+      *link = point->next;
+      free(point->key);
+      free(point);
+      index->count--;
+      result = 0;
+    }
+
+    /* Drop the nodes the removal emptied, bottom up */
+    for (int level = SPATIAL_INDEX_DEPTH; level > 0 && is_empty(path[level]);
+         level--) {
+      remove_child(path[level - 1], digit_of(hash[level - 1]));
+    }
+  }
+
+  pthread_rwlock_unlock(&index->lock);
+  return result;
+}
+
+/* Inserts a match into out, kept sorted by distance and at most max long */
+static void add_match(SpatialMatch *out, size_t max, size_t *found,
+                      const SpatialPoint *point, double distance) {
+  size_t position = *found;
+  while (position > 0 && out[position - 1].distance_m > distance) {
+    position--;
+  }
+  if (position >= max) {
+    return;
+  }
+
+  size_t last = *found < max ? *found : max - 1;
+  memmove(&out[position + 1], &out[position],
+          (last - position) * sizeof(SpatialMatch));
+  strcpy(out[position].key, point->key);
+  out[position].lat = point->lat;
+  out[position].lon = point->lon;
+  out[position].distance_m = distance;
+  if (*found < max) {
+    (*found)++;
+  }
+}
+
+/* A radius query, with the bounding box of its circle in degrees */
+typedef struct {
+  double lat;
+  double lon;
+  double radius_m;
+  double lat_span;
+  double lon_span;
+  SpatialMatch *out;
+  size_t max;
+  size_t found;
+} Query;
+
+static void collect(const TrieNode *node, Query *query) {
+  for (const SpatialPoint *point = node->points; point; point = point->next) {
+    /* The box test is cheap and rules out most points of a cell */
+    double lon_delta = fabs(point->lon - query->lon);
+    if (lon_delta > 180.0) {
+      lon_delta = 360.0 - lon_delta;
+    }
+    if (fabs(point->lat - query->lat) > query->lat_span ||
+        lon_delta > query->lon_span) {
+      continue;
+    }
+
+    double distance =
+        geo_distance_m(query->lat, query->lon, point->lat, point->lon);
+    if (distance <= query->radius_m) {
+      add_match(query->out, query->max, &query->found, point, distance);
+    }
+  }
+
+  int count = __builtin_popcount(node->child_mask);
+  for (int i = 0; i < count; i++) {
+    collect(node->children[i], query);
+  }
+}
+
+/* Grid cells of a level: rows and columns are counted from the south-west
+ * corner, as geohash bits are */
+typedef struct {
+  int level;
+  double height; /* degrees */
+  double width;
+  long rows;
+  long columns;
+  long first_row;
+  long last_row;
+  long first_column;
+  long last_column;
+} CellRange;
+
+static void cell_range(const Query *query, int level, CellRange *range) {
+  int bits = 5 * level;
+  range->level = level;
+  range->rows = 1L << (bits / 2);
+  range->columns = 1L << ((bits + 1) / 2);
+  range->height = 180.0 / (double)range->rows;
+  range->width = 360.0 / (double)range->columns;
+
+  range->first_row = (long)floor((query->lat - query->lat_span + 90.0) /
+                                 range->height);
+  range->last_row = (long)floor((query->lat + query->lat_span + 90.0) /
+                                range->height);
+  range->first_column = (long)floor((query->lon - query->lon_span + 180.0) /
+                                    range->width);
+  range->last_column = (long)floor((query->lon + query->lon_span + 180.0) /
+                                   range->width);
+}
+
+/* Deepest level at which the box spans at most SPATIAL_QUERY_CELLS cells;
+ * returns 0 when the whole trie has to be searched */
+static int query_cells(const Query *query, CellRange *range) {
+  for (int level = SPATIAL_INDEX_DEPTH; level > 0; level--) {
+    cell_range(query, level, range);
+    long rows = range->last_row - range->first_row + 1;
+    long columns = range->last_column - range->first_column + 1;
+    if (columns <= range->columns && rows * columns <= SPATIAL_QUERY_CELLS) {
+      return level;
+    }
+  }
+  return 0;
+}
+
+size_t spatial_index_nearby(SpatialIndex *index, double lat, double lon,
+                            double radius_m, SpatialMatch *out, size_t max) {
+  if (!index || !out || max == 0 || !(radius_m >= 0) ||
+      !(lat >= -90.0 && lat <= 90.0) || !(lon >= -180.0 && lon <= 180.0)) {
+    return 0;
+  }
+
+  Query query = {lat, lon, radius_m, 0, 0, out, max, 0};
+  query.lat_span = radius_m / GEO_METERS_PER_DEGREE;
+  /* Meridians converge: widen the box by the latitude's scale, with slack
+   * for the sphere, or give up on it near the poles */
+  double scale = cos(lat * M_PI / 180.0);
+  query.lon_span = scale > 1e-6 ? query.lat_span * 1.01 / scale : 360.0;
+  if (query.lon_span > 180.0) {
+    query.lon_span = 360.0;
+  }
+
+  CellRange range;
+  int level = query_cells(&query, &range);
+
+  pthread_rwlock_rdlock(&index->lock);
+
+  if (level == 0) {
+    collect(&index->root, &query);
+  }
+  for (long row = range.first_row; level > 0 && row <= range.last_row;
+       row++) {
+    if (row < 0 || row >= range.rows) {
+      continue;
+    }
+    for (long column = range.first_column; column <= range.last_column;
+         column++) {
+      /* Columns wrap around the antimeridian */
+      long wrapped = (column % range.columns + range.columns) % range.columns;
+      char cell[SPATIAL_INDEX_DEPTH + 1];
+      geohash_encode(-90.0 + ((double)row + 0.5) * range.height,
+                     -180.0 + ((double)wrapped + 0.5) * range.width, level,
+                     cell);
+
+      const TrieNode *node = &index->root;
+      for (int depth = 0; node && depth < level; depth++) {
+        node = child_of(node, digit_of(cell[depth]));
+      }
+      if (node) {
+        collect(node, &query);
+      }
+    }
+  }
+
+  pthread_rwlock_unlock(&index->lock);
+  return query.found;
+}
+
+void spatial_index_clear(SpatialIndex *index) {
+  if (!index) {
+    return;
+  }
+
+  pthread_rwlock_wrlock(&index->lock);
+  free_subtree(&index->root);
+  memset(&index->root, 0, sizeof(TrieNode));
+  index->count = 0;
+  pthread_rwlock_unlock(&index->lock);
+}
+
+size_t spatial_index_count(SpatialIndex *index) {
+  if (!index) {
+    return 0;
+  }
+
+  pthread_rwlock_rdlock(&index->lock);
+  size_t count = index->count;
+  pthread_rwlock_unlock(&index->lock);
+  return count;
+}
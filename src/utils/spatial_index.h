@@ -0,0 +1,54 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <stddef.h>
+
+/* Trie levels, one per geohash character: leaves are cells of about
+ * 38 x 19 m */
+#define SPATIAL_INDEX_DEPTH 8
+/* Longest key a point may carry, NUL included */
+#define SPATIAL_KEY_MAX 128
+
+/*
+  Spatial index of named points: a geohash trie whose node at depth n is the
+  n-character cell holding everything below it. Nodes only allocate the
+  children that exist, so a sparse index stays small.
+    A radius query picks the deepest level at which a few cells cover the
+  circle's bounding box, and measures only the points in those cells that
+  also fall inside the box. Points are identified by
+  key together with their position. All functions are thread-safe; queries
+  share a read lock.
+*/
+typedef struct SpatialIndex SpatialIndex;
+
+/* A point found by spatial_index_nearby() */
+typedef struct {
+  char key[SPATIAL_KEY_MAX];
+  double lat;
+  double lon;
+  double distance_m;
+} SpatialMatch;
+
+/* Creates an index holding up to max_points points */
+SpatialIndex *spatial_index_create(size_t max_points);
+void spatial_index_destroy(SpatialIndex *index);
+
+/* Adds key at lat/lon; adding it again is a no-op. Returns -1 on invalid
+ * arguments or once the index is full. */
+int spatial_index_insert(SpatialIndex *index, const char *key, double lat,
+                         double lon);
+
+/* Removes key at lat/lon; returns -1 if it is not there */
+int spatial_index_remove(SpatialIndex *index, const char *key, double lat,
+                         double lon);
+
+/* Fills out with up to max points within radius_m of lat/lon, nearest first,
+ * and returns how many it found */
+size_t spatial_index_nearby(SpatialIndex *index, double lat, double lon,
+                            double radius_m, SpatialMatch *out, size_t max);
+
+void spatial_index_clear(SpatialIndex *index);
+
+size_t spatial_index_count(SpatialIndex *index);
+
+#endif
@@ -57,6 +57,12 @@ uint64_t get_current_time_ms() {
   return (uint64_t)(tv.tv_sec) * 1000 + (uint64_t)(tv.tv_usec) / 1000;
 }
 
+uint64_t get_monotonic_time_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)(ts.tv_sec) * 1000 + (uint64_t)(ts.tv_nsec) / 1000000;
+}
+
 char *string_trim(char *str) {
   if (!str) {
     return NULL;
@@ -14,6 +14,7 @@ int validate_city_name(const char *city);
 
 /* Time */
 uint64_t get_current_time_ms();
+uint64_t get_monotonic_time_ms();
 
 /* String */
 char *string_trim(char *str);
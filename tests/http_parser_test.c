@@ -0,0 +1,225 @@
+/**
+ * http_parser_test.c - Response framing cases HttpParser must get right
+ *
+ * Interim 1xx responses ahead of the final one, chunk size lines without a
+ * size, and Content-Length values that must fail the parse instead of sizing
+ * the body buffer. Each response
+ * is fed whole and then one byte at a time, since the socket may split it
+ * anywhere. Prints one line per failed check and exits non-zero if any.
+ */
+
+#include "http_parser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+static const char *current_case;
+
+#define CHECK(cond)                                                           \
+  do {                                                                        \
+    if (!(cond)) {                                                            \
+      fprintf(stderr, "%s:%d: %s: CHECK(%s) failed\n", __FILE__, __LINE__,    \
+              current_case, #cond);                                           \
+      failures++;                                                             \
+    }                                                                         \
+  } while (0)
+
+/* Feeds raw in pieces of step bytes (0 for all at once); returns -1 as soon
+ * as the parser does, else the total consumed */
+static long feed(HttpParser *parser, const char *raw, size_t step) {
+  size_t len = strlen(raw);
+  size_t pos = 0;
+  while (pos < len && !http_parser_is_done(parser)) {
+    size_t piece = step && len - pos > step ? step : len - pos;
+    long consumed = http_parser_feed(parser, raw + pos, piece);
+    if (consumed < 0) {
+      return -1;
+    }
+    pos += (size_t)consumed;
+  }
+  return (long)pos;
+}
+
+static void test_early_hints_then_ok(size_t step) {
+  current_case = step ? "103 then 200, byte by byte" : "103 then 200";
+  const char *raw = "HTTP/1.1 103 Early Hints\r\n"
+                    "Link: </style.css>; rel=preload\r\n"
+                    "ETag: \"interim\"\r\n"
+                    "\r\n"
+                    "HTTP/1.1 200 OK\r\n"
+                    "Content-Length: 5\r\n"
+                    "ETag: \"final\"\r\n"
+                    "\r\n"
+                    "hello";
+
+  HttpParser parser;
+  http_parser_init(&parser);
+  CHECK(feed(&parser, raw, step) == (long)strlen(raw));
+  CHECK(http_parser_is_done(&parser));
+  CHECK(parser.status_code == 200);
+  CHECK(strcmp(parser.etag, "\"final\"") == 0);
+
+  size_t len = 0;
+  char *body = http_parser_take_body(&parser, &len);
+  CHECK(body && len == 5 && strcmp(body, "hello") == 0);
+  free(body);
+  http_parser_reset(&parser);
+}
+
+static void test_continue_then_chunked(void) {
+  current_case = "100 then chunked 200";
+  const char *raw = "HTTP/1.1 100 Continue\r\n"
+                    "\r\n"
+                    "HTTP/1.1 100 Continue\r\n"
+                    "\r\n"
+                    "HTTP/1.1 200 OK\r\n"
+                    "Transfer-Encoding: chunked\r\n"
+                    "\r\n"
+                    "3\r\nabc\r\n0\r\n\r\n";
+
+  HttpParser parser;
+  http_parser_init(&parser);
+  CHECK(feed(&parser, raw, 0) == (long)strlen(raw));
+  CHECK(http_parser_is_done(&parser));
+  CHECK(parser.status_code == 200);
+  CHECK(parser.body && strcmp(parser.body, "abc") == 0);
+  http_parser_reset(&parser);
+}
+
+/* Without digits a size line is malformed, never the terminating chunk */
+static void expect_chunked_rejected(const char *name, const char *chunks) {
+  char raw[512];
+  snprintf(raw, sizeof(raw),
+           "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n%s",
+           chunks);
+
+  for (size_t step = 0; step <= 1; step++) {
+    current_case = name;
+    HttpParser parser;
+    http_parser_init(&parser);
+    CHECK(feed(&parser, raw, step) == -1);
+    CHECK(!http_parser_is_done(&parser));
+    http_parser_reset(&parser);
+  }
+}
+
+static void test_chunk_size_without_digits(void) {
+  expect_chunked_rejected("empty size line", "3\r\nabc\r\n\r\n");
+  expect_chunked_rejected("extension without size", "3\r\nabc\r\n;ext\r\n");
+  expect_chunked_rejected("space before size", "3\r\nabc\r\n 1a\r\n");
+  expect_chunked_rejected("empty first size line", "\r\nabc\r\n0\r\n\r\n");
+}
+
+static void test_chunk_extensions(void) {
+  current_case = "chunk extensions";
+  const char *raw = "HTTP/1.1 200 OK\r\n"
+                    "Transfer-Encoding: chunked\r\n"
+                    "\r\n"
+                    "3;name=value\r\nabc\r\n0 ;last\r\n\r\n";
+
+  HttpParser parser;
+  http_parser_init(&parser);
+  CHECK(feed(&parser, raw, 1) == (long)strlen(raw));
+  CHECK(http_parser_is_done(&parser));
+  CHECK(parser.body && strcmp(parser.body, "abc") == 0);
+  http_parser_reset(&parser);
+}
+
+static void test_switching_protocols_is_final(void) {
+  current_case = "101 is final";
+  const char *raw = "HTTP/1.1 101 Switching Protocols\r\n"
+                    "Upgrade: websocket\r\n"
+                    "\r\n";
+
+  HttpParser parser;
+  http_parser_init(&parser);
+  CHECK(feed(&parser, raw, 0) == (long)strlen(raw));
+  CHECK(http_parser_is_done(&parser));
+  CHECK(parser.status_code == 101);
+  http_parser_reset(&parser);
+}
+
+static void expect_rejected(const char *name, const char *headers,
+                            size_t max_body) {
+  char raw[512];
+  snprintf(raw, sizeof(raw), "HTTP/1.1 200 OK\r\n%s\r\n", headers);
+
+  for (size_t step = 0; step <= 1; step++) {
+    current_case = name;
+    HttpParser parser;
+    http_parser_init(&parser);
+    if (max_body) {
+      parser.max_body = max_body;
+    }
+    CHECK(feed(&parser, raw, step) == -1);
+    CHECK(parser.state == HTTP_PARSER_ERROR);
+    CHECK(parser.body == NULL);
+    http_parser_reset(&parser);
+  }
+}
+
+static void test_bad_content_length(void) {
+  expect_rejected("Content-Length: -1", "Content-Length: -1\r\n", 0);
+  expect_rejected("Content-Length: 2^64 - 1",
+                  "Content-Length: 18446744073709551615\r\n", 0);
+  expect_rejected("Content-Length: 2^64",
+                  "Content-Length: 18446744073709551616\r\n", 0);
+  expect_rejected("Content-Length: empty", "Content-Length:\r\n", 0);
+  expect_rejected("Content-Length: 12abc", "Content-Length: 12abc\r\n", 0);
+  expect_rejected("Content-Length: +5", "Content-Length: +5\r\n", 0);
+  expect_rejected("conflicting Content-Length",
+                  "Content-Length: 5\r\nContent-Length: 6\r\n", 0);
+  expect_rejected("Content-Length over max_body", "Content-Length: 11\r\n",
+                  10);
+}
+
+static void test_content_length_at_max_body(void) {
+  current_case = "Content-Length at max_body";
+  const char *raw = "HTTP/1.1 200 OK\r\n"
+                    "Content-Length: 10 \r\n"
+                    "Content-Length: 10\r\n"
+                    "\r\n"
+                    "0123456789";
+
+  HttpParser parser;
+  http_parser_init(&parser);
+  parser.max_body = 10;
+  CHECK(feed(&parser, raw, 0) == (long)strlen(raw));
+  CHECK(http_parser_is_done(&parser));
+  CHECK(parser.body_len == 10);
+  http_parser_reset(&parser);
+}
+
+static void test_eof_body_over_max_body(void) {
+  current_case = "EOF-delimited body over max_body";
+  const char *raw = "HTTP/1.1 200 OK\r\n"
+                    "\r\n"
+                    "0123456789a";
+
+  HttpParser parser;
+  http_parser_init(&parser);
+  parser.max_body = 10;
+  CHECK(feed(&parser, raw, 0) == -1);
+  http_parser_reset(&parser);
+}
+
+int main(void) {
+  test_early_hints_then_ok(0);
+  test_early_hints_then_ok(1);
+  test_continue_then_chunked();
+  test_chunk_size_without_digits();
+  test_chunk_extensions();
+  test_switching_protocols_is_final();
+  test_bad_content_length();
+  test_content_length_at_max_body();
+  test_eof_body_over_max_body();
+
+  if (failures) {
+    fprintf(stderr, "http_parser_test: %d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("http_parser_test: ok\n");
+  return 0;
+}